@@ -0,0 +1,57 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.benchmark;
+
+import icyllis.modernui.text.FontCollection;
+import org.openjdk.jmh.annotations.*;
+import org.openjdk.jmh.infra.Blackhole;
+
+import java.util.concurrent.TimeUnit;
+
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 5, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+public class FontItemizeBenchmark {
+
+    @Param
+    public TextCorpus corpus;
+
+    private char[] mText;
+    private final FontCollection.RunBuffer mRuns = new FontCollection.RunBuffer();
+
+    @Setup
+    public void setup() {
+        TextCorpus.setup();
+        mText = corpus.mText.toCharArray();
+    }
+
+    @Benchmark
+    public void itemize(Blackhole bh) {
+        bh.consume(FontCollection.SANS_SERIF.itemize(mText, 0, mText.length));
+    }
+
+    @Benchmark
+    public int itemizeReuse() {
+        FontCollection.SANS_SERIF.itemize(mText, 0, mText.length, mRuns);
+        return mRuns.size();
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.benchmark;
+
+import icyllis.modernui.text.GraphemeBreak;
+import org.openjdk.jmh.annotations.*;
+
+import java.util.Locale;
+import java.util.concurrent.TimeUnit;
+
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 5, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+public class GraphemeBreakBenchmark {
+
+    @Param
+    public TextCorpus corpus;
+
+    private char[] mText;
+    private int mCount;
+
+    @Setup
+    public void setup() {
+        TextCorpus.setup();
+        mText = corpus.mText.toCharArray();
+    }
+
+    @Benchmark
+    public int getTextRuns() {
+        mCount = 0;
+        GraphemeBreak.getTextRuns(mText, Locale.ROOT, 0, mText.length, (st, en) -> mCount++);
+        return mCount;
+    }
+
+    // move the cursor through the whole text
+    @Benchmark
+    public int getTextRunCursor() {
+        int offset = 0, count = 0;
+        for (int next; (next = GraphemeBreak.getTextRunCursor(mText, Locale.ROOT, 0, mText.length,
+                offset, GraphemeBreak.AFTER)) != offset; offset = next) {
+            count++;
+        }
+        return count;
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.benchmark;
+
+import icyllis.modernui.graphics.font.LayoutCache;
+import icyllis.modernui.text.*;
+import org.openjdk.jmh.annotations.*;
+
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Measures a paragraph and breaks it into lines, like a StaticLayout build.
+ * When {@link #cold} is true, the shared word cache is cleared before each invocation,
+ * so all words are shaped again.
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 5, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+public class LineBreakBenchmark {
+
+    @Param
+    public TextCorpus corpus;
+
+    @Param({"false", "true"})
+    public boolean cold;
+
+    private TextPaint mPaint;
+    private final LineBreaker.ParagraphConstraints mConstraints = new LineBreaker.ParagraphConstraints();
+    private MeasuredParagraph mMeasured;
+
+    @Setup
+    public void setup() {
+        TextCorpus.setup();
+        mPaint = new TextPaint();
+        mConstraints.setWidth(120);
+        mConstraints.setIndent(120);
+        mConstraints.setTabStops(null, 20);
+    }
+
+    @Setup(Level.Invocation)
+    public void clearCache() {
+        if (cold) {
+            LayoutCache.clear();
+        }
+    }
+
+    @Benchmark
+    public int measureAndBreak() {
+        final String text = corpus.mText;
+        mMeasured = MeasuredParagraph.buildForStaticLayout(mPaint, text, 0, text.length(),
+                TextDirectionHeuristics.FIRSTSTRONG_LTR, mMeasured);
+        LineBreaker.Result result = LineBreaker.computeLineBreaks(mMeasured.getMeasuredText(),
+                mConstraints, null, 0);
+        return result.getLineCount();
+    }
+
+    @TearDown
+    public void tearDown() {
+        if (mMeasured != null) {
+            mMeasured.recycle();
+            mMeasured = null;
+        }
+    }
+}
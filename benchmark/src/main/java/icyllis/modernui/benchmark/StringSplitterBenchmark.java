@@ -0,0 +1,64 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.benchmark;
+
+import icyllis.modernui.textmc.ModernStringSplitter;
+import net.minecraft.network.chat.Style;
+import org.openjdk.jmh.annotations.*;
+
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Wraps and trims vanilla strings, like chat and tooltip rendering. Layouts are cached
+ * after the first invocation, so this measures the cost on top of cache hits.
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 5, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+@Threads(1)
+public class StringSplitterBenchmark {
+
+    @Param
+    public TextCorpus corpus;
+
+    @Param({"80", "320"})
+    public int width;
+
+    private ModernStringSplitter mSplitter;
+
+    @Setup
+    public void setup() {
+        VanillaTextEnvironment.setup();
+        // vanilla widths are used by the fallback of the alternative font only
+        mSplitter = new ModernStringSplitter((codePoint, style) -> 0);
+    }
+
+    @Benchmark
+    public int splitLines() {
+        return mSplitter.splitLines(corpus.mText, width, Style.EMPTY).size();
+    }
+
+    @Benchmark
+    public int plainIndexAtWidth() {
+        return mSplitter.plainIndexAtWidth(corpus.mText, width, Style.EMPTY);
+    }
+}
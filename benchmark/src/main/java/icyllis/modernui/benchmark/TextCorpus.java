@@ -0,0 +1,61 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.benchmark;
+
+import icyllis.modernui.ModernUI;
+import icyllis.modernui.graphics.font.GlyphManagerBase;
+
+import javax.annotation.Nonnull;
+
+/**
+ * Representative texts for benchmarks, and the environment setup of the core text engine.
+ */
+public enum TextCorpus {
+    ENGLISH("<Steve> has anyone found the stronghold yet? I've got 12 eyes of ender and " +
+            "a full set of diamond armor, meet me at spawn (x: -124, z: 360) in 5 minutes."),
+    CJK("今天的服务器重启时间改到晚上十点，" +
+            "请大家提前保存好自己的背包。" +
+            "アイテムを拾ってください。" +
+            "다이아몬드 칼을 얻었습니다."),
+    MIXED_RTL("Trade offer: חרב יהלום x3 for 64 emeralds, " +
+            "السيف الماسي (Diamond Sword) " +
+            "مع سحر الحدة V."),
+    EMOJI("GG everyone 🎉🎉 see you tomorrow 👋🏽 " +
+            "❤️ 👨‍👩‍👧 1️⃣ café");
+
+    @Nonnull
+    public final String mText;
+
+    TextCorpus(@Nonnull String text) {
+        mText = text;
+    }
+
+    private static boolean sInitialized;
+
+    /**
+     * Creates the instances required by measurement, without any window or GL context.
+     */
+    public static synchronized void setup() {
+        if (!sInitialized) {
+            new ModernUI();
+            new GlyphManagerBase();
+            sInitialized = true;
+        }
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.benchmark;
+
+import icyllis.modernui.graphics.font.ShapingCache;
+import icyllis.modernui.textmc.TextLayoutProcessor;
+import net.minecraft.network.chat.Style;
+import org.openjdk.jmh.annotations.*;
+
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Looks up the render node of a vanilla string, like a font renderer draw or width query.
+ * With {@link #cache} of {@code HIT}, the node is cached. With {@code MISS}, the layout
+ * cache is cleared before each invocation, so the node is generated again (see
+ * {@code generateVanillaNode}) from cached shaping results and glyphs. With {@code COLD}, the shaping cache is cleared as well.
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 5, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+@Threads(1)
+public class VanillaLayoutBenchmark {
+
+    @Param
+    public TextCorpus corpus;
+
+    @Param({"HIT", "MISS", "COLD"})
+    public String cache;
+
+    private TextLayoutProcessor mProcessor;
+
+    @Setup
+    public void setup() {
+        VanillaTextEnvironment.setup();
+        mProcessor = TextLayoutProcessor.getInstance();
+        // cache the glyphs and the node
+        mProcessor.lookupVanillaNode(corpus.mText, Style.EMPTY);
+    }
+
+    @Setup(Level.Invocation)
+    public void clearCache() {
+        if (!cache.equals("HIT")) {
+            mProcessor.clearLayoutCache();
+        }
+        if (cache.equals("COLD")) {
+            ShapingCache.clear();
+        }
+    }
+
+    @Benchmark
+    public float lookupVanillaNode() {
+        return mProcessor.lookupVanillaNode(corpus.mText, Style.EMPTY).advance;
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.benchmark;
+
+import com.mojang.blaze3d.systems.RenderSystem;
+import icyllis.modernui.graphics.font.GlyphManagerForge;
+import icyllis.modernui.platform.RenderCore;
+import icyllis.modernui.textmc.TextLayoutProcessor;
+import org.lwjgl.glfw.GLFW;
+
+import static org.lwjgl.system.MemoryUtil.NULL;
+
+/**
+ * The environment setup of the vanilla text engine. Glyphs are uploaded to OpenGL textures
+ * during layout, so this creates a hidden window and makes its context current on the
+ * calling thread, which becomes the render thread of both Modern UI and Minecraft.
+ * <p>
+ * Benchmarks using this must run with a single thread and call {@link #setup()} in a
+ * trial level setup, JMH runs all iterations of a fork on the same worker thread then.
+ */
+public final class VanillaTextEnvironment {
+
+    private static long sWindow;
+
+    private VanillaTextEnvironment() {
+    }
+
+    /**
+     * Creates the instances required by vanilla text layout, without a game instance.
+     */
+    public static synchronized void setup() {
+        if (sWindow != NULL) {
+            return;
+        }
+        TextCorpus.setup();
+        RenderCore.initBackend();
+        GLFW.glfwDefaultWindowHints();
+        GLFW.glfwWindowHint(GLFW.GLFW_VISIBLE, GLFW.GLFW_FALSE);
+        final long window = GLFW.glfwCreateWindow(64, 64, "Modern UI Benchmark", NULL, NULL);
+        if (window == NULL) {
+            throw new IllegalStateException("Failed to create an OpenGL context");
+        }
+        GLFW.glfwMakeContextCurrent(window);
+        RenderCore.initialize();
+        RenderSystem.initRenderThread();
+        // standard level, as a GUI scale of 2
+        GlyphManagerForge.sResolutionLevel = 1;
+        TextLayoutProcessor.getInstance().initRenderer();
+        sWindow = window;
+    }
+}
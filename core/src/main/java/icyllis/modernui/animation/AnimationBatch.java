@@ -0,0 +1,371 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.animation;
+
+import icyllis.modernui.math.MathUtil;
+
+import javax.annotation.Nonnull;
+import javax.annotation.concurrent.NotThreadSafe;
+import java.util.Arrays;
+
+/**
+ * Runs many simple animations of float or color properties in batch. Unlike {@link ObjectAnimator},
+ * there are no keyframes, evaluators or listeners. The values, timing and interpolators of all
+ * animations are stored in primitive arrays, and they are evaluated together in a few loops in
+ * each frame, then the values are set to the targets by {@link FloatProperty} or {@link IntProperty}.
+ * <p>
+ * Colors are interpolated in linear space, the same as {@link ColorEvaluator}. Starting an
+ * animation on a property that is already animated by this batch replaces the old one.
+ * It should be used on UI thread.
+ */
+@NotThreadSafe
+public final class AnimationBatch implements AnimationHandler.FrameCallback {
+
+    /**
+     * Built-in interpolators, see {@link Interpolator}
+     */
+    public static final int INTERPOLATOR_LINEAR = 0;
+    public static final int INTERPOLATOR_ACCELERATE = 1;
+    public static final int INTERPOLATOR_DECELERATE = 2;
+    public static final int INTERPOLATOR_ACCELERATE_DECELERATE = 3;
+    public static final int INTERPOLATOR_ANTICIPATE = 4;
+    public static final int INTERPOLATOR_OVERSHOOT = 5;
+
+    private static final byte TYPE_REMOVED = 0;
+    private static final byte TYPE_FLOAT = 1;
+    private static final byte TYPE_COLOR = 2;
+
+    private static final float GAMMA = 2.2f;
+
+    private static AnimationBatch sInstance;
+
+    // per animation
+    private int mCount;
+    private Object[] mTargets = new Object[16];
+    private Property<?, ?>[] mProperties = new Property<?, ?>[16];
+    private long[] mStartTimes = new long[16];
+    private float[] mInvDurations = new float[16];
+    private byte[] mInterpolators = new byte[16];
+    private byte[] mTypes = new byte[16];
+    // the first lane of each animation
+    private int[] mLaneStarts = new int[16];
+    // linear progress, negative if not started
+    private float[] mProgresses = new float[16];
+    private float[] mFractions = new float[16];
+    // the end color of color animations, set as is when finished
+    private int[] mEndColors = new int[16];
+
+    // per lane, a float animation has one lane and a color animation has four (ARGB)
+    private int mLaneCount;
+    private int[] mLaneOwners = new int[16];
+    private float[] mFrom = new float[16];
+    private float[] mTo = new float[16];
+    private float[] mValues = new float[16];
+
+    private boolean mRegistered;
+    private int mRemovedCount;
+
+    public AnimationBatch() {
+    }
+
+    /**
+     * Returns the batch shared by the UI.
+     */
+    @Nonnull
+    public static AnimationBatch getInstance() {
+        if (sInstance == null) {
+            sInstance = new AnimationBatch();
+        }
+        return sInstance;
+    }
+
+    /**
+     * Starts animating a float property.
+     *
+     * @param target       the object whose property is to be animated
+     * @param property     the property being animated
+     * @param from         the start value
+     * @param to           the end value
+     * @param duration     the duration in milliseconds
+     * @param delay        the start delay in milliseconds
+     * @param interpolator one of the built-in interpolators, such as {@link #INTERPOLATOR_DECELERATE}
+     */
+    public <T> void start(@Nonnull T target, @Nonnull FloatProperty<T> property, float from, float to,
+                          long duration, long delay, int interpolator) {
+        final int lane = add(target, property, TYPE_FLOAT, duration, delay, interpolator, 1);
+        mFrom[lane] = from;
+        mTo[lane] = to;
+    }
+
+    /**
+     * Starts animating a color property, the color is interpolated in linear space.
+     *
+     * @param target       the object whose property is to be animated
+     * @param property     the property being animated
+     * @param from         the start color in ARGB
+     * @param to           the end color in ARGB
+     * @param duration     the duration in milliseconds
+     * @param delay        the start delay in milliseconds
+     * @param interpolator one of the built-in interpolators, such as {@link #INTERPOLATOR_DECELERATE}
+     */
+    public <T> void startColor(@Nonnull T target, @Nonnull IntProperty<T> property, int from, int to,
+                               long duration, long delay, int interpolator) {
+        final int lane = add(target, property, TYPE_COLOR, duration, delay, interpolator, 4);
+        mEndColors[mLaneOwners[lane]] = to;
+        for (int i = 0, shift = 24; i < 4; i++, shift -= 8) {
+            float a = ((from >> shift) & 0xff) / 255.0f;
+            float b = ((to >> shift) & 0xff) / 255.0f;
+            // alpha is linear
+            mFrom[lane + i] = i == 0 ? a : (float) Math.pow(a, GAMMA);
+            mTo[lane + i] = i == 0 ? b : (float) Math.pow(b, GAMMA);
+        }
+    }
+
+    // add an animation and returns its first lane
+    private int add(@Nonnull Object target, @Nonnull Property<?, ?> property, byte type,
+                    long duration, long delay, int interpolator, int lanes) {
+        if (interpolator < INTERPOLATOR_LINEAR || interpolator > INTERPOLATOR_OVERSHOOT) {
+            throw new IllegalArgumentException("Unknown interpolator " + interpolator);
+        }
+        cancel(target, property);
+        final int index = mCount;
+        if (index == mTargets.length) {
+            final int cap = index << 1;
+            mTargets = Arrays.copyOf(mTargets, cap);
+            mProperties = Arrays.copyOf(mProperties, cap);
+            mStartTimes = Arrays.copyOf(mStartTimes, cap);
+            mInvDurations = Arrays.copyOf(mInvDurations, cap);
+            mInterpolators = Arrays.copyOf(mInterpolators, cap);
+            mTypes = Arrays.copyOf(mTypes, cap);
+            mLaneStarts = Arrays.copyOf(mLaneStarts, cap);
+            mProgresses = Arrays.copyOf(mProgresses, cap);
+            mFractions = Arrays.copyOf(mFractions, cap);
+            mEndColors = Arrays.copyOf(mEndColors, cap);
+        }
+        final int lane = mLaneCount;
+        if (lane + lanes > mFrom.length) {
+            final int cap = Math.max(mFrom.length << 1, lane + lanes);
+            mLaneOwners = Arrays.copyOf(mLaneOwners, cap);
+            mFrom = Arrays.copyOf(mFrom, cap);
+            mTo = Arrays.copyOf(mTo, cap);
+            mValues = Arrays.copyOf(mValues, cap);
+        }
+        mTargets[index] = target;
+        mProperties[index] = property;
+        mStartTimes[index] = AnimationHandler.currentTimeMillis() + Math.max(delay, 0);
+        // 0 means no duration, it ends in the first frame
+        mInvDurations[index] = duration > 0 ? 1.0f / duration : 0;
+        mInterpolators[index] = (byte) interpolator;
+        mTypes[index] = type;
+        mLaneStarts[index] = lane;
+        for (int i = 0; i < lanes; i++) {
+            mLaneOwners[lane + i] = index;
+        }
+        mCount = index + 1;
+        mLaneCount = lane + lanes;
+        if (!mRegistered) {
+            AnimationHandler.getInstance().register(this, 0);
+            mRegistered = true;
+        }
+        return lane;
+    }
+
+    /**
+     * Cancels the animation on the property, the property keeps the current value.
+     *
+     * @param target   the object whose property is being animated
+     * @param property the property being animated
+     * @return true if the animation was running
+     */
+    public boolean cancel(@Nonnull Object target, @Nonnull Property<?, ?> property) {
+        final Object[] targets = mTargets;
+        final Property<?, ?>[] properties = mProperties;
+        for (int i = 0, e = mCount; i < e; i++) {
+            if (targets[i] == target && properties[i] == property && mTypes[i] != TYPE_REMOVED) {
+                remove(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Cancels all animations on the target.
+     *
+     * @param target the object whose properties are being animated
+     */
+    public void cancelAll(@Nonnull Object target) {
+        final Object[] targets = mTargets;
+        for (int i = 0, e = mCount; i < e; i++) {
+            if (targets[i] == target && mTypes[i] != TYPE_REMOVED) {
+                remove(i);
+            }
+        }
+    }
+
+    /**
+     * Returns whether the property is being animated by this batch.
+     */
+    public boolean isRunning(@Nonnull Object target, @Nonnull Property<?, ?> property) {
+        for (int i = 0, e = mCount; i < e; i++) {
+            if (mTargets[i] == target && mProperties[i] == property && mTypes[i] != TYPE_REMOVED) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Returns the number of running animations.
+     */
+    public int getCount() {
+        return mCount - mRemovedCount;
+    }
+
+    // removed animations are compacted after a frame
+    private void remove(int index) {
+        mTypes[index] = TYPE_REMOVED;
+        mTargets[index] = null;
+        mProperties[index] = null;
+        mRemovedCount++;
+    }
+
+    @SuppressWarnings("unchecked")
+    @Override
+    public void doAnimationFrame(long frameTime) {
+        final int count = mCount;
+        final long[] startTimes = mStartTimes;
+        final float[] invDurations = mInvDurations;
+        final float[] progresses = mProgresses;
+        final float[] fractions = mFractions;
+        final byte[] interpolators = mInterpolators;
+
+        for (int i = 0; i < count; i++) {
+            final long time = frameTime - startTimes[i];
+            final float invDuration = invDurations[i];
+            progresses[i] = time < 0 ? -1 : invDuration == 0 ? 1 : Math.min(time * invDuration, 1);
+        }
+        for (int i = 0; i < count; i++) {
+            fractions[i] = interpolate(interpolators[i], progresses[i]);
+        }
+
+        final int laneCount = mLaneCount;
+        final int[] owners = mLaneOwners;
+        final float[] from = mFrom;
+        final float[] to = mTo;
+        final float[] values = mValues;
+        for (int i = 0; i < laneCount; i++) {
+            final float f = fractions[owners[i]];
+            values[i] = from[i] + (to[i] - from[i]) * f;
+        }
+
+        // setters may start or cancel animations, the new ones will run in the next frame,
+        // so read the fields in each iteration
+        for (int i = 0; i < count; i++) {
+            final byte type = mTypes[i];
+            if (type == TYPE_REMOVED || progresses[i] < 0) {
+                continue;
+            }
+            final Object target = mTargets[i];
+            final int lane = mLaneStarts[i];
+            // interpolation may not give the exact end value, set it as is when finished
+            final boolean finished = progresses[i] >= 1;
+            if (type == TYPE_FLOAT) {
+                final float value = finished ? mTo[lane] : mValues[lane];
+                assert !Float.isNaN(value) : "NaN animated value";
+                ((FloatProperty<Object>) mProperties[i]).setValue(target, value);
+            } else {
+                ((IntProperty<Object>) mProperties[i]).setValue(target,
+                        finished ? mEndColors[i] : toColor(mValues, lane));
+            }
+            if (finished && mTypes[i] != TYPE_REMOVED) {
+                remove(i);
+            }
+        }
+
+        if (mRemovedCount > 0) {
+            compact();
+        }
+        if (mCount == 0 && mRegistered) {
+            AnimationHandler.getInstance().unregister(this);
+            mRegistered = false;
+        }
+    }
+
+    private static float interpolate(byte interpolator, float t) {
+        switch (interpolator) {
+            case INTERPOLATOR_ACCELERATE:
+                return t * t;
+            case INTERPOLATOR_DECELERATE:
+                return 1.0f - (1.0f - t) * (1.0f - t);
+            case INTERPOLATOR_ACCELERATE_DECELERATE:
+                return MathUtil.cos((t + 1.0f) * MathUtil.PI) * 0.5f + 0.5f;
+            case INTERPOLATOR_ANTICIPATE:
+                return t * t * (3.0f * t - 2.0f);
+            case INTERPOLATOR_OVERSHOOT:
+                return (t - 1.0f) * (t - 1.0f) * (3.0f * (t - 1.0f) + 2.0f) + 1.0f;
+            default:
+                return t;
+        }
+    }
+
+    // from linear ARGB lanes to sRGB color
+    private static int toColor(@Nonnull float[] values, int lane) {
+        int color = Math.round(MathUtil.clamp(values[lane], 0, 1) * 255.0f) << 24;
+        for (int i = 1, shift = 16; i < 4; i++, shift -= 8) {
+            float v = (float) Math.pow(MathUtil.clamp(values[lane + i], 0, 1), 1.0 / GAMMA);
+            color |= Math.round(v * 255.0f) << shift;
+        }
+        return color;
+    }
+
+    // remove animations and their lanes, keep the order
+    private void compact() {
+        final int count = mCount;
+        int n = 0, lanes = 0;
+        for (int i = 0; i < count; i++) {
+            final byte type = mTypes[i];
+            if (type == TYPE_REMOVED) {
+                continue;
+            }
+            final int laneStart = mLaneStarts[i];
+            final int laneCount = type == TYPE_COLOR ? 4 : 1;
+            for (int j = 0; j < laneCount; j++) {
+                mLaneOwners[lanes + j] = n;
+                mFrom[lanes + j] = mFrom[laneStart + j];
+                mTo[lanes + j] = mTo[laneStart + j];
+            }
+            mTargets[n] = mTargets[i];
+            mProperties[n] = mProperties[i];
+            mStartTimes[n] = mStartTimes[i];
+            mInvDurations[n] = mInvDurations[i];
+            mInterpolators[n] = mInterpolators[i];
+            mEndColors[n] = mEndColors[i];
+            mTypes[n] = type;
+            mLaneStarts[n] = lanes;
+            n++;
+            lanes += laneCount;
+        }
+        Arrays.fill(mTargets, n, count, null);
+        Arrays.fill(mProperties, n, count, null);
+        mCount = n;
+        mLaneCount = lanes;
+        mRemovedCount = 0;
+    }
+}
@@ -104,6 +104,9 @@ public class AnimationHandler {
      * @return true if they have passed the initial delay or have no delay, false otherwise.
      */
     private boolean isCallbackDue(FrameCallback callback, long currentTime) {
+        if (mDelayedStartTime.isEmpty()) {
+            return true;
+        }
         long startTime = mDelayedStartTime.getLong(callback);
         if (startTime == 0) {
             return true;
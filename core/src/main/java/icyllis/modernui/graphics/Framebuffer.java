@@ -94,6 +94,16 @@ public final class Framebuffer implements AutoCloseable {
         mAttachments.put(attachmentPoint, texture);
     }
 
+    /**
+     * Attaches a texture owned by the caller, the texture is initialized with
+     * the size of this framebuffer, and it will be resized and deleted with this.
+     */
+    public void attachTexture(int attachmentPoint, @Nonnull Texture2D texture, int internalFormat) {
+        texture.init(internalFormat, mWidth, mHeight, 0);
+        glNamedFramebufferTexture(get(), attachmentPoint, texture.get(), 0);
+        mAttachments.put(attachmentPoint, texture);
+    }
+
     public void attachRenderbuffer(int attachmentPoint, int internalFormat) {
         Renderbuffer renderbuffer = new Renderbuffer();
         renderbuffer.init(internalFormat, mWidth, mHeight, 0);
@@ -116,11 +126,14 @@ public final class Framebuffer implements AutoCloseable {
     }
 
     /**
-     * Reallocate all attachments to the new size, if changed.
+     * Reallocate all attachments to the new size, if changed. The contents
+     * of the attachments are undefined after reallocation.
+     *
+     * @return true if the size changed
      */
-    public void resize(int width, int height) {
+    public boolean resize(int width, int height) {
         if (mWidth == width && mHeight == height) {
-            return;
+            return false;
         }
         mWidth = width;
         mHeight = height;
@@ -138,6 +151,7 @@ public final class Framebuffer implements AutoCloseable {
                 glNamedFramebufferRenderbuffer(get(), entry.getIntKey(), GL_RENDERBUFFER, renderbuffer.get());
             }
         }
+        return true;
     }
 
     /**
@@ -23,18 +23,21 @@ import icyllis.modernui.annotation.RenderThread;
 import icyllis.modernui.graphics.shader.Shader;
 import icyllis.modernui.graphics.shader.ShaderManager;
 import icyllis.modernui.graphics.texture.Texture2D;
+import icyllis.modernui.graphics.vertex.StreamBuffer;
 import icyllis.modernui.graphics.vertex.VertexAttrib;
 import icyllis.modernui.graphics.vertex.VertexFormat;
 import icyllis.modernui.math.MathUtil;
 import icyllis.modernui.math.Matrix4;
 import icyllis.modernui.math.Rect;
 import icyllis.modernui.math.RectF;
+import icyllis.modernui.platform.FrameProfiler;
 import icyllis.modernui.platform.RenderCore;
 import icyllis.modernui.util.Pool;
 import icyllis.modernui.util.Pools;
+import it.unimi.dsi.fastutil.floats.FloatArrayList;
+import it.unimi.dsi.fastutil.floats.FloatList;
 import it.unimi.dsi.fastutil.ints.IntArrayList;
 import it.unimi.dsi.fastutil.ints.IntList;
-import org.lwjgl.system.MemoryUtil;
 
 import javax.annotation.Nonnull;
 import javax.annotation.concurrent.NotThreadSafe;
@@ -43,6 +46,7 @@ import java.util.ArrayDeque;
 import java.util.ArrayList;
 import java.util.Deque;
 import java.util.List;
+import java.util.concurrent.TimeUnit;
 
 import static icyllis.modernui.graphics.GLWrapper.*;
 
@@ -57,6 +61,11 @@ import static icyllis.modernui.graphics.GLWrapper.*;
  * Here, drawing means recording on UI thread (or synchronized), and rendering
  * means calling OpenGL draw functions on the render thread.
  * <p>
+ * Recorded data is double-buffered in frame packets, the UI thread records the next
+ * frame while the render thread is rendering the previous one. A packet is handed to
+ * the render thread by {@link #submitFrame(Rect)}, a frame that the render thread
+ * hasn't taken is replaced by the newer one, so the UI thread never waits for long.
+ * <p>
  * The color buffer drawn to must be index 0, and stencil buffer must be 8-bit.
  */
 @NotThreadSafe
@@ -70,26 +79,28 @@ public final class GLCanvas extends Canvas {
 
     private static final Matrix4 IDENTITY_MAT = Matrix4.identity();
 
+    // the maximum time to wait for the packet being rendered, then the frame is dropped
+    private static final long SUBMIT_TIMEOUT_NANOS = TimeUnit.MILLISECONDS.toNanos(100);
+
     /**
      * Uniform block binding points
      */
     public static final int MATRIX_BLOCK_BINDING = 0;
-    public static final int ROUND_RECT_BINDING = 1;
-    public static final int CIRCLE_BINDING = 2;
-    public static final int ARC_BINDING = 3;
 
     /**
      * Vertex buffer binding points
      */
-    public static final int GENERIC_BINDING = 0;
+    public static final int GENERIC_BINDING = 0; // unused, there is no per-vertex data
     public static final int INSTANCED_BINDING = 1;
 
     /**
-     * Vertex attributes
+     * Vertex attributes, all primitives are quads and each quad is an instance,
+     * the four vertices are generated from the instance bounds in vertex shader
      */
     public static final VertexAttrib POS;
     public static final VertexAttrib COLOR;
     public static final VertexAttrib UV;
+    public static final VertexAttrib PAINT;
     public static final VertexAttrib MODEL_VIEW;
 
     /**
@@ -125,22 +136,32 @@ public final class GLCanvas extends Canvas {
     public static final int DRAW_ARC_OUTLINE = 9;
     public static final int DRAW_CLIP_PUSH = 10;
     public static final int DRAW_CLIP_POP = 11;
+    public static final int DRAW_LAYER_PUSH = 12;
+    public static final int DRAW_LAYER_POP = 13;
 
     /**
      * Uniform block sizes, use std140 layout
      */
     public static final int PROJECTION_UNIFORM_SIZE = 64;
-    public static final int ROUND_RECT_UNIFORM_SIZE = 28;
-    public static final int CIRCLE_UNIFORM_SIZE = 24;
-    public static final int ARC_UNIFORM_SIZE = 32;
+
+    /**
+     * Instance data sizes in bytes, including the paint data (2 vec4) that
+     * replaces per-draw uniform blocks
+     */
+    public static final int PAINT_DATA_SIZE = 32;
+    public static final int POS_COLOR_INSTANCE_SIZE;
+    public static final int POS_COLOR_TEX_INSTANCE_SIZE;
 
     static {
-        POS = new VertexAttrib(GENERIC_BINDING, VertexAttrib.Src.FLOAT, VertexAttrib.Dst.VEC2, false);
-        COLOR = new VertexAttrib(GENERIC_BINDING, VertexAttrib.Src.UBYTE, VertexAttrib.Dst.VEC4, true);
-        UV = new VertexAttrib(GENERIC_BINDING, VertexAttrib.Src.FLOAT, VertexAttrib.Dst.VEC2, false);
+        POS = new VertexAttrib(INSTANCED_BINDING, VertexAttrib.Src.FLOAT, VertexAttrib.Dst.VEC4, false);
+        COLOR = new VertexAttrib(INSTANCED_BINDING, VertexAttrib.Src.UBYTE, VertexAttrib.Dst.MAT4, true);
+        UV = new VertexAttrib(INSTANCED_BINDING, VertexAttrib.Src.FLOAT, VertexAttrib.Dst.VEC4, false);
+        PAINT = new VertexAttrib(INSTANCED_BINDING, VertexAttrib.Src.FLOAT, VertexAttrib.Dst.MAT2X4, false);
         MODEL_VIEW = new VertexAttrib(INSTANCED_BINDING, VertexAttrib.Src.FLOAT, VertexAttrib.Dst.MAT4, false);
-        POS_COLOR = new VertexFormat(POS, COLOR, MODEL_VIEW);
-        POS_COLOR_TEX = new VertexFormat(POS, COLOR, UV, MODEL_VIEW);
+        POS_COLOR = new VertexFormat(POS, COLOR, PAINT, MODEL_VIEW);
+        POS_COLOR_TEX = new VertexFormat(POS, COLOR, UV, PAINT, MODEL_VIEW);
+        POS_COLOR_INSTANCE_SIZE = POS_COLOR.getBindingSize(INSTANCED_BINDING);
+        POS_COLOR_TEX_INSTANCE_SIZE = POS_COLOR_TEX.getBindingSize(INSTANCED_BINDING);
     }
 
 
@@ -148,44 +169,45 @@ public final class GLCanvas extends Canvas {
     private final Deque<Matrix4> mMatrixStack = new ArrayDeque<>();
     private final Deque<Clip> mClipStack = new ArrayDeque<>();
 
-    // recorded commands
-    private final IntList mDrawStates = new IntArrayList();
+    // the packet being recorded on UI thread, and the packet being rendered on render thread
+    private FramePacket mRecording = new FramePacket();
+    private FramePacket mRendering;
+
+    // the packet waiting for rendering, and the packet can be recorded next, guarded by mPacketLock
+    private FramePacket mSubmitted;
+    private FramePacket mFree = new FramePacket();
+    private final Object mPacketLock = new Object();
 
+    // commands before this index are never merged, they may belong to a render node
+    private int mMergeBarrier;
 
-    // start - 3 vertex buffer objects
-    private int mPosColorVBO = INVALID_ID;
-    private ByteBuffer mPosColorData = MemoryUtil.memAlloc(1024);
-    private boolean mRecreatePosColor = true;
+    // render nodes being recorded, instance data goes to the innermost one
+    private final Deque<RenderNode> mRecordingNodes = new ArrayDeque<>();
 
-    private int mPosColorTexVBO = INVALID_ID;
-    private ByteBuffer mPosColorTexData = MemoryUtil.memAlloc(1024);
-    private boolean mRecreatePosColorTex = true;
+    // layers being rendered, and the save count before each one
+    private final Deque<Layer> mRenderingLayers = new ArrayDeque<>();
+    private final IntList mLayerSaveCounts = new IntArrayList();
+    private final FloatList mLayerAlphas = new FloatArrayList();
 
-    private int mModelViewVBO = INVALID_ID;
-    private ByteBuffer mModelViewData = MemoryUtil.memAlloc(1024);
-    private boolean mRecreateModelView = true;
-    // end
+    // multiplied into the alpha of paint colors, see setAlphaMultiplier()
+    private float mAlpha = 1;
 
 
     // the universal uniform block
     private final int mProjectionUBO;
-
-    // the data used for updating the uniform blocks
-    private ByteBuffer mUniformData = MemoryUtil.memAlloc(1024);
-    private final int mRoundRectUBO;
-    private final int mCircleUBO;
-    private final int mArcUBO;
+    // the projection of the default target, restored after layers
+    private final Matrix4 mProjection = Matrix4.identity();
 
     // used in rendering, local states
     private int mCurrVertexArray;
     private int mCurrProgram;
 
-    // using textures of draw states, in the order of calling
-    private final List<Texture2D> mTextures = new ArrayList<>();
-
-    // absolute value presents the reference value, and sign represents whether to
-    // update the stencil buffer (positive = update, or just change stencil func)
-    private final IntList mClipDepths = new IntArrayList();
+    // framebuffer, viewport(4), scissor, stencil reference and projection size(2) of
+    // outer targets, in rendering, the projection size of the default target is (0,0)
+    private final IntList mLayerStack = new IntArrayList();
+    private int mProjectionWidth;
+    private int mProjectionHeight;
+    private final int[] mTmpViewport = new int[4];
 
     private final Rect mTmpRect = new Rect();
     private final RectF mTmpRectF = new RectF();
@@ -196,15 +218,6 @@ public final class GLCanvas extends Canvas {
         mProjectionUBO = glCreateBuffers();
         glNamedBufferStorage(mProjectionUBO, PROJECTION_UNIFORM_SIZE, GL_DYNAMIC_STORAGE_BIT | GL_MAP_WRITE_BIT);
 
-        mRoundRectUBO = glCreateBuffers();
-        glNamedBufferStorage(mRoundRectUBO, ROUND_RECT_UNIFORM_SIZE, GL_DYNAMIC_STORAGE_BIT);
-
-        mCircleUBO = glCreateBuffers();
-        glNamedBufferStorage(mCircleUBO, CIRCLE_UNIFORM_SIZE, GL_DYNAMIC_STORAGE_BIT);
-
-        mArcUBO = glCreateBuffers();
-        glNamedBufferStorage(mArcUBO, ARC_UNIFORM_SIZE, GL_DYNAMIC_STORAGE_BIT);
-
         mMatrixStack.push(Matrix4.identity());
         mClipStack.push(new Clip());
 
@@ -266,6 +279,23 @@ public final class GLCanvas extends Canvas {
     @RenderThread
     public void setProjection(@Nonnull Matrix4 projection) {
         RenderCore.checkRenderThread();
+        mProjection.set(projection);
+        mProjectionWidth = 0;
+        mProjectionHeight = 0;
+        uploadProjection(projection);
+    }
+
+    // the projection of a layer of the given content size, or the default one if (0,0)
+    private void setLayerProjection(int width, int height) {
+        if (mProjectionWidth == width && mProjectionHeight == height) {
+            return;
+        }
+        mProjectionWidth = width;
+        mProjectionHeight = height;
+        uploadProjection(width == 0 ? mProjection : Matrix4.makeOrthographic(width, -height, 0, 2000));
+    }
+
+    private void uploadProjection(@Nonnull Matrix4 projection) {
         ByteBuffer buffer = glMapNamedBuffer(mProjectionUBO, GL_WRITE_ONLY);
         if (buffer == null) {
             throw new IllegalStateException("You don't have GL_MAP_WRITE_BIT bit flag");
@@ -275,7 +305,7 @@ public final class GLCanvas extends Canvas {
     }
 
     /**
-     * Resets the clip bounds and matrix. This is required before drawing.
+     * Resets the clip bounds, matrix and alpha multiplier. This is required before drawing.
      *
      * @param width  the width in pixels
      * @param height the height in pixels
@@ -285,6 +315,37 @@ public final class GLCanvas extends Canvas {
         Clip clip = getClip();
         clip.mBounds.set(0, 0, width, height);
         clip.mDepth = 0;
+        mAlpha = 1;
+    }
+
+    /**
+     * Sets the alpha multiplier of paint colors in subsequent draw calls. This is an
+     * alternative to a layer for translucent content that doesn't overlap itself.
+     * It's not affected by save() and restore(), the caller should restore the
+     * previous value.
+     *
+     * @param alpha the alpha multiplier, 0..1
+     */
+    public void setAlphaMultiplier(float alpha) {
+        mAlpha = Math.max(0, Math.min(1, alpha));
+    }
+
+    /**
+     * Returns the alpha multiplier of paint colors, 1 by default.
+     *
+     * @return the alpha multiplier, 0..1
+     */
+    public float getAlphaMultiplier() {
+        return mAlpha;
+    }
+
+    // apply the alpha multiplier
+    private int modulateColor(int color) {
+        if (mAlpha >= 1) {
+            return color;
+        }
+        final int alpha = (int) ((color >>> 24) * mAlpha + 0.5f);
+        return (color & 0xFFFFFF) | (alpha << 24);
     }
 
     private void bindVertexArray(@Nonnull VertexFormat format) {
@@ -303,22 +364,159 @@ public final class GLCanvas extends Canvas {
         }
     }
 
+    // instances may be split into multiple pages of the stream
+    private void drawInstanced(@Nonnull Shader shader, @Nonnull VertexFormat format,
+                               @Nonnull StreamBuffer stream, int first, int count) {
+        bindVertexArray(format);
+        useProgram(shader);
+        final int capacity = stream.getPageCapacity();
+        while (count > 0) {
+            int base = stream.bind(format, INSTANCED_BINDING, first);
+            int n = Math.min(count, capacity - base);
+            glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, n, base);
+            FrameProfiler.count(FrameProfiler.DRAW_CALLS, 1);
+            FrameProfiler.count(FrameProfiler.INSTANCES, n);
+            first += n;
+            count -= n;
+        }
+    }
+
+    /**
+     * Hands the recorded frame to the render thread, and continues recording the
+     * next frame into another packet. If the render thread hasn't taken the frame
+     * submitted before, that frame is replaced by this one. The UI thread waits only
+     * if the render thread is rendering, and the frame is dropped if it takes too long,
+     * then it should be drawn again later.
+     *
+     * @param dirty the region of the frame to redraw, in pixels
+     * @return true if the frame is submitted, false if it is dropped
+     */
+    public boolean submitFrame(@Nonnull Rect dirty) {
+        if (getSaveCount() != 1) {
+            throw new IllegalStateException("Unbalanced save()/restore() pair");
+        }
+        if (!mRecordingNodes.isEmpty()) {
+            throw new IllegalStateException("Render node recording not ended");
+        }
+        if (!mRenderingLayers.isEmpty()) {
+            throw new IllegalStateException("Layer rendering not ended");
+        }
+        final FramePacket packet = mRecording;
+        packet.mDirty.set(dirty);
+        FramePacket next = null;
+        boolean stale = false;
+        boolean interrupted = false;
+        synchronized (mPacketLock) {
+            long remaining = SUBMIT_TIMEOUT_NANOS;
+            final long deadline = System.nanoTime() + remaining;
+            while (true) {
+                if (mFree != null) {
+                    next = mFree;
+                    mFree = null;
+                    break;
+                }
+                if (mSubmitted != null) {
+                    // the render thread didn't take the last frame, replace it, unless
+                    // it renders layers, this frame may draw them without rendering again
+                    if (mSubmitted.mLayers.isEmpty()) {
+                        next = mSubmitted;
+                        stale = true;
+                        packet.mDirty.union(next.mDirty);
+                    }
+                    break;
+                }
+                // the other packet is being rendered, it's given back soon
+                if (remaining <= 0) {
+                    break;
+                }
+                try {
+                    TimeUnit.NANOSECONDS.timedWait(mPacketLock, remaining);
+                } catch (InterruptedException e) {
+                    interrupted = true;
+                    break;
+                }
+                remaining = deadline - System.nanoTime();
+            }
+            if (next != null) {
+                mSubmitted = packet;
+            }
+        }
+        mMergeBarrier = 0;
+        if (interrupted) {
+            // keep it for the caller
+            Thread.currentThread().interrupt();
+        }
+        if (next == null) {
+            packet.discard();
+            return false;
+        }
+        if (stale) {
+            next.discard();
+        }
+        mRecording = next;
+        return true;
+    }
+
+    /**
+     * Takes the frame submitted by the UI thread, if any. Then {@link #render()}
+     * must be called to render it.
+     *
+     * @param dirty the region of the frame to redraw, in pixels
+     * @return true if there's a new frame, false if the contents of last frame can be kept
+     */
+    @RenderThread
+    public boolean beginFrame(@Nonnull Rect dirty) {
+        RenderCore.checkRenderThread();
+        if (mRendering != null) {
+            throw new IllegalStateException("Last frame is not rendered");
+        }
+        final FramePacket packet;
+        synchronized (mPacketLock) {
+            packet = mSubmitted;
+            mSubmitted = null;
+        }
+        if (packet == null) {
+            return false;
+        }
+        dirty.set(packet.mDirty);
+        mRendering = packet;
+        return true;
+    }
+
+    /**
+     * Renders the frame taken by {@link #beginFrame(Rect)}, then the packet is given
+     * back to the UI thread for recording.
+     */
     @RenderThread
     public void render() {
         RenderCore.checkRenderThread();
-        if (mDrawStates.isEmpty()) {
+        final FramePacket packet = mRendering;
+        if (packet == null) {
             return;
         }
-        if (getSaveCount() != 1) {
-            throw new IllegalStateException("Unbalanced save()/restore() pair");
+        mRendering = null;
+        if (!packet.mDrawStates.isEmpty()) {
+            render(packet);
+        }
+        for (Image.Source source : packet.mSources) {
+            source.release();
+        }
+        packet.mSources.clear();
+        synchronized (mPacketLock) {
+            mFree = packet;
+            mPacketLock.notifyAll();
         }
-        uploadBuffers();
+    }
+
+    private void render(@Nonnull FramePacket packet) {
+        FrameProfiler.count(FrameProfiler.INSTANCE_BYTES,
+                (long) packet.mPosColorStream.getCount() * packet.mPosColorStream.getStride() +
+                        (long) packet.mPosColorTexStream.getCount() * packet.mPosColorTexStream.getStride());
+        packet.mPosColorStream.flush();
+        packet.mPosColorTexStream.flush();
 
         // uniform bindings are globally shared, we must re-bind before we use them
         glBindBufferBase(GL_UNIFORM_BUFFER, MATRIX_BLOCK_BINDING, mProjectionUBO);
-        glBindBufferBase(GL_UNIFORM_BUFFER, ROUND_RECT_BINDING, mRoundRectUBO);
-        glBindBufferBase(GL_UNIFORM_BUFFER, CIRCLE_BINDING, mCircleUBO);
-        glBindBufferBase(GL_UNIFORM_BUFFER, ARC_BINDING, mArcUBO);
 
         glStencilFuncSeparate(GL_FRONT, GL_EQUAL, 0, 0xff);
         glStencilMaskSeparate(GL_FRONT, 0xff);
@@ -326,235 +524,437 @@ public final class GLCanvas extends Canvas {
         mCurrVertexArray = 0;
         mCurrProgram = 0;
 
-        mUniformData.flip();
-
-        long uniformDataPtr = MemoryUtil.memAddress(mUniformData);
-
-        // base instance
-        int instance = 0;
-        // generic array index
-        int posColorIndex = 0;
-        int posColorTexIndex = 0;
+        // base instance of each instanced array
+        int posColorInstance = 0;
+        int posColorTexInstance = 0;
         // textures
         int textureIndex = 0;
         int clipIndex = 0;
+        int layerIndex = 0;
         int depth;
+        int stencilRef = 0;
 
-        for (int draw : mDrawStates) {
+        final IntList states = packet.mDrawStates;
+        final IntList counts = packet.mDrawCounts;
+        for (int i = 0, e = states.size(); i < e; i++) {
+            final int draw = states.getInt(i);
+            final int count = counts.getInt(i);
             switch (draw) {
                 case DRAW_RECT:
-                    bindVertexArray(POS_COLOR);
-                    useProgram(COLOR_FILL);
-                    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, posColorIndex, 4, 1, instance);
-                    posColorIndex += 4;
+                    drawInstanced(COLOR_FILL, POS_COLOR, packet.mPosColorStream, posColorInstance, count);
+                    posColorInstance += count;
                     break;
 
                 case DRAW_ROUND_RECT:
-                    bindVertexArray(POS_COLOR);
-                    useProgram(ROUND_RECT_FILL);
-                    nglNamedBufferSubData(mRoundRectUBO, 0, ROUND_RECT_UNIFORM_SIZE, uniformDataPtr);
-                    uniformDataPtr += ROUND_RECT_UNIFORM_SIZE;
-                    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, posColorIndex, 4, 1, instance);
-                    posColorIndex += 4;
+                    drawInstanced(ROUND_RECT_FILL, POS_COLOR, packet.mPosColorStream, posColorInstance, count);
+                    posColorInstance += count;
                     break;
 
                 case DRAW_ROUND_RECT_OUTLINE:
-                    bindVertexArray(POS_COLOR);
-                    useProgram(ROUND_RECT_STROKE);
-                    nglNamedBufferSubData(mRoundRectUBO, 0, ROUND_RECT_UNIFORM_SIZE, uniformDataPtr);
-                    uniformDataPtr += ROUND_RECT_UNIFORM_SIZE;
-                    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, posColorIndex, 4, 1, instance);
-                    posColorIndex += 4;
+                    drawInstanced(ROUND_RECT_STROKE, POS_COLOR, packet.mPosColorStream, posColorInstance, count);
+                    posColorInstance += count;
                     break;
 
                 case DRAW_ROUND_IMAGE:
-                    bindVertexArray(POS_COLOR_TEX);
-                    useProgram(ROUND_RECT_TEX);
-                    nglNamedBufferSubData(mRoundRectUBO, 0, ROUND_RECT_UNIFORM_SIZE, uniformDataPtr);
-                    uniformDataPtr += ROUND_RECT_UNIFORM_SIZE;
-                    glBindTextureUnit(0, mTextures.get(textureIndex).get());
+                    glBindTextureUnit(0, packet.mTextures.get(textureIndex).get());
                     textureIndex++;
-                    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, posColorTexIndex, 4, 1, instance);
-                    posColorTexIndex += 4;
+                    drawInstanced(ROUND_RECT_TEX, POS_COLOR_TEX, packet.mPosColorTexStream, posColorTexInstance, count);
+                    posColorTexInstance += count;
                     break;
 
                 case DRAW_IMAGE:
-                    bindVertexArray(POS_COLOR_TEX);
-                    useProgram(COLOR_TEX);
-                    glBindTextureUnit(0, mTextures.get(textureIndex).get());
+                    glBindTextureUnit(0, packet.mTextures.get(textureIndex).get());
                     textureIndex++;
-                    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, posColorTexIndex, 4, 1, instance);
-                    posColorTexIndex += 4;
+                    drawInstanced(COLOR_TEX, POS_COLOR_TEX, packet.mPosColorTexStream, posColorTexInstance, count);
+                    posColorTexInstance += count;
                     break;
 
                 case DRAW_CIRCLE:
-                    bindVertexArray(POS_COLOR);
-                    useProgram(CIRCLE_FILL);
-                    nglNamedBufferSubData(mCircleUBO, 0, CIRCLE_UNIFORM_SIZE, uniformDataPtr);
-                    uniformDataPtr += CIRCLE_UNIFORM_SIZE;
-                    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, posColorIndex, 4, 1, instance);
-                    posColorIndex += 4;
+                    drawInstanced(CIRCLE_FILL, POS_COLOR, packet.mPosColorStream, posColorInstance, count);
+                    posColorInstance += count;
                     break;
 
                 case DRAW_CIRCLE_OUTLINE:
-                    bindVertexArray(POS_COLOR);
-                    useProgram(CIRCLE_STROKE);
-                    nglNamedBufferSubData(mCircleUBO, 0, CIRCLE_UNIFORM_SIZE, uniformDataPtr);
-                    uniformDataPtr += CIRCLE_UNIFORM_SIZE;
-                    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, posColorIndex, 4, 1, instance);
-                    posColorIndex += 4;
+                    drawInstanced(CIRCLE_STROKE, POS_COLOR, packet.mPosColorStream, posColorInstance, count);
+                    posColorInstance += count;
                     break;
 
                 case DRAW_ARC:
-                    bindVertexArray(POS_COLOR);
-                    useProgram(ARC_FILL);
-                    nglNamedBufferSubData(mArcUBO, 0, ARC_UNIFORM_SIZE, uniformDataPtr);
-                    uniformDataPtr += ARC_UNIFORM_SIZE;
-                    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, posColorIndex, 4, 1, instance);
-                    posColorIndex += 4;
+                    drawInstanced(ARC_FILL, POS_COLOR, packet.mPosColorStream, posColorInstance, count);
+                    posColorInstance += count;
                     break;
 
                 case DRAW_ARC_OUTLINE:
-                    bindVertexArray(POS_COLOR);
-                    useProgram(ARC_STROKE);
-                    nglNamedBufferSubData(mArcUBO, 0, ARC_UNIFORM_SIZE, uniformDataPtr);
-                    uniformDataPtr += ARC_UNIFORM_SIZE;
-                    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, posColorIndex, 4, 1, instance);
-                    posColorIndex += 4;
+                    drawInstanced(ARC_STROKE, POS_COLOR, packet.mPosColorStream, posColorInstance, count);
+                    posColorInstance += count;
                     break;
 
                 case DRAW_CLIP_PUSH:
-                    depth = mClipDepths.getInt(clipIndex);
+                    depth = packet.mClipDepths.getInt(clipIndex);
 
                     if (depth >= 0) {
                         glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR);
                         glColorMaski(0, false, false, false, false);
 
-                        bindVertexArray(POS_COLOR);
-                        useProgram(COLOR_FILL);
-                        glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, posColorIndex, 4, 1, instance);
-                        posColorIndex += 4;
+                        drawInstanced(COLOR_FILL, POS_COLOR, packet.mPosColorStream, posColorInstance, 1);
+                        posColorInstance++;
 
                         glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_KEEP);
                         glColorMaski(0, true, true, true, true);
                     }
 
-                    glStencilFuncSeparate(GL_FRONT, GL_EQUAL, Math.abs(depth), 0xff);
+                    stencilRef = Math.abs(depth);
+                    glStencilFuncSeparate(GL_FRONT, GL_EQUAL, stencilRef, 0xff);
                     clipIndex++;
                     break;
 
                 case DRAW_CLIP_POP:
-                    depth = mClipDepths.getInt(clipIndex);
+                    depth = packet.mClipDepths.getInt(clipIndex);
 
                     if (depth >= 0) {
                         glStencilFuncSeparate(GL_FRONT, GL_LESS, depth, 0xff);
                         glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_REPLACE);
                         glColorMaski(0, false, false, false, false);
 
-                        bindVertexArray(POS_COLOR);
-                        useProgram(COLOR_FILL);
-                        glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, posColorIndex, 4, 1, instance);
-                        posColorIndex += 4;
+                        drawInstanced(COLOR_FILL, POS_COLOR, packet.mPosColorStream, posColorInstance, 1);
+                        posColorInstance++;
 
                         glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_KEEP);
                         glColorMaski(0, true, true, true, true);
                     }
 
-                    glStencilFuncSeparate(GL_FRONT, GL_EQUAL, Math.abs(depth), 0xff);
+                    stencilRef = Math.abs(depth);
+                    glStencilFuncSeparate(GL_FRONT, GL_EQUAL, stencilRef, 0xff);
                     clipIndex++;
                     break;
 
+                case DRAW_LAYER_PUSH: {
+                    final IntList stack = mLayerStack;
+                    final int[] viewport = mTmpViewport;
+                    glGetIntegerv(GL_VIEWPORT, viewport);
+                    stack.add(glGetInteger(GL_DRAW_FRAMEBUFFER_BINDING));
+                    stack.addElements(stack.size(), viewport);
+                    stack.add(glIsEnabled(GL_SCISSOR_TEST) ? 1 : 0);
+                    stack.add(stencilRef);
+                    stack.add(mProjectionWidth);
+                    stack.add(mProjectionHeight);
+
+                    final int data = layerIndex * 4;
+                    final int width = packet.mLayerData.getInt(data + 2);
+                    final int height = packet.mLayerData.getInt(data + 3);
+                    glDisable(GL_SCISSOR_TEST);
+                    packet.mLayers.get(layerIndex).bindDraw(packet.mLayerData.getInt(data),
+                            packet.mLayerData.getInt(data + 1));
+                    // map the content (0,0,w,h) to the bottom-left of the texture, top row at top
+                    glViewport(0, 0, width, height);
+                    setLayerProjection(width, height);
+                    stencilRef = 0;
+                    glStencilFuncSeparate(GL_FRONT, GL_EQUAL, 0, 0xff);
+                    layerIndex++;
+                    break;
+                }
+
+                case DRAW_LAYER_POP: {
+                    final IntList stack = mLayerStack;
+                    int top = stack.size();
+                    final int projectionHeight = stack.getInt(--top);
+                    final int projectionWidth = stack.getInt(--top);
+                    stencilRef = stack.getInt(--top);
+                    final boolean scissor = stack.getInt(--top) != 0;
+                    top -= 4;
+                    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, stack.getInt(top - 1));
+                    glViewport(stack.getInt(top), stack.getInt(top + 1),
+                            stack.getInt(top + 2), stack.getInt(top + 3));
+                    if (scissor) {
+                        glEnable(GL_SCISSOR_TEST);
+                    }
+                    glStencilFuncSeparate(GL_FRONT, GL_EQUAL, stencilRef, 0xff);
+                    setLayerProjection(projectionWidth, projectionHeight);
+                    stack.size(top - 1);
+                    break;
+                }
+
                 default:
                     throw new IllegalStateException("Unexpected draw state " + draw);
             }
-            instance++;
         }
 
-        mTextures.clear();
-        mClipDepths.clear();
-        mUniformData.clear();
-        mDrawStates.clear();
+        packet.mPosColorStream.finish();
+        packet.mPosColorTexStream.finish();
+
+        packet.mTextures.clear();
+        packet.mClipDepths.clear();
+        packet.mLayers.clear();
+        packet.mLayerData.clear();
+        packet.mDrawStates.clear();
+        packet.mDrawCounts.clear();
     }
 
-    private void uploadBuffers() {
-        checkPosColorVBO();
-        mPosColorData.flip();
-        glNamedBufferSubData(mPosColorVBO, 0, mPosColorData);
-        mPosColorData.clear();
+    private ByteBuffer getPosColorBuffer() {
+        final RenderNode node = mRecordingNodes.peek();
+        if (node != null) {
+            return node.nextPosColor(POS_COLOR_INSTANCE_SIZE);
+        }
+        return mRecording.mPosColorStream.next();
+    }
 
-        checkPosColorTexVBO();
-        mPosColorTexData.flip();
-        glNamedBufferSubData(mPosColorTexVBO, 0, mPosColorTexData);
-        mPosColorTexData.clear();
+    private ByteBuffer getPosColorTexBuffer() {
+        final RenderNode node = mRecordingNodes.peek();
+        if (node != null) {
+            return node.nextPosColorTex(POS_COLOR_TEX_INSTANCE_SIZE);
+        }
+        return mRecording.mPosColorTexStream.next();
+    }
 
-        checkModelViewVBO();
-        mModelViewData.flip();
-        glNamedBufferSubData(mModelViewVBO, 0, mModelViewData);
-        mModelViewData.clear();
+    // copy instance data of a node to the parent node or the stream
+    private void putInstances(@Nonnull RenderNode node) {
+        final RenderNode parent = mRecordingNodes.peek();
+        if (node.mPosColorCount > 0) {
+            ByteBuffer data = node.mPosColorData.duplicate().flip();
+            if (parent != null) {
+                parent.putPosColor(data, node.mPosColorCount);
+            } else {
+                mRecording.mPosColorStream.put(data, node.mPosColorCount);
+            }
+        }
+        if (node.mPosColorTexCount > 0) {
+            ByteBuffer data = node.mPosColorTexData.duplicate().flip();
+            if (parent != null) {
+                parent.putPosColorTex(data, node.mPosColorTexCount);
+            } else {
+                mRecording.mPosColorTexStream.put(data, node.mPosColorTexCount);
+            }
+        }
     }
 
-    private void checkPosColorVBO() {
-        if (!mRecreatePosColor)
-            return;
-        mPosColorVBO = glCreateBuffers();
-        glNamedBufferStorage(mPosColorVBO, mPosColorData.capacity(), GL_DYNAMIC_STORAGE_BIT);
-        POS_COLOR.setVertexBuffer(GENERIC_BINDING, mPosColorVBO, 0);
-        mRecreatePosColor = false;
+    /**
+     * Starts recording a render node, all draw calls until {@link #endRecording(RenderNode)}
+     * are recorded into the node as well. Nodes can be nested, and replaying a node while
+     * recording another one is allowed.
+     *
+     * @param node the node to record, previous content will be discarded
+     */
+    public void beginRecording(@Nonnull RenderNode node) {
+        if (node.mRecording) {
+            throw new IllegalStateException("Recording already started");
+        }
+        node.discard();
+        node.mRecording = true;
+        node.mBeginMatrix.set(getMatrix());
+        final Clip clip = getClip();
+        node.mBeginClip.set(clip.mBounds);
+        node.mBeginDepth = clip.mDepth;
+        node.mBeginAlpha = mAlpha;
+        node.mSaveCount = getSaveCount();
+        node.mStateStart = mRecording.mDrawStates.size();
+        node.mTextureStart = mRecording.mTextures.size();
+        node.mSourceStart = mRecording.mSources.size();
+        node.mClipStart = mRecording.mClipDepths.size();
+        node.mLastBarrier = mMergeBarrier;
+        mMergeBarrier = mRecording.mDrawStates.size();
+        mRecordingNodes.push(node);
     }
 
-    private void checkPosColorTexVBO() {
-        if (!mRecreatePosColorTex)
-            return;
-        mPosColorTexVBO = glCreateBuffers();
-        glNamedBufferStorage(mPosColorTexVBO, mPosColorTexData.capacity(), GL_DYNAMIC_STORAGE_BIT);
-        POS_COLOR_TEX.setVertexBuffer(GENERIC_BINDING, mPosColorTexVBO, 0);
-        mRecreatePosColorTex = false;
+    /**
+     * Ends recording a render node. The node is valid only if save() and restore() are
+     * balanced during recording.
+     *
+     * @param node the node being recorded, must be the innermost one
+     */
+    public void endRecording(@Nonnull RenderNode node) {
+        if (mRecordingNodes.peek() != node) {
+            throw new IllegalStateException("Recording not started or not the innermost");
+        }
+        mRecordingNodes.pop();
+        node.mRecording = false;
+        mMergeBarrier = node.mLastBarrier;
+
+        node.mDrawStates.addAll(mRecording.mDrawStates.subList(node.mStateStart, mRecording.mDrawStates.size()));
+        node.mDrawCounts.addAll(mRecording.mDrawCounts.subList(node.mStateStart, mRecording.mDrawCounts.size()));
+        node.mTextures.addAll(mRecording.mTextures.subList(node.mTextureStart, mRecording.mTextures.size()));
+        node.mClipDepths.addAll(mRecording.mClipDepths.subList(node.mClipStart, mRecording.mClipDepths.size()));
+        for (int i = node.mSourceStart, e = mRecording.mSources.size(); i < e; i++) {
+            final Image.Source source = mRecording.mSources.get(i);
+            source.acquire();
+            node.mSources.add(source);
+        }
+
+        node.mEndMatrix.set(getMatrix());
+        final Clip clip = getClip();
+        node.mEndClip.set(clip.mBounds);
+        node.mEndDepth = clip.mDepth;
+        node.mValid = getSaveCount() == node.mSaveCount && !node.mLayerRendered;
+
+        putInstances(node);
     }
 
-    private void checkModelViewVBO() {
-        if (!mRecreateModelView)
-            return;
-        mModelViewVBO = glCreateBuffers();
-        glNamedBufferStorage(mModelViewVBO, mModelViewData.capacity(), GL_DYNAMIC_STORAGE_BIT);
-        // configure
-        POS_COLOR.setVertexBuffer(INSTANCED_BINDING, mModelViewVBO, 0);
-        POS_COLOR_TEX.setVertexBuffer(INSTANCED_BINDING, mModelViewVBO, 0);
-        mRecreateModelView = false;
+    /**
+     * Replays a render node recorded previously. This is possible only if the current
+     * matrix, clip and alpha multiplier are exactly the same as when the node began
+     * recording, because the recorded data is already transformed.
+     *
+     * @param node the node to replay
+     * @return true if replayed, false if the node must be recorded again
+     */
+    public boolean drawRenderNode(@Nonnull RenderNode node) {
+        if (!node.mValid || node.mRecording) {
+            return false;
+        }
+        final Clip clip = getClip();
+        if (clip.mDepth != node.mBeginDepth || node.mBeginAlpha != mAlpha ||
+                !clip.mBounds.equals(node.mBeginClip) || !getMatrix().equals(node.mBeginMatrix)) {
+            return false;
+        }
+        final IntList states = node.mDrawStates;
+        int stateStart = 0;
+        int textureStart = 0;
+        final int last = mRecording.mDrawStates.size() - 1;
+        if (!states.isEmpty() && last >= mMergeBarrier) {
+            // try to merge the first command into the last one
+            final int draw = states.getInt(0);
+            if (draw == mRecording.mDrawStates.getInt(last) && draw != DRAW_CLIP_PUSH && draw != DRAW_CLIP_POP) {
+                if (draw == DRAW_IMAGE || draw == DRAW_ROUND_IMAGE) {
+                    if (mRecording.mTextures.get(mRecording.mTextures.size() - 1) == node.mTextures.get(0)) {
+                        textureStart = 1;
+                        stateStart = 1;
+                    }
+                } else {
+                    stateStart = 1;
+                }
+                if (stateStart == 1) {
+                    mRecording.mDrawCounts.set(last, mRecording.mDrawCounts.getInt(last) + node.mDrawCounts.getInt(0));
+                }
+            }
+        }
+        mRecording.mDrawStates.addAll(states.subList(stateStart, states.size()));
+        mRecording.mDrawCounts.addAll(node.mDrawCounts.subList(stateStart, states.size()));
+        mRecording.mTextures.addAll(node.mTextures.subList(textureStart, node.mTextures.size()));
+        mRecording.mClipDepths.addAll(node.mClipDepths);
+        for (Image.Source source : node.mSources) {
+            useSource(source);
+        }
+
+        putInstances(node);
+
+        getMatrix().set(node.mEndMatrix);
+        clip.mBounds.set(node.mEndClip);
+        clip.mDepth = node.mEndDepth;
+        return true;
     }
 
-    private ByteBuffer getPosColorBuffer() {
-        if (mPosColorData.remaining() < 256) {
-            mPosColorData = MemoryUtil.memRealloc(mPosColorData, mPosColorData.capacity() << 1);
-            mRecreatePosColor = true;
-            ModernUI.LOGGER.debug("Resize position color buffer to {} bytes", mPosColorData.capacity());
+    /**
+     * Starts rendering the content of a layer, all draw calls until {@link #endLayer(Layer)}
+     * go to the layer, with the origin at its top-left, the clip of its bounds and no alpha
+     * multiplier. Layers can be nested. The render node being recorded will be invalid
+     * after this, since rendering a layer is not for replaying.
+     *
+     * @param layer the layer to render, previous content will be discarded
+     */
+    public void beginLayer(@Nonnull Layer layer) {
+        mRenderingLayers.push(layer);
+        mLayerSaveCounts.add(save());
+        mLayerAlphas.add(mAlpha);
+        mAlpha = 1;
+        getMatrix().setIdentity();
+        final Clip clip = getClip();
+        clip.mBounds.set(0, 0, layer.mWidth, layer.mHeight);
+        clip.mDepth = 0;
+        mRecording.mLayers.add(layer);
+        mRecording.mLayerData.add(layer.mBackingWidth);
+        mRecording.mLayerData.add(layer.mBackingHeight);
+        mRecording.mLayerData.add(layer.mWidth);
+        mRecording.mLayerData.add(layer.mHeight);
+        addClipState(DRAW_LAYER_PUSH);
+        for (RenderNode node : mRecordingNodes) {
+            node.mLayerRendered = true;
         }
-        return mPosColorData;
     }
 
-    private ByteBuffer getPosColorTexBuffer() {
-        if (mPosColorTexData.remaining() < 256) {
-            mPosColorTexData = MemoryUtil.memRealloc(mPosColorTexData, mPosColorTexData.capacity() << 1);
-            mRecreatePosColorTex = true;
-            ModernUI.LOGGER.debug("Resize position color tex buffer to {} bytes", mPosColorTexData.capacity());
+    /**
+     * Ends rendering the content of a layer, the canvas state is restored to what it
+     * was before {@link #beginLayer(Layer)}.
+     *
+     * @param layer the layer being rendered, must be the innermost one
+     */
+    public void endLayer(@Nonnull Layer layer) {
+        if (mRenderingLayers.peek() != layer) {
+            throw new IllegalStateException("Layer rendering not started or not the innermost");
         }
-        return mPosColorTexData;
+        final int last = mLayerSaveCounts.size() - 1;
+        if (getSaveCount() != mLayerSaveCounts.getInt(last) + 1) {
+            throw new IllegalStateException("Unbalanced save()/restore() pair");
+        }
+        mRenderingLayers.pop();
+        mLayerSaveCounts.removeInt(last);
+        mAlpha = mLayerAlphas.removeFloat(last);
+        // the stencil of outer target is not changed, so don't restore the clip
+        sMatrixPool.release(mMatrixStack.pop());
+        sClipPool.release(mClipStack.pop());
+        addClipState(DRAW_LAYER_POP);
+        layer.mValid = true;
     }
 
-    private ByteBuffer getModelViewBuffer() {
-        if (mModelViewData.remaining() < 64) {
-            mModelViewData = MemoryUtil.memRealloc(mModelViewData, mModelViewData.capacity() << 1);
-            mRecreateModelView = true;
-            ModernUI.LOGGER.debug("Resize model view buffer to {} bytes", mModelViewData.capacity());
+    /**
+     * Draws the content of a layer at (0,0) with the current matrix, clip and alpha multiplier.
+     *
+     * @param layer the layer to draw, it should be valid
+     * @param alpha the alpha multiplier, 0..255
+     */
+    public void drawLayer(@Nonnull Layer layer, int alpha) {
+        final int width = layer.mWidth;
+        final int height = layer.mHeight;
+        if (alpha <= 0 || quickReject(0, 0, width, height)) {
+            return;
         }
-        return mModelViewData;
+        // the content is at the bottom-left of the texture, and upside down
+        ByteBuffer buffer = putRectColorUV(0, 0, width, height, modulateColor((Math.min(alpha, 255) << 24) | 0xFFFFFF),
+                0, (float) height / layer.mBackingHeight, (float) width / layer.mBackingWidth, 0);
+        buffer.position(buffer.position() + PAINT_DATA_SIZE);
+        getMatrix().get(buffer);
+        addDrawState(DRAW_IMAGE, layer.mTexture);
     }
 
-    private ByteBuffer getUniformBuffer() {
-        if (mUniformData.remaining() < 256) {
-            mUniformData = MemoryUtil.memRealloc(mUniformData, mUniformData.capacity() << 1);
-            ModernUI.LOGGER.debug("Resize universal uniform buffer to {} bytes", mUniformData.capacity());
+    /**
+     * Record a draw command, merge it into the last one if possible. Consecutive
+     * commands of the same type use the same program and vertex array, and their
+     * instances are consecutive in the instanced array, so they can be rendered
+     * with only one instanced draw call.
+     *
+     * @param draw the draw command, must not be clip commands
+     */
+    private void addDrawState(int draw) {
+        final int last = mRecording.mDrawStates.size() - 1;
+        if (last >= mMergeBarrier && mRecording.mDrawStates.getInt(last) == draw) {
+            mRecording.mDrawCounts.set(last, mRecording.mDrawCounts.getInt(last) + 1);
+        } else {
+            mRecording.mDrawStates.add(draw);
+            mRecording.mDrawCounts.add(1);
+        }
+    }
+
+    /**
+     * Record a draw command using a texture, merge it into the last one if it
+     * also uses the same texture.
+     *
+     * @param draw    the draw command
+     * @param texture the texture to bind
+     */
+    private void addDrawState(int draw, @Nonnull Texture2D texture) {
+        final int last = mRecording.mDrawStates.size() - 1;
+        if (last >= mMergeBarrier && mRecording.mDrawStates.getInt(last) == draw &&
+                mRecording.mTextures.get(mRecording.mTextures.size() - 1) == texture) {
+            mRecording.mDrawCounts.set(last, mRecording.mDrawCounts.getInt(last) + 1);
+        } else {
+            mRecording.mDrawStates.add(draw);
+            mRecording.mDrawCounts.add(1);
+            mRecording.mTextures.add(texture);
         }
-        return mUniformData;
+    }
+
+    // clip commands are never merged
+    private void addClipState(int draw) {
+        mRecording.mDrawStates.add(draw);
+        mRecording.mDrawCounts.add(1);
     }
 
     @Nonnull
@@ -633,13 +1033,14 @@ public final class GLCanvas extends Canvas {
     // see also clipRect
     private void restoreClip(@Nonnull Rect b) {
         if (b.isEmpty()) {
-            mClipDepths.add(-getClip().mDepth);
+            mRecording.mClipDepths.add(-getClip().mDepth);
         } else {
-            putRectColor(b.left, b.top, b.right, b.bottom, ~0);
-            IDENTITY_MAT.get(getModelViewBuffer());
-            mClipDepths.add(getClip().mDepth);
+            ByteBuffer buffer = putRectColor(b.left, b.top, b.right, b.bottom, ~0);
+            buffer.position(buffer.position() + PAINT_DATA_SIZE);
+            IDENTITY_MAT.get(buffer);
+            mRecording.mClipDepths.add(getClip().mDepth);
         }
-        mDrawStates.add(DRAW_CLIP_POP);
+        addClipState(DRAW_CLIP_POP);
     }
 
     @Override
@@ -665,6 +1066,60 @@ public final class GLCanvas extends Canvas {
         getMatrix().multiply(matrix);
     }
 
+    /**
+     * Recorded data of a frame, owned by the UI thread while recording, and by the
+     * render thread while rendering.
+     */
+    private static final class FramePacket {
+
+        // recorded commands, consecutive draws of the same type (and the same texture)
+        // are merged into one command, and the instance count is stored in mDrawCounts
+        private final IntList mDrawStates = new IntArrayList();
+        private final IntList mDrawCounts = new IntArrayList();
+
+        // using textures of draw states, in the order of calling
+        private final List<Texture2D> mTextures = new ArrayList<>();
+
+        // image sources drawn in this frame, each holds a usage until rendered, so
+        // their textures are not deleted while the frame is in flight
+        private final List<Image.Source> mSources = new ArrayList<>();
+
+        // absolute value presents the reference value, and sign represents whether to
+        // update the stencil buffer (positive = update, or just change stencil func)
+        private final IntList mClipDepths = new IntArrayList();
+
+        // layers to render, and their backing width, backing height, content width and content height
+        private final List<Layer> mLayers = new ArrayList<>();
+        private final IntList mLayerData = new IntArrayList();
+
+        // 2 instanced arrays, persistently mapped and written directly
+        private final StreamBuffer mPosColorStream = new StreamBuffer(POS_COLOR_INSTANCE_SIZE, 1024);
+        private final StreamBuffer mPosColorTexStream = new StreamBuffer(POS_COLOR_TEX_INSTANCE_SIZE, 256);
+
+        // the region to redraw
+        private final Rect mDirty = new Rect();
+
+        // drops the recorded frame without rendering it, on UI thread, then the packet
+        // can be recorded again, layers rendered in this frame are out of date
+        private void discard() {
+            for (Image.Source source : mSources) {
+                source.release();
+            }
+            mSources.clear();
+            for (Layer layer : mLayers) {
+                layer.invalidate();
+            }
+            mTextures.clear();
+            mClipDepths.clear();
+            mLayers.clear();
+            mLayerData.clear();
+            mDrawStates.clear();
+            mDrawCounts.clear();
+            mPosColorStream.discard();
+            mPosColorTexStream.discard();
+        }
+    }
+
     private static final class Clip {
 
         // this is only the maximum bounds transformed by model view matrix
@@ -713,15 +1168,16 @@ public final class GLCanvas extends Canvas {
         int depth = ++clip.mDepth;
         if (!intersects) {
             // empty
-            mClipDepths.add(-depth);
+            mRecording.mClipDepths.add(-depth);
             clip.mBounds.setEmpty();
         } else {
             // updating stencil must have a color
-            putRectColor(left, top, right, bottom, ~0);
-            matrix.get(getModelViewBuffer());
-            mClipDepths.add(depth);
+            ByteBuffer buffer = putRectColor(left, top, right, bottom, ~0);
+            buffer.position(buffer.position() + PAINT_DATA_SIZE);
+            matrix.get(buffer);
+            mRecording.mClipDepths.add(depth);
         }
-        mDrawStates.add(DRAW_CLIP_PUSH);
+        addClipState(DRAW_CLIP_PUSH);
         return intersects;
     }
 
@@ -741,96 +1197,72 @@ public final class GLCanvas extends Canvas {
         return !Rect.intersects(clip, test);
     }
 
-    private void putRectColor(float left, float top, float right, float bottom, @Nonnull Paint paint) {
+    // instance data: bounds, colors, [uv], paint data, model view
+    // return the buffer to continue writing paint data and model view
+    @Nonnull
+    private ByteBuffer putRectColor(float left, float top, float right, float bottom, @Nonnull Paint paint) {
         if (paint.isMultiColor()) {
             ByteBuffer buffer = getPosColorBuffer();
             int[] colors = paint.getColors();
-
-            // CCW
-            int color = colors[3];
-            byte r = (byte) ((color >> 16) & 0xff);
-            byte g = (byte) ((color >> 8) & 0xff);
-            byte b = (byte) (color & 0xff);
-            byte a = (byte) (color >>> 24);
-            buffer.putFloat(left)
-                    .putFloat(bottom)
-                    .put(r).put(g).put(b).put(a);
-
-            color = colors[2];
-            r = (byte) ((color >> 16) & 0xff);
-            g = (byte) ((color >> 8) & 0xff);
-            b = (byte) (color & 0xff);
-            a = (byte) (color >>> 24);
-            buffer.putFloat(right)
-                    .putFloat(bottom)
-                    .put(r).put(g).put(b).put(a);
-
-            color = colors[0];
-            r = (byte) ((color >> 16) & 0xff);
-            g = (byte) ((color >> 8) & 0xff);
-            b = (byte) (color & 0xff);
-            a = (byte) (color >>> 24);
             buffer.putFloat(left)
                     .putFloat(top)
-                    .put(r).put(g).put(b).put(a);
-
-            color = colors[1];
-            r = (byte) ((color >> 16) & 0xff);
-            g = (byte) ((color >> 8) & 0xff);
-            b = (byte) (color & 0xff);
-            a = (byte) (color >>> 24);
-            buffer.putFloat(right)
-                    .putFloat(top)
-                    .put(r).put(g).put(b).put(a);
+                    .putFloat(right)
+                    .putFloat(bottom);
+            // CCW, left-bottom, right-bottom, left-top, right-top
+            putColor(buffer, modulateColor(colors[3]));
+            putColor(buffer, modulateColor(colors[2]));
+            putColor(buffer, modulateColor(colors[0]));
+            putColor(buffer, modulateColor(colors[1]));
+            return buffer;
         } else {
-            putRectColor(left, top, right, bottom, paint.getColor());
+            return putRectColor(left, top, right, bottom, modulateColor(paint.getColor()));
         }
     }
 
-    private void putRectColor(float left, float top, float right, float bottom, int color) {
+    @Nonnull
+    private ByteBuffer putRectColor(float left, float top, float right, float bottom, int color) {
         ByteBuffer buffer = getPosColorBuffer();
+        buffer.putFloat(left)
+                .putFloat(top)
+                .putFloat(right)
+                .putFloat(bottom);
         byte r = (byte) ((color >> 16) & 0xff);
         byte g = (byte) ((color >> 8) & 0xff);
         byte b = (byte) (color & 0xff);
         byte a = (byte) (color >>> 24);
-        // CCW
-        buffer.putFloat(left)
-                .putFloat(bottom)
-                .put(r).put(g).put(b).put(a);
-        buffer.putFloat(right)
-                .putFloat(bottom)
-                .put(r).put(g).put(b).put(a);
-        buffer.putFloat(left)
-                .putFloat(top)
-                .put(r).put(g).put(b).put(a);
-        buffer.putFloat(right)
-                .putFloat(top)
-                .put(r).put(g).put(b).put(a);
+        for (int i = 0; i < 4; i++) {
+            buffer.put(r).put(g).put(b).put(a);
+        }
+        return buffer;
     }
 
-    private void putRectColorUV(float left, float top, float right, float bottom, int color,
-                                float u0, float v0, float u1, float v1) {
+    @Nonnull
+    private ByteBuffer putRectColorUV(float left, float top, float right, float bottom, int color,
+                                      float u0, float v0, float u1, float v1) {
         ByteBuffer buffer = getPosColorTexBuffer();
+        buffer.putFloat(left)
+                .putFloat(top)
+                .putFloat(right)
+                .putFloat(bottom);
         byte r = (byte) ((color >> 16) & 0xff);
         byte g = (byte) ((color >> 8) & 0xff);
         byte b = (byte) (color & 0xff);
         byte a = (byte) (color >>> 24);
-        buffer.putFloat(left)
-                .putFloat(bottom)
-                .put(r).put(g).put(b).put(a)
-                .putFloat(u0).putFloat(v1);
-        buffer.putFloat(right)
-                .putFloat(bottom)
-                .put(r).put(g).put(b).put(a)
-                .putFloat(u1).putFloat(v1);
-        buffer.putFloat(left)
-                .putFloat(top)
-                .put(r).put(g).put(b).put(a)
-                .putFloat(u0).putFloat(v0);
-        buffer.putFloat(right)
-                .putFloat(top)
-                .put(r).put(g).put(b).put(a)
-                .putFloat(u1).putFloat(v0);
+        for (int i = 0; i < 4; i++) {
+            buffer.put(r).put(g).put(b).put(a);
+        }
+        buffer.putFloat(u0)
+                .putFloat(v0)
+                .putFloat(u1)
+                .putFloat(v1);
+        return buffer;
+    }
+
+    private static void putColor(@Nonnull ByteBuffer buffer, int color) {
+        buffer.put((byte) ((color >> 16) & 0xff))
+                .put((byte) ((color >> 8) & 0xff))
+                .put((byte) (color & 0xff))
+                .put((byte) (color >>> 24));
     }
 
     @Override
@@ -857,8 +1289,7 @@ public final class GLCanvas extends Canvas {
 
     private void addArcFill(float cx, float cy, float radius, float middle,
                             float sweepAngle, @Nonnull Paint paint) {
-        putRectColor(cx - radius, cy - radius, cx + radius, cy + radius, paint);
-        ByteBuffer buffer = getUniformBuffer();
+        ByteBuffer buffer = putRectColor(cx - radius, cy - radius, cx + radius, cy + radius, paint);
         buffer.putFloat(radius)
                 .putFloat(Math.min(radius, paint.getSmoothRadius()));
         buffer.position(buffer.position() + 8);
@@ -866,16 +1297,15 @@ public final class GLCanvas extends Canvas {
                 .putFloat(cy);
         buffer.putFloat(middle)
                 .putFloat(sweepAngle);
-        getMatrix().get(getModelViewBuffer());
-        mDrawStates.add(DRAW_ARC);
+        getMatrix().get(buffer);
+        addDrawState(DRAW_ARC);
     }
 
     private void addArcStroke(float cx, float cy, float radius, float middle,
                               float sweepAngle, @Nonnull Paint paint) {
         float half = Math.min(paint.getStrokeWidth() * 0.5f, radius);
         float outer = radius + half;
-        putRectColor(cx - outer, cy - outer, cx + outer, cy + outer, paint);
-        ByteBuffer buffer = getUniformBuffer();
+        ByteBuffer buffer = putRectColor(cx - outer, cy - outer, cx + outer, cy + outer, paint);
         buffer.putFloat(radius)
                 .putFloat(Math.min(half, paint.getSmoothRadius()))
                 .putFloat(half);
@@ -884,8 +1314,8 @@ public final class GLCanvas extends Canvas {
                 .putFloat(cy);
         buffer.putFloat(middle)
                 .putFloat(sweepAngle);
-        getMatrix().get(getModelViewBuffer());
-        mDrawStates.add(DRAW_ARC_OUTLINE);
+        getMatrix().get(buffer);
+        addDrawState(DRAW_ARC_OUTLINE);
     }
 
     @Override
@@ -904,32 +1334,32 @@ public final class GLCanvas extends Canvas {
     }
 
     private void addCircleFill(float cx, float cy, float radius, @Nonnull Paint paint) {
-        putRectColor(cx - radius, cy - radius, cx + radius, cy + radius, paint);
-        ByteBuffer buffer = getUniformBuffer();
+        ByteBuffer buffer = putRectColor(cx - radius, cy - radius, cx + radius, cy + radius, paint);
         // vec4
         buffer.putFloat(radius)
                 .putFloat(Math.min(radius, paint.getSmoothRadius()));
         buffer.position(buffer.position() + 8); // padding
-        // vec2
+        // vec4
         buffer.putFloat(cx)
                 .putFloat(cy);
-        getMatrix().get(getModelViewBuffer());
-        mDrawStates.add(DRAW_CIRCLE);
+        buffer.position(buffer.position() + 8); // padding
+        getMatrix().get(buffer);
+        addDrawState(DRAW_CIRCLE);
     }
 
     private void addCircleStroke(float cx, float cy, float radius, @Nonnull Paint paint) {
         float half = Math.min(paint.getStrokeWidth() * 0.5f, radius);
         float outer = radius + half;
-        putRectColor(cx - outer, cy - outer, cx + outer, cy + outer, paint);
-        ByteBuffer buffer = getUniformBuffer();
+        ByteBuffer buffer = putRectColor(cx - outer, cy - outer, cx + outer, cy + outer, paint);
         buffer.putFloat(radius - half)
                 .putFloat(outer)
                 .putFloat(Math.min(half, paint.getSmoothRadius()));
         buffer.position(buffer.position() + 4); // padding
         buffer.putFloat(cx)
                 .putFloat(cy);
-        getMatrix().get(getModelViewBuffer());
-        mDrawStates.add(DRAW_CIRCLE_OUTLINE);
+        buffer.position(buffer.position() + 8); // padding
+        getMatrix().get(buffer);
+        addDrawState(DRAW_CIRCLE_OUTLINE);
     }
 
     @Override
@@ -971,6 +1401,7 @@ public final class GLCanvas extends Canvas {
             float left = (startX - cx) * cos - (startY - cy) * sin + cx;
             float right = (stopX - cx) * cos - (stopY - cy) * sin + cx;
             if (quickReject(left - t, cy - t, right + t, cy + t)) {
+                restore();
                 return;
             }
             addRoundRectFill(left - t, cy - t, right + t, cy + t, t, 0, paint);
@@ -983,19 +1414,24 @@ public final class GLCanvas extends Canvas {
         if (quickReject(left, top, right, bottom)) {
             return;
         }
-        putRectColor(left, top, right, bottom, paint);
-        getMatrix().get(getModelViewBuffer());
-        mDrawStates.add(DRAW_RECT);
+        ByteBuffer buffer = putRectColor(left, top, right, bottom, paint);
+        buffer.position(buffer.position() + PAINT_DATA_SIZE);
+        getMatrix().get(buffer);
+        addDrawState(DRAW_RECT);
     }
 
     @Override
     public void drawImage(@Nonnull Image image, float left, float top, @Nonnull Paint paint) {
+        if (image.isClosed()) {
+            return;
+        }
         Image.Source source = image.getSource();
-        putRectColorUV(left, top, left + source.width, top + source.height, paint.getColor(),
+        ByteBuffer buffer = putRectColorUV(left, top, left + source.width, top + source.height, modulateColor(paint.getColor()),
                 0, 0, 1, 1);
-        mTextures.add(source.texture);
-        getMatrix().get(getModelViewBuffer());
-        mDrawStates.add(DRAW_IMAGE);
+        buffer.position(buffer.position() + PAINT_DATA_SIZE);
+        getMatrix().get(buffer);
+        addDrawState(DRAW_IMAGE, source.texture);
+        useSource(source);
     }
 
     @Override
@@ -1017,8 +1453,7 @@ public final class GLCanvas extends Canvas {
     private void addRoundRectFill(float left, float top, float right, float bottom,
                                   float radius, int side, @Nonnull Paint paint) {
         float sm = Math.min(radius, paint.getSmoothRadius());
-        putRectColor(left, top, right, bottom, paint);
-        ByteBuffer buffer = getUniformBuffer();
+        ByteBuffer buffer = putRectColor(left, top, right, bottom, paint);
         if ((side & RIGHT) == RIGHT) {
             buffer.putFloat(left);
         } else {
@@ -1041,17 +1476,16 @@ public final class GLCanvas extends Canvas {
         }
         buffer.putFloat(radius)
                 .putFloat(sm);
-        buffer.position(buffer.position() + 4);
-        getMatrix().get(getModelViewBuffer());
-        mDrawStates.add(DRAW_ROUND_RECT);
+        buffer.position(buffer.position() + 8);
+        getMatrix().get(buffer);
+        addDrawState(DRAW_ROUND_RECT);
     }
 
     private void addRoundRectStroke(float left, float top, float right, float bottom,
                                     float radius, int side, @Nonnull Paint paint) {
         float half = Math.min(paint.getStrokeWidth() * 0.5f, radius);
         float sm = Math.min(half, paint.getSmoothRadius());
-        putRectColor(left - half, top - half, right + half, bottom + half, paint);
-        ByteBuffer buffer = getUniformBuffer();
+        ByteBuffer buffer = putRectColor(left - half, top - half, right + half, bottom + half, paint);
         if ((side & RIGHT) == RIGHT) {
             buffer.putFloat(left);
         } else {
@@ -1075,28 +1509,37 @@ public final class GLCanvas extends Canvas {
         buffer.putFloat(radius)
                 .putFloat(sm)
                 .putFloat(half);
-        getMatrix().get(getModelViewBuffer());
-        mDrawStates.add(DRAW_ROUND_RECT_OUTLINE);
+        buffer.position(buffer.position() + 4);
+        getMatrix().get(buffer);
+        addDrawState(DRAW_ROUND_RECT_OUTLINE);
     }
 
     @Override
     public void drawRoundImage(@Nonnull Image image, float left, float top, float radius, @Nonnull Paint paint) {
+        if (image.isClosed()) {
+            return;
+        }
         Image.Source source = image.getSource();
-        putRectColorUV(left, top, left + source.width, top + source.height, paint.getColor(),
+        ByteBuffer buffer = putRectColorUV(left, top, left + source.width, top + source.height, modulateColor(paint.getColor()),
                 0, 0, 1, 1);
         if (radius < 0)
             radius = 0;
-        ByteBuffer buffer = getUniformBuffer();
         buffer.putFloat(left + radius)
                 .putFloat(top + radius)
                 .putFloat(left + source.width - radius)
                 .putFloat(top + source.height - radius);
         buffer.putFloat(radius)
                 .putFloat(Math.min(radius, paint.getSmoothRadius()));
-        buffer.position(buffer.position() + 4);
-        mTextures.add(source.texture);
-        getMatrix().get(getModelViewBuffer());
-        mDrawStates.add(DRAW_ROUND_IMAGE);
+        buffer.position(buffer.position() + 8);
+        getMatrix().get(buffer);
+        addDrawState(DRAW_ROUND_IMAGE, source.texture);
+        useSource(source);
+    }
+
+    // the texture of an image can be deleted only after all recorded draws are discarded or rendered
+    private void useSource(@Nonnull Image.Source source) {
+        source.acquire();
+        mRecording.mSources.add(source);
     }
 
     @Override
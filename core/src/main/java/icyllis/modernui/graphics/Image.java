@@ -20,6 +20,8 @@ package icyllis.modernui.graphics;
 
 import icyllis.modernui.graphics.texture.Texture2D;
 
+import java.util.concurrent.atomic.AtomicInteger;
+
 /**
  * Image is the advanced form of OpenGL 2D texture that can be used for drawing
  * and processing with flexibility.
@@ -27,7 +29,9 @@ import icyllis.modernui.graphics.texture.Texture2D;
 //TODO
 public class Image implements AutoCloseable {
 
-    private final Source mSource;
+    // may be replaced when an async image is loaded
+    private volatile Source mSource;
+    private volatile boolean mClosed;
 
     public Image(Source source) {
         mSource = source;
@@ -37,9 +41,43 @@ public class Image implements AutoCloseable {
         return mSource;
     }
 
+    /**
+     * Replaces the texture source, used by async loading to replace the placeholder.
+     *
+     * @param source the new source
+     */
+    public void setSource(Source source) {
+        mSource = source;
+    }
+
+    /**
+     * Returns the width of the image in pixels, this is 0 if the image is not loaded yet.
+     */
+    public int getWidth() {
+        return mSource.width;
+    }
+
+    /**
+     * Returns the height of the image in pixels, this is 0 if the image is not loaded yet.
+     */
+    public int getHeight() {
+        return mSource.height;
+    }
+
+    /**
+     * Returns whether this image was closed, a closed image draws nothing.
+     */
+    public boolean isClosed() {
+        return mClosed;
+    }
+
+    /**
+     * Declares that this image is no longer used. The texture of an async image can be
+     * deleted after that, once the frames that have drawn it are rendered.
+     */
     @Override
     public void close() {
-
+        mClosed = true;
     }
 
     /**
@@ -51,10 +89,29 @@ public class Image implements AutoCloseable {
         final int width;
         final int height;
 
+        // the number of recorded draws using this, in render nodes and frame packets
+        private final AtomicInteger mUsages = new AtomicInteger();
+
         public Source(Texture2D texture, int width, int height) {
             this.texture = texture;
             this.width = width;
             this.height = height;
         }
+
+        void acquire() {
+            mUsages.incrementAndGet();
+        }
+
+        void release() {
+            mUsages.decrementAndGet();
+        }
+
+        /**
+         * Returns whether any recorded draw uses the texture, it must not be deleted
+         * until this returns false.
+         */
+        public boolean isInUse() {
+            return mUsages.get() != 0;
+        }
     }
 }
@@ -0,0 +1,279 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.graphics;
+
+import icyllis.modernui.ModernUI;
+import icyllis.modernui.annotation.RenderThread;
+import icyllis.modernui.graphics.shader.Shader;
+import icyllis.modernui.graphics.shader.ShaderManager;
+import icyllis.modernui.platform.RenderCore;
+
+import javax.annotation.Nonnull;
+
+import static icyllis.modernui.graphics.GLWrapper.*;
+
+/**
+ * Blurs a texture with progressive downsampling and upsampling (dual Kawase).
+ * Each iteration halves the size, so the cost is about a third of a full screen
+ * pass, and the blur radius roughly doubles per iteration.
+ * <p>
+ * The result is kept in a half size texture, it can be drawn many times by
+ * {@link #draw(int, int, int, float)} until the source is blurred again.
+ * The GL states changed by this class are restored.
+ */
+@RenderThread
+public final class KawaseBlur implements AutoCloseable {
+
+    public static final int MAX_ITERATIONS = 6;
+
+    private static final Shader DOWNSAMPLE = new Shader();
+    private static final Shader UPSAMPLE = new Shader();
+
+    private static boolean sShadersLoaded;
+
+    // level i is (width >> (i + 1), height >> (i + 1))
+    private final Framebuffer[] mLevels = new Framebuffer[MAX_ITERATIONS];
+    private final int[] mLevelWidths = new int[MAX_ITERATIONS];
+    private final int[] mLevelHeights = new int[MAX_ITERATIONS];
+
+    private int mVertexArray;
+    private float mOffset;
+    private boolean mValid;
+
+    // saved states
+    private final int[] mViewport = new int[4];
+    private int mDrawFramebuffer;
+    private int mProgram;
+    private int mBoundVertexArray;
+    private int mActiveTexture;
+    private int mTexture;
+    private boolean mBlend;
+    private boolean mScissor;
+    private boolean mDepthTest;
+
+    public KawaseBlur() {
+        RenderCore.checkRenderThread();
+        if (!sShadersLoaded) {
+            ShaderManager manager = ShaderManager.getInstance();
+            manager.addListener(KawaseBlur::onLoadShaders);
+            onLoadShaders(manager);
+            sShadersLoaded = true;
+        }
+    }
+
+    private static void onLoadShaders(@Nonnull ShaderManager manager) {
+        int blit = manager.getShard(ModernUI.get(), "blit.vert");
+        int down = manager.getShard(ModernUI.get(), "kawase_down.frag");
+        int up = manager.getShard(ModernUI.get(), "kawase_up.frag");
+
+        manager.create(DOWNSAMPLE, blit, down);
+        manager.create(UPSAMPLE, blit, up);
+    }
+
+    /**
+     * Blurs the source texture, the result replaces the last one. Clamp-to-edge wrap
+     * and linear filtering are expected for the source.
+     *
+     * @param texture    the source texture name
+     * @param width      the width of the source in pixels
+     * @param height     the height of the source in pixels
+     * @param iterations the number of downsampling, 1 to {@link #MAX_ITERATIONS}
+     * @param offset     the sampling offset in texels, 1.0 is the standard
+     */
+    public void blur(int texture, int width, int height, int iterations, float offset) {
+        if (DOWNSAMPLE.get() == 0 || UPSAMPLE.get() == 0) {
+            mValid = false;
+            return;
+        }
+        iterations = Math.max(1, Math.min(iterations, MAX_ITERATIONS));
+        // don't go below 1 pixel
+        while (iterations > 1 && ((width >> iterations) == 0 || (height >> iterations) == 0)) {
+            iterations--;
+        }
+        saveStates();
+        glDisable(GL_BLEND);
+        glDisable(GL_SCISSOR_TEST);
+        glDisable(GL_DEPTH_TEST);
+
+        int source = texture;
+        int sourceWidth = width;
+        int sourceHeight = height;
+        DOWNSAMPLE.use();
+        glProgramUniform1f(DOWNSAMPLE.get(), 2, offset);
+        for (int i = 0; i < iterations; i++) {
+            final Framebuffer level = obtainLevel(i, width >> (i + 1), height >> (i + 1));
+            glProgramUniform2f(DOWNSAMPLE.get(), 1, 0.5f / sourceWidth, 0.5f / sourceHeight);
+            pass(source, i);
+            source = level.getAttachedTexture(GL_COLOR_ATTACHMENT0).get();
+            sourceWidth = mLevelWidths[i];
+            sourceHeight = mLevelHeights[i];
+        }
+
+        UPSAMPLE.use();
+        glProgramUniform1f(UPSAMPLE.get(), 2, offset);
+        glProgramUniform1f(UPSAMPLE.get(), 3, 1.0f);
+        for (int i = iterations - 1; i > 0; i--) {
+            glProgramUniform2f(UPSAMPLE.get(), 1, 0.5f / mLevelWidths[i], 0.5f / mLevelHeights[i]);
+            pass(mLevels[i].getAttachedTexture(GL_COLOR_ATTACHMENT0).get(), i - 1);
+        }
+
+        restoreStates();
+        mOffset = offset;
+        mValid = true;
+    }
+
+    /**
+     * Draws the last result to a framebuffer with the final upsampling pass,
+     * blending over the existing content.
+     *
+     * @param framebuffer the target framebuffer name
+     * @param width       the width of the target in pixels
+     * @param height      the height of the target in pixels
+     * @param alpha       the opacity of the blurred image
+     */
+    public void draw(int framebuffer, int width, int height, float alpha) {
+        if (!mValid || alpha <= 0) {
+            return;
+        }
+        saveStates();
+        final int srcRGB = glGetInteger(GL_BLEND_SRC_RGB);
+        final int dstRGB = glGetInteger(GL_BLEND_DST_RGB);
+        final int srcAlpha = glGetInteger(GL_BLEND_SRC_ALPHA);
+        final int dstAlpha = glGetInteger(GL_BLEND_DST_ALPHA);
+        glEnable(GL_BLEND);
+        glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE);
+        glDisable(GL_SCISSOR_TEST);
+        glDisable(GL_DEPTH_TEST);
+
+        UPSAMPLE.use();
+        glProgramUniform1f(UPSAMPLE.get(), 2, mOffset);
+        glProgramUniform1f(UPSAMPLE.get(), 3, Math.min(alpha, 1.0f));
+        glProgramUniform2f(UPSAMPLE.get(), 1, 0.5f / mLevelWidths[0], 0.5f / mLevelHeights[0]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, width, height);
+        glBindTextureUnit(0, mLevels[0].getAttachedTexture(GL_COLOR_ATTACHMENT0).get());
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+        restoreStates();
+    }
+
+    /**
+     * Returns whether there is a result to draw.
+     */
+    public boolean isValid() {
+        return mValid;
+    }
+
+    /**
+     * Marks the result invalid, the source should be blurred again.
+     */
+    public void invalidate() {
+        mValid = false;
+    }
+
+    // draw the source to the level
+    private void pass(int source, int level) {
+        mLevels[level].bindDraw();
+        glViewport(0, 0, mLevelWidths[level], mLevelHeights[level]);
+        glBindTextureUnit(0, source);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    @Nonnull
+    private Framebuffer obtainLevel(int index, int width, int height) {
+        width = Math.max(1, width);
+        height = Math.max(1, height);
+        Framebuffer level = mLevels[index];
+        if (level == null) {
+            level = mLevels[index] = new Framebuffer(width, height);
+            level.attachTexture(GL_COLOR_ATTACHMENT0, GL_RGBA8);
+            level.setDrawBuffer(GL_COLOR_ATTACHMENT0);
+            setupTexture(level);
+        } else if (level.resize(width, height)) {
+            // the texture was recreated
+            setupTexture(level);
+        }
+        mLevelWidths[index] = width;
+        mLevelHeights[index] = height;
+        return level;
+    }
+
+    private static void setupTexture(@Nonnull Framebuffer level) {
+        int texture = level.getAttachedTexture(GL_COLOR_ATTACHMENT0).get();
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    // the caller (such as Minecraft) may cache GL states, so restore them exactly
+    private void saveStates() {
+        glGetIntegerv(GL_VIEWPORT, mViewport);
+        mDrawFramebuffer = glGetInteger(GL_DRAW_FRAMEBUFFER_BINDING);
+        mProgram = glGetInteger(GL_CURRENT_PROGRAM);
+        mBoundVertexArray = glGetInteger(GL_VERTEX_ARRAY_BINDING);
+        mActiveTexture = glGetInteger(GL_ACTIVE_TEXTURE);
+        glActiveTexture(GL_TEXTURE0);
+        mTexture = glGetInteger(GL_TEXTURE_BINDING_2D);
+        mBlend = glIsEnabled(GL_BLEND);
+        mScissor = glIsEnabled(GL_SCISSOR_TEST);
+        mDepthTest = glIsEnabled(GL_DEPTH_TEST);
+        if (mVertexArray == 0) {
+            // attributeless drawing still requires a vertex array
+            mVertexArray = glCreateVertexArrays();
+        }
+        glBindVertexArray(mVertexArray);
+    }
+
+    private void restoreStates() {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mDrawFramebuffer);
+        glViewport(mViewport[0], mViewport[1], mViewport[2], mViewport[3]);
+        glUseProgram(mProgram);
+        glBindVertexArray(mBoundVertexArray);
+        glBindTexture(GL_TEXTURE_2D, mTexture);
+        glActiveTexture(mActiveTexture);
+        if (mBlend) {
+            glEnable(GL_BLEND);
+        } else {
+            glDisable(GL_BLEND);
+        }
+        if (mScissor) {
+            glEnable(GL_SCISSOR_TEST);
+        }
+        if (mDepthTest) {
+            glEnable(GL_DEPTH_TEST);
+        }
+    }
+
+    @Override
+    public void close() {
+        for (int i = 0; i < MAX_ITERATIONS; i++) {
+            if (mLevels[i] != null) {
+                mLevels[i].close();
+                mLevels[i] = null;
+            }
+        }
+        if (mVertexArray != 0) {
+            glDeleteVertexArrays(mVertexArray);
+            mVertexArray = 0;
+        }
+        mValid = false;
+    }
+}
@@ -0,0 +1,166 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.graphics;
+
+import icyllis.modernui.annotation.RenderThread;
+import icyllis.modernui.annotation.UiThread;
+import icyllis.modernui.graphics.texture.Texture2D;
+
+import javax.annotation.Nonnull;
+import java.util.ArrayList;
+import java.util.List;
+
+import static icyllis.modernui.graphics.GLWrapper.*;
+
+/**
+ * An offscreen render target, the content is rendered once by {@link GLCanvas#beginLayer(Layer)}
+ * and {@link GLCanvas#endLayer(Layer)}, then it can be drawn many times with a different
+ * matrix or alpha by {@link GLCanvas#drawLayer(Layer, int)}, until the content is invalidated.
+ * <p>
+ * Layers are pooled, the backing size is rounded up so a layer can be reused by another
+ * owner of a similar size. The framebuffer is created lazily on the render thread.
+ */
+public final class Layer {
+
+    private static final int GRANULE = 64;
+    private static final int MAX_POOL_SIZE = 8;
+
+    // free layers, UI thread only
+    private static final List<Layer> sPool = new ArrayList<>();
+
+    final Texture2D mTexture = new Texture2D();
+    // render thread only
+    private Framebuffer mFramebuffer;
+
+    // the size of the content and the backing textures
+    int mWidth;
+    int mHeight;
+    int mBackingWidth;
+    int mBackingHeight;
+
+    boolean mValid;
+
+    private Layer() {
+    }
+
+    /**
+     * Obtains a layer from the pool or creates a new one. The content is undefined.
+     *
+     * @param width  the width of the content
+     * @param height the height of the content
+     * @return a layer
+     */
+    @Nonnull
+    @UiThread
+    public static Layer obtain(int width, int height) {
+        final List<Layer> pool = sPool;
+        for (int i = pool.size() - 1; i >= 0; i--) {
+            // prefer one that doesn't need to reallocate
+            Layer layer = pool.get(i);
+            if (layer.fits(width, height)) {
+                pool.remove(i);
+                layer.setSize(width, height);
+                return layer;
+            }
+        }
+        final Layer layer = pool.isEmpty() ? new Layer() : pool.remove(pool.size() - 1);
+        layer.setSize(width, height);
+        return layer;
+    }
+
+    /**
+     * Gives this layer back to the pool, the caller should not use it anymore.
+     */
+    @UiThread
+    public void recycle() {
+        mValid = false;
+        // otherwise, it may be still referenced by a frame packet, the cleaner will delete it
+        if (sPool.size() < MAX_POOL_SIZE) {
+            sPool.add(this);
+        }
+    }
+
+    /**
+     * Changes the size of the content, the content becomes invalid if changed.
+     */
+    @UiThread
+    public void setSize(int width, int height) {
+        if (mWidth == width && mHeight == height) {
+            return;
+        }
+        mWidth = width;
+        mHeight = height;
+        mValid = false;
+        if (!fits(width, height)) {
+            mBackingWidth = roundUp(width);
+            mBackingHeight = roundUp(height);
+        }
+    }
+
+    // not smaller, and not wasting too much memory
+    private boolean fits(int width, int height) {
+        return mBackingWidth >= width && mBackingHeight >= height &&
+                mBackingWidth <= roundUp(width) * 2 && mBackingHeight <= roundUp(height) * 2;
+    }
+
+    private static int roundUp(int size) {
+        return Math.max(1, (size + GRANULE - 1) / GRANULE) * GRANULE;
+    }
+
+    public int getWidth() {
+        return mWidth;
+    }
+
+    public int getHeight() {
+        return mHeight;
+    }
+
+    /**
+     * Returns whether the content was rendered and hasn't been invalidated since then.
+     */
+    public boolean isValid() {
+        return mValid;
+    }
+
+    /**
+     * Marks the content invalid, it must be rendered again before next drawing.
+     */
+    public void invalidate() {
+        mValid = false;
+    }
+
+    // bind the framebuffer of the given backing size, called in rendering
+    @RenderThread
+    void bindDraw(int backingWidth, int backingHeight) {
+        Framebuffer framebuffer = mFramebuffer;
+        if (framebuffer == null) {
+            framebuffer = mFramebuffer = new Framebuffer(backingWidth, backingHeight);
+            framebuffer.attachTexture(GL_COLOR_ATTACHMENT0, mTexture, GL_RGBA8);
+            framebuffer.attachRenderbuffer(GL_STENCIL_ATTACHMENT, GL_STENCIL_INDEX8);
+            framebuffer.setDrawBuffer(GL_COLOR_ATTACHMENT0);
+            mTexture.setFilter(true, false);
+        } else if (framebuffer.resize(backingWidth, backingHeight)) {
+            // the texture was recreated
+            mTexture.setFilter(true, false);
+        }
+        framebuffer.clearColorBuffer();
+        framebuffer.clearDepthStencilBuffer();
+        framebuffer.bindDraw();
+    }
+}
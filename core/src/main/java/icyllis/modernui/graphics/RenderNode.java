@@ -0,0 +1,173 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.graphics;
+
+import icyllis.modernui.graphics.texture.Texture2D;
+import icyllis.modernui.math.Matrix4;
+import icyllis.modernui.math.Rect;
+import it.unimi.dsi.fastutil.ints.IntArrayList;
+import it.unimi.dsi.fastutil.ints.IntList;
+import org.lwjgl.BufferUtils;
+
+import javax.annotation.Nonnull;
+import javax.annotation.concurrent.NotThreadSafe;
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * A retained display list, holding the draw commands and instance data recorded
+ * by {@link GLCanvas} between {@link GLCanvas#beginRecording(RenderNode)} and
+ * {@link GLCanvas#endRecording(RenderNode)}. Replaying a node with
+ * {@link GLCanvas#drawRenderNode(RenderNode)} copies the recorded data instead
+ * of calling draw methods again.
+ * <p>
+ * Instance data already contains the model view matrix and the alpha multiplier,
+ * and clip commands contain the absolute stencil reference, so a node can be
+ * replayed only if the canvas is in the same state as what it was when recording. Owners should discard the node
+ * when the content changed, see {@link #discard()}.
+ */
+@NotThreadSafe
+public final class RenderNode {
+
+    // the canvas state when recording begins
+    final Matrix4 mBeginMatrix = Matrix4.identity();
+    final Rect mBeginClip = new Rect();
+    int mBeginDepth;
+    int mSaveCount;
+    // the alpha multiplier baked into colors
+    float mBeginAlpha;
+
+    // the canvas state when recording ends
+    final Matrix4 mEndMatrix = Matrix4.identity();
+    final Rect mEndClip = new Rect();
+    int mEndDepth;
+
+    // recorded commands, see GLCanvas
+    final IntList mDrawStates = new IntArrayList();
+    final IntList mDrawCounts = new IntArrayList();
+    final List<Texture2D> mTextures = new ArrayList<>();
+    final IntList mClipDepths = new IntArrayList();
+    // image sources used by the commands, each holds a usage
+    final List<Image.Source> mSources = new ArrayList<>();
+
+    // recorded instance data in client memory
+    ByteBuffer mPosColorData;
+    ByteBuffer mPosColorTexData;
+    int mPosColorCount;
+    int mPosColorTexCount;
+
+    // the index in canvas lists when recording begins
+    int mStateStart;
+    int mTextureStart;
+    int mSourceStart;
+    int mClipStart;
+    int mLastBarrier;
+
+    boolean mRecording;
+    boolean mValid;
+
+    // true if a layer was rendered when recording, layer rendering is never replayed
+    boolean mLayerRendered;
+
+    public RenderNode() {
+    }
+
+    /**
+     * Returns whether this node has valid recorded content that can be replayed.
+     *
+     * @return true if it's valid
+     */
+    public boolean isValid() {
+        return mValid;
+    }
+
+    /**
+     * Discards recorded content, the node must be recorded again before replaying.
+     * Client memory is kept for next recording.
+     */
+    public void discard() {
+        mValid = false;
+        mLayerRendered = false;
+        mDrawStates.clear();
+        mDrawCounts.clear();
+        mTextures.clear();
+        mClipDepths.clear();
+        for (Image.Source source : mSources) {
+            source.release();
+        }
+        mSources.clear();
+        if (mPosColorData != null) {
+            mPosColorData.clear();
+        }
+        if (mPosColorTexData != null) {
+            mPosColorTexData.clear();
+        }
+        mPosColorCount = 0;
+        mPosColorTexCount = 0;
+    }
+
+    /**
+     * Returns the buffer to write the next pos color instance when recording.
+     *
+     * @param stride the instance size in bytes
+     * @return the buffer to write
+     */
+    @Nonnull
+    ByteBuffer nextPosColor(int stride) {
+        mPosColorData = ensureCapacity(mPosColorData, stride);
+        mPosColorCount++;
+        return mPosColorData;
+    }
+
+    @Nonnull
+    ByteBuffer nextPosColorTex(int stride) {
+        mPosColorTexData = ensureCapacity(mPosColorTexData, stride);
+        mPosColorTexCount++;
+        return mPosColorTexData;
+    }
+
+    // append instances of a child node
+    void putPosColor(@Nonnull ByteBuffer data, int count) {
+        mPosColorData = ensureCapacity(mPosColorData, data.remaining());
+        mPosColorData.put(data);
+        mPosColorCount += count;
+    }
+
+    void putPosColorTex(@Nonnull ByteBuffer data, int count) {
+        mPosColorTexData = ensureCapacity(mPosColorTexData, data.remaining());
+        mPosColorTexData.put(data);
+        mPosColorTexCount += count;
+    }
+
+    @Nonnull
+    private static ByteBuffer ensureCapacity(ByteBuffer buffer, int size) {
+        if (buffer == null) {
+            return BufferUtils.createByteBuffer(Math.max(size, 1024));
+        }
+        if (buffer.remaining() < size) {
+            ByteBuffer newBuffer = BufferUtils.createByteBuffer(
+                    Math.max(buffer.capacity() << 1, buffer.position() + size));
+            buffer.flip();
+            newBuffer.put(buffer);
+            return newBuffer;
+        }
+        return buffer;
+    }
+}
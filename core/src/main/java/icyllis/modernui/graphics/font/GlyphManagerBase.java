@@ -21,16 +21,23 @@ package icyllis.modernui.graphics.font;
 import icyllis.modernui.text.FontCollection;
 import it.unimi.dsi.fastutil.objects.Object2IntMap;
 import it.unimi.dsi.fastutil.objects.Object2IntOpenHashMap;
+import org.lwjgl.system.MemoryUtil;
 
 import javax.annotation.Nonnull;
 import java.awt.*;
 import java.awt.font.GlyphVector;
 import java.awt.image.BufferedImage;
+import java.awt.image.DataBufferInt;
+import java.awt.image.SinglePixelPackedSampleModel;
+import java.awt.image.WritableRaster;
+import java.nio.ByteOrder;
 
 public class GlyphManagerBase {
 
     private static GlyphManagerBase instance;
 
+    private static final boolean LITTLE_ENDIAN = ByteOrder.nativeOrder() == ByteOrder.LITTLE_ENDIAN;
+
     public static final int TEXTURE_SIZE = 1024;
 
     /**
@@ -73,6 +80,28 @@ public class GlyphManagerBase {
         return font.layoutGlyphVector(mGlyphGraphics.getFontRenderContext(), text, start, limit, flags);
     }
 
+    /**
+     * Shape a text run in a single font, the result may be shared from the global {@link ShapingCache}.
+     * This should be preferred to {@link #layoutGlyphVector(Font, char[], int, int, int)}, if only glyph
+     * codes and positions are required.
+     *
+     * @param font  the derived Font used to shape the text
+     * @param text  the text buffer
+     * @param start the offset into text at which to start the layout
+     * @param limit the (offset + length) at which to stop performing the layout
+     * @param flags either {@link Font#LAYOUT_RIGHT_TO_LEFT} or {@link Font#LAYOUT_LEFT_TO_RIGHT}
+     * @return the shaping result
+     */
+    @Nonnull
+    public ShapedRun shape(@Nonnull Font font, char[] text, int start, int limit, int flags) {
+        ShapedRun run = ShapingCache.get(font, text, start, limit, flags);
+        if (run == null) {
+            run = ShapedRun.create(layoutGlyphVector(font, text, start, limit, flags));
+            ShapingCache.put(font, text, start, limit, flags, run);
+        }
+        return run;
+    }
+
     /**
      * Derive a font family with given style and size
      *
@@ -105,4 +134,45 @@ public class GlyphManagerBase {
     public void getFontMetrics(@Nonnull Font derivedFont, @Nonnull FontMetricsInt fm) {
         fm.extendBy(mGlyphGraphics.getFontMetrics(derivedFont));
     }
+
+    /**
+     * Extracts the alpha channel of a region of an image into native memory, one byte per pixel
+     * and tightly packed. Pixels are read from the backing int array directly, there's no color
+     * model conversion like {@link BufferedImage#getRGB(int, int, int, int, int[], int, int)}.
+     * <p>
+     * The image must be {@link BufferedImage#TYPE_INT_ARGB}. Note that accessing the data array
+     * makes the image unmanaged, so it should be only used as a drawing target.
+     *
+     * @param image  the source image
+     * @param x      the left of the region
+     * @param y      the top of the region
+     * @param width  the width of the region
+     * @param height the height of the region
+     * @param dst    the destination address, at least width * height bytes
+     */
+    public static void extractAlpha(@Nonnull BufferedImage image, int x, int y, int width, int height, long dst) {
+        if (image.getType() != BufferedImage.TYPE_INT_ARGB) {
+            throw new IllegalArgumentException("Not an ARGB image");
+        }
+        final WritableRaster raster = image.getRaster();
+        final int[] data = ((DataBufferInt) raster.getDataBuffer()).getData();
+        final int scanline = ((SinglePixelPackedSampleModel) raster.getSampleModel()).getScanlineStride();
+        for (int j = 0; j < height; j++) {
+            int src = (y + j) * scanline + x;
+            final int end = src + width;
+            // four pixels per store
+            for (final int limit = end - 3; src < limit; src += 4, dst += 4) {
+                final int a0 = data[src] >>> 24;
+                final int a1 = data[src + 1] >>> 24;
+                final int a2 = data[src + 2] >>> 24;
+                final int a3 = data[src + 3] >>> 24;
+                MemoryUtil.memPutInt(dst, LITTLE_ENDIAN
+                        ? a0 | a1 << 8 | a2 << 16 | a3 << 24
+                        : a3 | a2 << 8 | a1 << 16 | a0 << 24);
+            }
+            for (; src < end; src++, dst++) {
+                MemoryUtil.memPutByte(dst, (byte) (data[src] >>> 24));
+            }
+        }
+    }
 }
@@ -0,0 +1,125 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.graphics.font;
+
+import icyllis.modernui.annotation.RenderThread;
+import icyllis.modernui.graphics.texture.Texture2D;
+import icyllis.modernui.math.Rect;
+
+import javax.annotation.Nonnull;
+
+import static icyllis.modernui.graphics.GLWrapper.GL_ALPHA;
+import static icyllis.modernui.graphics.GLWrapper.GL_UNSIGNED_BYTE;
+
+/**
+ * A fixed-size page of a glyph atlas, which is an 8-bit alpha texture with a
+ * skyline packer. Pages are never resized, when all pages are full, the least
+ * recently used page may be evicted and reused as a whole.
+ */
+public final class GlyphPage {
+
+    private final Texture2D mTexture = new Texture2D();
+    private final SkylinePacker mPacker;
+    private final int mMaxLevel;
+
+    // the number of glyphs packed
+    private int mGlyphCount;
+
+    // the time or the frame index when a glyph of this page was last used
+    private volatile long mLastUsed;
+
+    /**
+     * Creates a page and allocates its texture, the texture is cleared.
+     *
+     * @param size     the width and height
+     * @param maxLevel the max mipmap level
+     */
+    @RenderThread
+    public GlyphPage(int size, int maxLevel) {
+        mPacker = new SkylinePacker(size, size);
+        mMaxLevel = maxLevel;
+        mTexture.initCompat(GL_ALPHA, size, size, maxLevel);
+        clearTexture();
+    }
+
+    @Nonnull
+    public Texture2D getTexture() {
+        return mTexture;
+    }
+
+    public int getSize() {
+        return mPacker.getWidth();
+    }
+
+    /**
+     * Allocates a region for a glyph image, including its borders.
+     *
+     * @param width  the width of the region
+     * @param height the height of the region
+     * @param out    the allocated region if successful
+     * @return true if allocated, false if this page is full
+     */
+    public boolean allocate(int width, int height, @Nonnull Rect out) {
+        if (mPacker.pack(width, height, out)) {
+            mGlyphCount++;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Marks this page used, this should be called when any glyph of this page
+     * is used for drawing.
+     *
+     * @param stamp the current time or frame index, monotonically increasing
+     */
+    public void markUsed(long stamp) {
+        mLastUsed = stamp;
+    }
+
+    public long getLastUsed() {
+        return mLastUsed;
+    }
+
+    public int getGlyphCount() {
+        return mGlyphCount;
+    }
+
+    public float getOccupancy() {
+        return mPacker.getOccupancy();
+    }
+
+    /**
+     * Removes all glyphs and clears the texture, then this page can be reused.
+     * All texture coordinates referring this page become invalid.
+     */
+    @RenderThread
+    public void evict() {
+        mPacker.reset();
+        mGlyphCount = 0;
+        clearTexture();
+    }
+
+    private void clearTexture() {
+        // clear all levels, otherwise old mipmaps may bleed into new glyphs
+        for (int level = 0; level <= mMaxLevel; level++) {
+            mTexture.clear(level, GL_ALPHA, GL_UNSIGNED_BYTE);
+        }
+    }
+}
@@ -0,0 +1,191 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.graphics.font;
+
+import icyllis.modernui.platform.FrameProfiler;
+
+import javax.annotation.Nonnull;
+import javax.annotation.Nullable;
+import javax.annotation.concurrent.ThreadSafe;
+import java.util.Arrays;
+import java.util.Iterator;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.AtomicBoolean;
+
+/**
+ * A global cache of measurement results, keyed by the content of a text run
+ * and the paint used to measure it, so the same words are measured only once
+ * across different texts. Lookups and insertions don't block each other.
+ * <p>
+ * The cache is bounded, when it grows beyond the max size, one thread sweeps it
+ * with the CLOCK (second chance) policy: entries used since the last sweep are
+ * kept, others are removed, until the size drops below the low watermark.
+ */
+@ThreadSafe
+public final class LayoutCache {
+
+    public static final int MAX_SIZE = 8192;
+    private static final int LOW_SIZE = MAX_SIZE * 3 / 4;
+
+    private static final ConcurrentHashMap<Key, Entry> sCache = new ConcurrentHashMap<>(MAX_SIZE);
+    private static final AtomicBoolean sSweeping = new AtomicBoolean();
+
+    private static final ThreadLocal<Key> sLookupKey = ThreadLocal.withInitial(Key::new);
+
+    private LayoutCache() {
+    }
+
+    /**
+     * Returns the cached metrics of the text run, or null if not cached.
+     *
+     * @param text  the text buffer
+     * @param start the start of the run
+     * @param end   the end of the run
+     * @param paint the paint used to measure
+     * @param isRtl the run direction
+     */
+    @Nullable
+    public static GraphemeMetrics get(@Nonnull char[] text, int start, int end, @Nonnull FontPaint paint,
+                                      boolean isRtl) {
+        final Entry entry = sCache.get(sLookupKey.get().update(text, start, end, paint, isRtl));
+        if (entry != null) {
+            entry.mUsed = true;
+            FrameProfiler.count(FrameProfiler.LAYOUT_HITS, 1);
+            return entry.mMetrics;
+        }
+        FrameProfiler.count(FrameProfiler.LAYOUT_MISSES, 1);
+        return null;
+    }
+
+    /**
+     * Caches the metrics of the text run, the chars and the paint are copied.
+     */
+    public static void put(@Nonnull char[] text, int start, int end, @Nonnull FontPaint paint, boolean isRtl,
+                           @Nonnull GraphemeMetrics metrics) {
+        sCache.putIfAbsent(sLookupKey.get().update(text, start, end, paint, isRtl).copy(), new Entry(metrics));
+        if (sCache.size() > MAX_SIZE) {
+            sweep();
+        }
+    }
+
+    private static void sweep() {
+        if (!sSweeping.compareAndSet(false, true)) {
+            return;
+        }
+        try {
+            // at most two rounds, the first clears the used bits
+            for (int round = 0; round < 2 && sCache.size() > LOW_SIZE; round++) {
+                for (Iterator<Map.Entry<Key, Entry>> it = sCache.entrySet().iterator();
+                     it.hasNext() && sCache.size() > LOW_SIZE; ) {
+                    Entry entry = it.next().getValue();
+                    if (entry.mUsed) {
+                        entry.mUsed = false;
+                    } else {
+                        it.remove();
+                    }
+                }
+            }
+        } finally {
+            sSweeping.set(false);
+        }
+    }
+
+    public static int getSize() {
+        return sCache.size();
+    }
+
+    /**
+     * Clears the cache, this should be called when fonts are reloaded.
+     */
+    public static void clear() {
+        sCache.clear();
+    }
+
+    private static final class Entry {
+
+        private final GraphemeMetrics mMetrics;
+        // racy but benign, this is only a hint for eviction
+        private boolean mUsed;
+
+        private Entry(GraphemeMetrics metrics) {
+            mMetrics = metrics;
+        }
+    }
+
+    private static final class Key {
+
+        private char[] mChars;
+        private int mStart;
+        private int mEnd;
+        private FontPaint mPaint;
+        private boolean mIsRtl;
+        private int mHash;
+
+        private Key() {
+        }
+
+        private Key(@Nonnull char[] chars, @Nonnull FontPaint paint, boolean isRtl, int hash) {
+            mChars = chars;
+            mEnd = chars.length;
+            mPaint = paint;
+            mIsRtl = isRtl;
+            mHash = hash;
+        }
+
+        @Nonnull
+        private Key update(@Nonnull char[] text, int start, int end, @Nonnull FontPaint paint, boolean isRtl) {
+            mChars = text;
+            mStart = start;
+            mEnd = end;
+            mPaint = paint;
+            mIsRtl = isRtl;
+            int h = paint.hashCode();
+            for (int i = start; i < end; i++) {
+                h = 31 * h + text[i];
+            }
+            mHash = isRtl ? ~h : h;
+            return this;
+        }
+
+        // paints are mutable, so copy it as well
+        @Nonnull
+        private Key copy() {
+            return new Key(Arrays.copyOfRange(mChars, mStart, mEnd), new FontPaint(mPaint), mIsRtl, mHash);
+        }
+
+        @Override
+        public boolean equals(Object o) {
+            if (this == o) return true;
+            if (o == null || getClass() != o.getClass()) return false;
+
+            Key key = (Key) o;
+
+            if (mHash != key.mHash) return false;
+            if (mIsRtl != key.mIsRtl) return false;
+            if (!Arrays.equals(mChars, mStart, mEnd, key.mChars, key.mStart, key.mEnd)) return false;
+            return mPaint.equals(key.mPaint);
+        }
+
+        @Override
+        public int hashCode() {
+            return mHash;
+        }
+    }
+}
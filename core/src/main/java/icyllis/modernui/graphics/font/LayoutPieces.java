@@ -24,10 +24,14 @@ import it.unimi.dsi.fastutil.objects.Object2ObjectMap;
 import it.unimi.dsi.fastutil.objects.Object2ObjectOpenHashMap;
 
 import javax.annotation.Nonnull;
-import javax.annotation.concurrent.ThreadSafe;
 import java.util.function.BiConsumer;
 
-@ThreadSafe
+/**
+ * The measurement results of a single {@link icyllis.modernui.text.MeasuredText}, keyed by
+ * positions. Pieces are inserted only while the measured text is being constructed and
+ * never modified after that, so queries don't need to be locked. Results shared between
+ * different texts are in the global {@link LayoutCache}.
+ */
 public class LayoutPieces {
 
     public static final int NO_PAINT_ID = -1;
@@ -37,7 +41,7 @@ public class LayoutPieces {
     private final Object2IntMap<FontPaint> mPaintMap = new Object2IntOpenHashMap<>();
     private final Object2ObjectMap<Key, GraphemeMetrics> mMetricsMap = new Object2ObjectOpenHashMap<>();
 
-    public synchronized void insert(int start, int end, GraphemeMetrics piece, boolean dir, FontPaint paint) {
+    public void insert(int start, int end, GraphemeMetrics piece, boolean dir, FontPaint paint) {
         int paintId = mPaintMap.computeIntIfAbsent(paint, p -> mPaintMap.size());
         if (!mMetricsMap.containsKey(mLookupKey.update(start, end, dir, paintId))) {
             mMetricsMap.put(mLookupKey.copy(), piece);
@@ -46,10 +50,8 @@ public class LayoutPieces {
 
     public void getOrCreate(@Nonnull char[] textBuf, int start, int end, @Nonnull FontPaint paint,
                             boolean dir, int paintId, @Nonnull BiConsumer<GraphemeMetrics, FontPaint> consumer) {
-        final GraphemeMetrics piece;
-        synchronized (this) {
-            piece = mMetricsMap.get(mLookupKey.update(start, end, dir, paintId));
-        }
+        final GraphemeMetrics piece = paintId == NO_PAINT_ID ? null :
+                mMetricsMap.get(new Key(start, end, dir, paintId));
         if (piece == null) {
             MeasureEngine.getInstance().create(textBuf, start, end, paint, dir, consumer);
         } else {
@@ -22,8 +22,6 @@ import icyllis.modernui.text.FontCollection;
 
 import javax.annotation.Nonnull;
 import java.awt.*;
-import java.awt.font.GlyphVector;
-import java.util.List;
 import java.util.function.BiConsumer;
 
 public class MeasureEngine {
@@ -32,6 +30,10 @@ public class MeasureEngine {
 
     private final GlyphManagerBase mGlyphManager = GlyphManagerBase.getInstance();
 
+    // reused run buffers, measuring may happen on text workers
+    private final ThreadLocal<FontCollection.RunBuffer> mRunBuffer =
+            ThreadLocal.withInitial(FontCollection.RunBuffer::new);
+
     public static MeasureEngine getInstance() {
         if (sInstance == null)
             synchronized (MeasureEngine.class) {
@@ -41,23 +43,38 @@ public class MeasureEngine {
         return sInstance;
     }
 
+    /**
+     * Measures the text run and passes the result to the consumer, the result may be
+     * shared from the global {@link LayoutCache}.
+     */
     public void create(@Nonnull char[] text, int contextStart, int contextEnd, @Nonnull FontPaint paint, boolean isRtl,
                        @Nonnull BiConsumer<GraphemeMetrics, FontPaint> consumer) {
-        final List<FontCollection.Run> runs = paint.mFontCollection.itemize(text, contextStart, contextEnd);
+        GraphemeMetrics metrics = LayoutCache.get(text, contextStart, contextEnd, paint, isRtl);
+        if (metrics == null) {
+            metrics = measure(text, contextStart, contextEnd, paint, isRtl);
+            LayoutCache.put(text, contextStart, contextEnd, paint, isRtl, metrics);
+        }
+        consumer.accept(metrics, paint);
+    }
+
+    @Nonnull
+    private GraphemeMetrics measure(@Nonnull char[] text, int contextStart, int contextEnd, @Nonnull FontPaint paint,
+                                    boolean isRtl) {
+        final FontCollection.RunBuffer runs = mRunBuffer.get();
+        paint.mFontCollection.itemize(text, contextStart, contextEnd, runs);
         final int flag = isRtl ? Font.LAYOUT_RIGHT_TO_LEFT : Font.LAYOUT_LEFT_TO_RIGHT;
         final GlyphManagerBase manager = mGlyphManager;
         float advance = 0;
         final FontMetricsInt fm = new FontMetricsInt();
-        for (FontCollection.Run run : runs) {
+        for (int i = 0, e = runs.size(); i < e; i++) {
+            final FontCollection.Run run = runs.get(i);
             final Font derivedFont;
             synchronized (this) {
                 derivedFont = manager.deriveFont(run.getFamily(), paint.mFontStyle, paint.mFontSize);
             }
-            final GlyphVector vector = manager.layoutGlyphVector(derivedFont, text, run.getStart(), run.getEnd(), flag);
-            final int num = vector.getNumGlyphs();
-            advance += vector.getGlyphPosition(num).getX();
+            advance += manager.shape(derivedFont, text, run.getStart(), run.getEnd(), flag).getAdvance();
             manager.getFontMetrics(derivedFont, fm);
         }
-        consumer.accept(new GraphemeMetrics(advance, fm), paint);
+        return new GraphemeMetrics(advance, fm);
     }
 }
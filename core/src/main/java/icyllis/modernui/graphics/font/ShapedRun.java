@@ -0,0 +1,91 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.graphics.font;
+
+import javax.annotation.Nonnull;
+import java.awt.font.GlyphVector;
+
+/**
+ * The shaping result of a text run in a single font, stored in packed arrays rather than
+ * {@link GlyphVector}. Positions are horizontal only, there's no vertical text for now.
+ * Instances are immutable and can be shared between threads.
+ *
+ * @see ShapingCache
+ */
+public final class ShapedRun {
+
+    private final int[] mGlyphs;
+    // relative to the start of the run
+    private final int[] mCharIndices;
+    // x of each glyph, followed by the total advance
+    private final float[] mPositions;
+
+    private ShapedRun(int[] glyphs, int[] charIndices, float[] positions) {
+        mGlyphs = glyphs;
+        mCharIndices = charIndices;
+        mPositions = positions;
+    }
+
+    @Nonnull
+    public static ShapedRun create(@Nonnull GlyphVector vector) {
+        final int num = vector.getNumGlyphs();
+        final int[] glyphs = vector.getGlyphCodes(0, num, null);
+        final int[] charIndices = vector.getGlyphCharIndices(0, num, null);
+        final float[] positions = new float[num + 1];
+        final float[] xy = vector.getGlyphPositions(0, num + 1, null);
+        for (int i = 0; i <= num; i++) {
+            positions[i] = xy[i << 1];
+        }
+        return new ShapedRun(glyphs, charIndices, positions);
+    }
+
+    public int getGlyphCount() {
+        return mGlyphs.length;
+    }
+
+    public int getGlyphCode(int i) {
+        return mGlyphs[i];
+    }
+
+    /**
+     * @return the char index of the glyph, relative to the start of the run
+     */
+    public int getCharIndex(int i) {
+        return mCharIndices[i];
+    }
+
+    /**
+     * @return the x offset of the glyph in pixels of the derived font
+     */
+    public float getPosition(int i) {
+        return mPositions[i];
+    }
+
+    /**
+     * @return the total advance of the run
+     */
+    public float getAdvance() {
+        return mPositions[mGlyphs.length];
+    }
+
+    // approximate memory usage in ints
+    int getWeight() {
+        return mGlyphs.length * 3 + 1;
+    }
+}
@@ -0,0 +1,194 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.graphics.font;
+
+import javax.annotation.Nonnull;
+import javax.annotation.Nullable;
+import javax.annotation.concurrent.ThreadSafe;
+import java.awt.*;
+import java.util.Arrays;
+import java.util.Iterator;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * A global cache of text shaping results, keyed by the derived font, the run text and
+ * the layout direction. It sits under both the vanilla text engine and the core text
+ * engine, so a run measured by one of them and later drawn by the other is shaped once.
+ * <p>
+ * The cache is bounded by the total weight of results, and swept with the same CLOCK
+ * policy as {@link LayoutCache}.
+ */
+@ThreadSafe
+public final class ShapingCache {
+
+    public static final int MAX_WEIGHT = 1 << 18;
+    private static final int LOW_WEIGHT = MAX_WEIGHT * 3 / 4;
+
+    private static final ConcurrentHashMap<Key, Entry> sCache = new ConcurrentHashMap<>();
+    private static final AtomicInteger sWeight = new AtomicInteger();
+    private static final AtomicBoolean sSweeping = new AtomicBoolean();
+
+    private static final ThreadLocal<Key> sLookupKey = ThreadLocal.withInitial(Key::new);
+
+    private ShapingCache() {
+    }
+
+    /**
+     * Returns the cached shaping result, or null if not cached.
+     *
+     * @param font  the derived font
+     * @param text  the text buffer
+     * @param start the start of the run
+     * @param limit the end of the run
+     * @param flags the layout direction flags
+     */
+    @Nullable
+    public static ShapedRun get(@Nonnull Font font, @Nonnull char[] text, int start, int limit, int flags) {
+        final Entry entry = sCache.get(sLookupKey.get().update(font, text, start, limit, flags));
+        if (entry != null) {
+            entry.mUsed = true;
+            return entry.mRun;
+        }
+        return null;
+    }
+
+    /**
+     * Caches the shaping result, the chars are copied.
+     */
+    public static void put(@Nonnull Font font, @Nonnull char[] text, int start, int limit, int flags,
+                           @Nonnull ShapedRun run) {
+        final Key key = sLookupKey.get().update(font, text, start, limit, flags).copy();
+        if (sCache.putIfAbsent(key, new Entry(run)) == null
+                && sWeight.addAndGet(run.getWeight()) > MAX_WEIGHT) {
+            sweep();
+        }
+    }
+
+    private static void sweep() {
+        if (!sSweeping.compareAndSet(false, true)) {
+            return;
+        }
+        try {
+            for (int round = 0; round < 2 && sWeight.get() > LOW_WEIGHT; round++) {
+                for (Iterator<Map.Entry<Key, Entry>> it = sCache.entrySet().iterator();
+                     it.hasNext() && sWeight.get() > LOW_WEIGHT; ) {
+                    Entry entry = it.next().getValue();
+                    if (entry.mUsed) {
+                        entry.mUsed = false;
+                    } else {
+                        it.remove();
+                        sWeight.addAndGet(-entry.mRun.getWeight());
+                    }
+                }
+            }
+        } finally {
+            sSweeping.set(false);
+        }
+    }
+
+    public static int getSize() {
+        return sCache.size();
+    }
+
+    public static int getWeight() {
+        return sWeight.get();
+    }
+
+    /**
+     * Clears the cache, this should be called when fonts are reloaded.
+     */
+    public static void clear() {
+        sCache.clear();
+        sWeight.set(0);
+    }
+
+    private static final class Entry {
+
+        private final ShapedRun mRun;
+        // racy but benign, this is only a hint for eviction
+        private boolean mUsed;
+
+        private Entry(ShapedRun run) {
+            mRun = run;
+        }
+    }
+
+    private static final class Key {
+
+        private Font mFont;
+        private char[] mChars;
+        private int mStart;
+        private int mEnd;
+        private int mFlags;
+        private int mHash;
+
+        private Key() {
+        }
+
+        private Key(@Nonnull Font font, @Nonnull char[] chars, int flags, int hash) {
+            mFont = font;
+            mChars = chars;
+            mEnd = chars.length;
+            mFlags = flags;
+            mHash = hash;
+        }
+
+        @Nonnull
+        private Key update(@Nonnull Font font, @Nonnull char[] text, int start, int end, int flags) {
+            mFont = font;
+            mChars = text;
+            mStart = start;
+            mEnd = end;
+            mFlags = flags;
+            int h = font.hashCode() * 31 + flags;
+            for (int i = start; i < end; i++) {
+                h = 31 * h + text[i];
+            }
+            mHash = h;
+            return this;
+        }
+
+        // fonts are immutable, only the chars are copied
+        @Nonnull
+        private Key copy() {
+            return new Key(mFont, Arrays.copyOfRange(mChars, mStart, mEnd), mFlags, mHash);
+        }
+
+        @Override
+        public boolean equals(Object o) {
+            if (this == o) return true;
+            if (o == null || getClass() != o.getClass()) return false;
+
+            Key key = (Key) o;
+
+            if (mHash != key.mHash) return false;
+            if (mFlags != key.mFlags) return false;
+            if (!Arrays.equals(mChars, mStart, mEnd, key.mChars, key.mStart, key.mEnd)) return false;
+            return mFont.equals(key.mFont);
+        }
+
+        @Override
+        public int hashCode() {
+            return mHash;
+        }
+    }
+}
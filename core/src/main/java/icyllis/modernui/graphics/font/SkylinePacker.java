@@ -0,0 +1,154 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.graphics.font;
+
+import icyllis.modernui.math.Rect;
+import it.unimi.dsi.fastutil.ints.IntArrayList;
+
+import javax.annotation.Nonnull;
+import javax.annotation.concurrent.NotThreadSafe;
+
+/**
+ * Packs rectangles into a fixed-size area with the skyline bottom-left heuristic.
+ * The skyline is a list of horizontal segments covering the whole width, each new
+ * rectangle is placed on the segment where its bottom edge would be the lowest.
+ * This wastes much less space than a row cursor when rectangle heights vary, for
+ * example, CJK glyphs mixed with Latin glyphs and emoji.
+ * <p>
+ * Rectangles can't be removed individually, the packer can only be reset.
+ */
+@NotThreadSafe
+public final class SkylinePacker {
+
+    private final int mWidth;
+    private final int mHeight;
+
+    // x, y, width of each segment, sorted by x
+    private final IntArrayList mSkyline = new IntArrayList();
+
+    // used area in pixels
+    private int mArea;
+
+    public SkylinePacker(int width, int height) {
+        if (width <= 0 || height <= 0) {
+            throw new IllegalArgumentException();
+        }
+        mWidth = width;
+        mHeight = height;
+        reset();
+    }
+
+    /**
+     * Removes all packed rectangles.
+     */
+    public void reset() {
+        mSkyline.clear();
+        mSkyline.add(0);
+        mSkyline.add(0);
+        mSkyline.add(mWidth);
+        mArea = 0;
+    }
+
+    /**
+     * Finds a position for a rectangle of the given size.
+     *
+     * @param width  the width of the rectangle
+     * @param height the height of the rectangle
+     * @param out    the packed rectangle if successful
+     * @return true if packed, false if there's no enough space
+     */
+    public boolean pack(int width, int height, @Nonnull Rect out) {
+        if (width <= 0 || height <= 0 || width > mWidth || height > mHeight) {
+            return false;
+        }
+        final IntArrayList skyline = mSkyline;
+        int bestIndex = -1;
+        int bestY = Integer.MAX_VALUE;
+        int bestWidth = Integer.MAX_VALUE;
+        for (int i = 0, e = skyline.size(); i < e; i += 3) {
+            final int x = skyline.getInt(i);
+            if (x + width > mWidth) {
+                break;
+            }
+            // the lowest y that doesn't intersect any segment below the rectangle
+            int y = 0;
+            for (int j = i; j < e && skyline.getInt(j) < x + width; j += 3) {
+                y = Math.max(y, skyline.getInt(j + 1));
+            }
+            if (y + height > mHeight) {
+                continue;
+            }
+            final int segmentWidth = skyline.getInt(i + 2);
+            if (y < bestY || (y == bestY && segmentWidth < bestWidth)) {
+                bestIndex = i;
+                bestY = y;
+                bestWidth = segmentWidth;
+            }
+        }
+        if (bestIndex == -1) {
+            return false;
+        }
+        final int x = skyline.getInt(bestIndex);
+        out.set(x, bestY, x + width, bestY + height);
+
+        skyline.addElements(bestIndex, new int[]{x, bestY + height, width});
+        // shrink or remove the segments covered by the new one
+        for (int i = bestIndex + 3; i < skyline.size(); ) {
+            int end = skyline.getInt(i - 3) + skyline.getInt(i - 1);
+            int shrink = end - skyline.getInt(i);
+            if (shrink <= 0) {
+                break;
+            }
+            int w = skyline.getInt(i + 2);
+            if (w <= shrink) {
+                skyline.removeElements(i, i + 3);
+            } else {
+                skyline.set(i, skyline.getInt(i) + shrink);
+                skyline.set(i + 2, w - shrink);
+                break;
+            }
+        }
+        // merge adjacent segments of the same height
+        for (int i = 0; i < skyline.size() - 3; ) {
+            if (skyline.getInt(i + 1) == skyline.getInt(i + 4)) {
+                skyline.set(i + 2, skyline.getInt(i + 2) + skyline.getInt(i + 5));
+                skyline.removeElements(i + 3, i + 6);
+            } else {
+                i += 3;
+            }
+        }
+        mArea += width * height;
+        return true;
+    }
+
+    public int getWidth() {
+        return mWidth;
+    }
+
+    public int getHeight() {
+        return mHeight;
+    }
+
+    /**
+     * @return the ratio of the packed area to the total area
+     */
+    public float getOccupancy() {
+        return (float) mArea / (mWidth * mHeight);
+    }
+}
@@ -22,31 +22,66 @@ import icyllis.modernui.ModernUI;
 import icyllis.modernui.annotation.RenderThread;
 import icyllis.modernui.core.Context;
 import icyllis.modernui.platform.RenderCore;
+import it.unimi.dsi.fastutil.ints.Int2ObjectMap;
+import it.unimi.dsi.fastutil.ints.Int2ObjectOpenHashMap;
 import it.unimi.dsi.fastutil.objects.Object2IntMap;
 import it.unimi.dsi.fastutil.objects.Object2IntOpenHashMap;
+import org.lwjgl.opengl.ARBParallelShaderCompile;
+import org.lwjgl.opengl.GL;
+import org.lwjgl.opengl.GLCapabilities;
+import org.lwjgl.opengl.KHRParallelShaderCompile;
+import org.lwjgl.system.MemoryStack;
+import org.lwjgl.system.MemoryUtil;
 
 import javax.annotation.Nonnull;
 import javax.annotation.Nullable;
 import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
 import java.nio.channels.ReadableByteChannel;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
 import java.nio.file.Path;
-import java.util.HashMap;
-import java.util.HashSet;
-import java.util.Map;
-import java.util.Set;
+import java.nio.file.StandardCopyOption;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+import java.util.*;
 
 import static icyllis.modernui.graphics.GLWrapper.*;
 
 /**
  * This class helps you create shaders and programs.
+ * <p>
+ * Shader shards are compiled lazily when a program is created. If a cache directory is set,
+ * linked program binaries are saved there, keyed by the sources of the shards and the driver,
+ * so later startups and reloads can skip compiling and linking. A binary rejected by the
+ * driver falls back to normal compilation.
+ * <p>
+ * During {@link #reload()}, if the driver supports parallel shader compiling, all programs
+ * are compiled and linked first, then their compile and link status is checked after all
+ * listeners.
  */
 public class ShaderManager {
 
     private static final ShaderManager instance = new ShaderManager();
 
+    private static final String BINARY_EXTENSION = ".bin";
+
     private final Set<Listener> mListeners = new HashSet<>();
 
     private final Map<Context, Object2IntMap<Path>> mShaders = new HashMap<>();
+    private final Int2ObjectMap<Shard> mShards = new Int2ObjectOpenHashMap<>();
+
+    // programs linked but not checked yet
+    private final List<PendingLink> mPendingLinks = new ArrayList<>();
+    private boolean mReloading;
+
+    @Nullable
+    private Path mBinaryCacheDir;
+    private byte[] mDriverInfo;
+    private boolean mParallelCompile;
+    private boolean mInitialized;
 
     public static ShaderManager getInstance() {
         return instance;
@@ -65,23 +100,64 @@ public class ShaderManager {
         mListeners.remove(listener);
     }
 
+    /**
+     * Sets the directory to save program binaries, or null to disable the cache.
+     * The directory is created when a binary is saved.
+     *
+     * @param dir the cache directory
+     */
+    public void setBinaryCacheDirectory(@Nullable Path dir) {
+        mBinaryCacheDir = dir;
+    }
+
     // internal use
     public void reload() {
         RenderCore.checkRenderThread();
-        for (var map : mShaders.values()) {
-            for (int shard : map.values()) {
-                glDeleteShader(shard);
+        init();
+        deleteShards();
+        mReloading = true;
+        try {
+            for (Listener l : mListeners) {
+                l.onReload(this);
             }
+        } finally {
+            mReloading = false;
         }
-        mShaders.clear();
-        for (Listener l : mListeners) {
-            l.onReload(this);
-        }
-        for (var map : mShaders.values()) {
-            for (int shard : map.values()) {
-                glDeleteShader(shard);
+        for (PendingLink link : mPendingLinks) {
+            if (checkCompile(link.mShards)) {
+                finishLink(link.mShader, link.mShards, link.mKey);
+            } else {
+                glDeleteProgram(link.mShader.mProgram);
+                link.mShader.mProgram = 0;
             }
         }
+        mPendingLinks.clear();
+        deleteShards();
+    }
+
+    private void init() {
+        if (mInitialized) {
+            return;
+        }
+        GLCapabilities caps = GL.getCapabilities();
+        // let the driver choose the number of threads
+        if (caps.GL_KHR_parallel_shader_compile) {
+            KHRParallelShaderCompile.glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            mParallelCompile = true;
+        } else if (caps.GL_ARB_parallel_shader_compile) {
+            ARBParallelShaderCompile.glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+            mParallelCompile = true;
+        }
+        String driver = glGetString(GL_VENDOR) + '\n' + glGetString(GL_RENDERER) + '\n' + glGetString(GL_VERSION);
+        mDriverInfo = driver.getBytes(StandardCharsets.UTF_8);
+        mInitialized = true;
+    }
+
+    private void deleteShards() {
+        for (int shard : mShards.keySet()) {
+            glDeleteShader(shard);
+        }
+        mShards.clear();
         mShaders.clear();
     }
 
@@ -98,7 +174,8 @@ public class ShaderManager {
     }
 
     /**
-     * Get or create a shader shard, call this on listener callback.
+     * Get or create a shader shard, call this on listener callback. The shard is
+     * compiled when it's used to create a program, and there's no binary cached.
      * <p>
      * Standard file extension:
      * <table border="1">
@@ -135,6 +212,7 @@ public class ShaderManager {
      */
     public int getShard(@Nonnull Context context, @Nonnull Path path, int type) {
         RenderCore.checkRenderThread();
+        init();
         int shader = mShaders.computeIfAbsent(context, c -> new Object2IntOpenHashMap<>()).getInt(path);
         if (shader != 0) {
             return shader;
@@ -165,13 +243,8 @@ public class ShaderManager {
             }
             shader = glCreateShader(type);
             glShaderSource(shader, source);
-            glCompileShader(shader);
-            if (glGetShaderi(shader, GL_COMPILE_STATUS) == GL_FALSE) {
-                String log = glGetShaderInfoLog(shader, 8192).trim();
-                ModernUI.LOGGER.error(MARKER, "Failed to compile shader {}:\n{}", path, log);
-                glDeleteShader(shader);
-                return 0;
-            }
+            mShards.put(shader, new Shard(path, digest(type, source)));
+            mShaders.get(context).put(path, shader);
             return shader;
         } catch (IOException e) {
             ModernUI.LOGGER.error(MARKER, "Failed to get shader source {}\n", path, e);
@@ -181,7 +254,8 @@ public class ShaderManager {
 
     /**
      * Create a shader object representing a shader program.
-     * If fails, program will be 0.
+     * If fails, program will be 0. During reloading, the link status may be
+     * checked after all listeners are called.
      *
      * @param shader the existing shader object
      * @param shards shader shards for the shader
@@ -192,32 +266,215 @@ public class ShaderManager {
     @Nonnull
     public <T extends Shader> T create(@Nullable T shader, int... shards) {
         RenderCore.checkRenderThread();
+        init();
+        if (shader == null) {
+            shader = (T) new Shader();
+        }
         int program;
-        if (shader != null && shader.mProgram != 0) {
+        if (shader.mProgram != 0) {
             program = shader.mProgram;
         } else {
             program = glCreateProgram();
         }
+        shader.mProgram = program;
+
+        final String key = mBinaryCacheDir != null ? makeKey(shards) : null;
+        if (key != null && loadBinary(program, key)) {
+            return shader;
+        }
+        // checking the status blocks until compiling and linking complete, do it later
+        final boolean deferred = mReloading && mParallelCompile;
+        startCompile(shards);
+        if (deferred ? !mayCompile(shards) : !checkCompile(shards)) {
+            glDeleteProgram(program);
+            shader.mProgram = 0;
+            return shader;
+        }
         for (int s : shards) {
             glAttachShader(program, s);
         }
+        if (key != null) {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         glLinkProgram(program);
+        if (deferred) {
+            mPendingLinks.add(new PendingLink(shader, shards, key));
+        } else {
+            finishLink(shader, shards, key);
+        }
+        return shader;
+    }
+
+    // compile the shards that are not compiled yet, without checking the status
+    private void startCompile(@Nonnull int[] shards) {
+        for (int s : shards) {
+            Shard shard = mShards.get(s);
+            if (shard != null && shard.mState == Shard.PENDING) {
+                glCompileShader(s);
+                shard.mState = Shard.COMPILING;
+            }
+        }
+    }
+
+    // false if any shard is known to be invalid, this doesn't wait for compiling
+    private boolean mayCompile(@Nonnull int[] shards) {
+        for (int s : shards) {
+            if (s == 0) {
+                return false;
+            }
+            Shard shard = mShards.get(s);
+            if (shard != null && shard.mState == Shard.FAILED) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // wait for compiling and check the status of the shards started
+    private boolean checkCompile(@Nonnull int[] shards) {
+        boolean success = true;
+        for (int s : shards) {
+            Shard shard = mShards.get(s);
+            if (shard == null) {
+                // deleted or not created by this
+                success &= s != 0 && glGetShaderi(s, GL_COMPILE_STATUS) != GL_FALSE;
+                continue;
+            }
+            if (shard.mState == Shard.COMPILING) {
+                if (glGetShaderi(s, GL_COMPILE_STATUS) == GL_FALSE) {
+                    String log = glGetShaderInfoLog(s, 8192).trim();
+                    ModernUI.LOGGER.error(MARKER, "Failed to compile shader {}:\n{}", shard.mPath, log);
+                    shard.mState = Shard.FAILED;
+                } else {
+                    shard.mState = Shard.COMPILED;
+                }
+            }
+            success &= shard.mState == Shard.COMPILED;
+        }
+        return success;
+    }
+
+    private void finishLink(@Nonnull Shader shader, @Nonnull int[] shards, @Nullable String key) {
+        final int program = shader.mProgram;
         if (glGetProgrami(program, GL_LINK_STATUS) == GL_FALSE) {
             String log = glGetProgramInfoLog(program, 8192);
             ModernUI.LOGGER.error(MARKER, "Failed to link shader program: {}", log);
             // deletion detaches all shader shards
             glDeleteProgram(program);
-            program = 0;
+            shader.mProgram = 0;
         } else {
             for (int s : shards) {
                 glDetachShader(program, s);
             }
+            if (key != null) {
+                saveBinary(program, key);
+            }
         }
-        if (shader == null) {
-            shader = (T) new Shader();
+    }
+
+    // hash the driver and shard sources, null if any shard is unknown
+    @Nullable
+    private String makeKey(@Nonnull int[] shards) {
+        final MessageDigest md = newDigest();
+        md.update(mDriverInfo);
+        for (int s : shards) {
+            Shard shard = mShards.get(s);
+            if (shard == null) {
+                return null;
+            }
+            md.update(shard.mDigest);
+        }
+        final StringBuilder b = new StringBuilder();
+        for (byte v : md.digest()) {
+            b.append(Character.forDigit((v >> 4) & 0xF, 16)).append(Character.forDigit(v & 0xF, 16));
+        }
+        return b.toString();
+    }
+
+    private boolean loadBinary(int program, @Nonnull String key) {
+        assert mBinaryCacheDir != null;
+        final Path file = mBinaryCacheDir.resolve(key + BINARY_EXTENSION);
+        if (!Files.isRegularFile(file)) {
+            return false;
+        }
+        ByteBuffer buffer = null;
+        try {
+            byte[] data = Files.readAllBytes(file);
+            if (data.length <= 4) {
+                throw new IOException("Truncated binary");
+            }
+            buffer = MemoryUtil.memAlloc(data.length).put(data).flip();
+            final int format = buffer.order(ByteOrder.LITTLE_ENDIAN).getInt(0);
+            glProgramBinary(program, format, buffer.position(4));
+            if (glGetProgrami(program, GL_LINK_STATUS) != GL_FALSE) {
+                return true;
+            }
+            // a driver update may reject old binaries
+            ModernUI.LOGGER.debug(MARKER, "Program binary {} was rejected, recompiling", key);
+        } catch (IOException e) {
+            ModernUI.LOGGER.debug(MARKER, "Failed to read program binary {}", key, e);
+        } finally {
+            MemoryUtil.memFree(buffer);
+        }
+        try {
+            Files.deleteIfExists(file);
+        } catch (IOException ignored) {
+        }
+        return false;
+    }
+
+    private void saveBinary(int program, @Nonnull String key) {
+        assert mBinaryCacheDir != null;
+        final int length = glGetProgrami(program, GL_PROGRAM_BINARY_LENGTH);
+        if (length <= 0) {
+            return;
+        }
+        final ByteBuffer buffer = MemoryUtil.memAlloc(length + 4).order(ByteOrder.LITTLE_ENDIAN);
+        Path temp = null;
+        try (MemoryStack stack = MemoryStack.stackPush()) {
+            IntBuffer format = stack.mallocInt(1);
+            glGetProgramBinary(program, null, format, buffer.position(4));
+            buffer.putInt(0, format.get(0)).position(0);
+            byte[] data = new byte[buffer.remaining()];
+            buffer.get(data);
+            // write a temp file then move, so a crash doesn't leave a broken binary
+            Files.createDirectories(mBinaryCacheDir);
+            temp = Files.createTempFile(mBinaryCacheDir, key, null);
+            Files.write(temp, data);
+            Files.move(temp, mBinaryCacheDir.resolve(key + BINARY_EXTENSION), StandardCopyOption.REPLACE_EXISTING,
+                    StandardCopyOption.ATOMIC_MOVE);
+        } catch (IOException e) {
+            ModernUI.LOGGER.debug(MARKER, "Failed to save program binary {}", key, e);
+            if (temp != null) {
+                try {
+                    Files.deleteIfExists(temp);
+                } catch (IOException ignored) {
+                }
+            }
+        } finally {
+            MemoryUtil.memFree(buffer);
+        }
+    }
+
+    @Nonnull
+    private static byte[] digest(int type, @Nonnull String source) {
+        final MessageDigest md = newDigest();
+        md.update((byte) (type >> 24));
+        md.update((byte) (type >> 16));
+        md.update((byte) (type >> 8));
+        md.update((byte) type);
+        md.update(source.getBytes(StandardCharsets.UTF_8));
+        return md.digest();
+    }
+
+    @Nonnull
+    private static MessageDigest newDigest() {
+        try {
+            return MessageDigest.getInstance("SHA-1");
+        } catch (NoSuchAlgorithmException e) {
+            // SHA-1 is required on every Java platform
+            throw new IllegalStateException(e);
         }
-        shader.mProgram = program;
-        return shader;
     }
 
     /**
@@ -229,4 +486,35 @@ public class ShaderManager {
         @RenderThread
         void onReload(@Nonnull ShaderManager manager);
     }
+
+    private static final class Shard {
+
+        private static final int PENDING = 0;
+        private static final int COMPILING = 1;
+        private static final int COMPILED = 2;
+        private static final int FAILED = 3;
+
+        private final Path mPath;
+        private final byte[] mDigest;
+        private int mState = PENDING;
+
+        private Shard(Path path, byte[] digest) {
+            mPath = path;
+            mDigest = digest;
+        }
+    }
+
+    private static final class PendingLink {
+
+        private final Shader mShader;
+        private final int[] mShards;
+        @Nullable
+        private final String mKey;
+
+        private PendingLink(Shader shader, int[] shards, @Nullable String key) {
+            mShader = shader;
+            mShards = shards;
+            mKey = key;
+        }
+    }
 }
@@ -161,6 +161,17 @@ public class Texture2D extends Texture {
         nglTextureSubImage2D(get(), level, x, y, width, height, format, type, pixels);
     }
 
+    /**
+     * Clears the image of a level to zero.
+     *
+     * @param level  the level for the image
+     * @param format the format of the image, compatible with the internal format
+     * @param type   the type of the image data
+     */
+    public void clear(int level, int format, int type) {
+        nglClearTexImage(get(), level, format, type, MemoryUtil.NULL);
+    }
+
     /**
      * Set wrap mode.
      */
@@ -18,20 +18,96 @@
 
 package icyllis.modernui.graphics.texture;
 
+import icyllis.modernui.ModernUI;
+import icyllis.modernui.annotation.RenderThread;
 import icyllis.modernui.core.Context;
+import icyllis.modernui.graphics.Image;
+import icyllis.modernui.platform.Bitmap;
+import icyllis.modernui.platform.RenderCore;
 import it.unimi.dsi.fastutil.objects.Object2ObjectRBTreeMap;
+import org.apache.logging.log4j.Marker;
+import org.apache.logging.log4j.MarkerManager;
 
+import javax.annotation.Nonnull;
+import javax.annotation.Nullable;
+import java.lang.ref.WeakReference;
+import java.nio.ByteBuffer;
 import java.nio.file.Path;
-import java.util.HashMap;
-import java.util.Map;
+import java.util.*;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.atomic.AtomicInteger;
 
+import static icyllis.modernui.graphics.GLWrapper.*;
+import static org.lwjgl.system.MemoryUtil.memAddress;
+import static org.lwjgl.system.MemoryUtil.memCopy;
+
+/**
+ * Manages textures of images. Async images are decoded on a worker pool into native
+ * bitmaps, then uploaded through a pixel buffer on render thread in chunks, within
+ * a time budget per frame. A placeholder image is returned until the texture is ready.
+ * <p>
+ * Loaded textures are kept until the total size exceeds the memory budget, then the
+ * least recently requested ones are deleted if their images are closed (or no longer
+ * referenced) and no recorded draw uses them, that is, no render node holds them
+ * and the frames that have drawn them are rendered. Close images when they are no
+ * longer needed, so their textures can be deleted without waiting for GC.
+ */
 public class TextureManager {
 
+    public static final Marker MARKER = MarkerManager.getMarker("TextureManager");
+
     private static final TextureManager INSTANCE = new TextureManager();
 
+    /**
+     * Default upload time per frame, 2 milliseconds.
+     */
+    public static final long DEFAULT_UPLOAD_BUDGET = 2_000_000;
+
+    /**
+     * Default GPU memory for async textures, 256 MB.
+     */
+    public static final long DEFAULT_MEMORY_BUDGET = 256L << 20;
+
+    // bytes per upload
+    private static final int CHUNK_SIZE = 1 << 20;
+    private static final int MAX_MIPMAP_LEVEL = 4;
+
     private final Map<Context, Map<Path, Texture2D>> mTextureMap = new HashMap<>();
 
+    // access ordered, the eldest is the least recently requested, guarded by itself
+    private final LinkedHashMap<Key, Entry> mEntries = new LinkedHashMap<>(16, 0.75f, true);
+    // decoded bitmaps waiting for upload
+    private final Queue<Entry> mUploads = new ConcurrentLinkedQueue<>();
+    private final ExecutorService mDecoder;
+
+    private final Image.Source mPlaceholder;
+
+    private volatile long mUploadBudget = DEFAULT_UPLOAD_BUDGET;
+    private volatile long mMemoryBudget = DEFAULT_MEMORY_BUDGET;
+    private long mMemoryUsage;
+
+    // render thread only
+    private int mPixelBuffer;
+    private Entry mCurrentUpload;
+
     private TextureManager() {
+        final AtomicInteger count = new AtomicInteger();
+        final int threads = Math.max(1, Math.min(Runtime.getRuntime().availableProcessors() - 1, 4));
+        mDecoder = Executors.newFixedThreadPool(threads, r -> {
+            Thread t = new Thread(r, "mui-image-decoder-" + count.incrementAndGet());
+            t.setDaemon(true);
+            t.setPriority(Thread.NORM_PRIORITY - 1);
+            return t;
+        });
+        // an empty image, it's fully transparent
+        final Texture2D texture = new Texture2D();
+        RenderCore.recordRenderCall(() -> {
+            texture.init(GL_RGBA8, 1, 1, 0);
+            texture.clear(0, GL_RGBA, GL_UNSIGNED_BYTE);
+        });
+        mPlaceholder = new Image.Source(texture, 0, 0);
     }
 
     public static TextureManager getINSTANCE() {
@@ -40,6 +116,16 @@ public class TextureManager {
 
     public void reload() {
         mTextureMap.clear();
+        // drop unused async textures, so they are loaded from new resources next time
+        synchronized (mEntries) {
+            for (Iterator<Entry> it = mEntries.values().iterator(); it.hasNext(); ) {
+                Entry entry = it.next();
+                if (isEvictable(entry)) {
+                    it.remove();
+                    release(entry);
+                }
+            }
+        }
     }
 
     public Texture2D getOrCreate(Context context, Path path) {
@@ -50,4 +136,303 @@ public class TextureManager {
         }
         return null;
     }
+
+    /**
+     * Gets an image and loads it asynchronously if not loaded. The returned image draws
+     * nothing and has zero size until the texture is uploaded. The same image is returned
+     * for the same path while it's referenced.
+     *
+     * @param context  the application context
+     * @param path     the path of the image resource
+     * @param mipmap   whether to generate mipmaps and use linear filtering, this only
+     *                 takes effect on the first time
+     * @param onLoaded called on render thread when the texture is ready, or immediately
+     *                 on the calling thread if it's ready already, can be null
+     * @return the image
+     */
+    @Nonnull
+    public Image getImageAsync(@Nonnull Context context, @Nonnull Path path, boolean mipmap,
+                               @Nullable Runnable onLoaded) {
+        final Key key = new Key(context, path);
+        final Entry entry;
+        final Image image;
+        synchronized (mEntries) {
+            Entry e = mEntries.get(key);
+            if (e != null) {
+                Image img = e.mImage.get();
+                if (img == null || img.isClosed()) {
+                    img = new Image(e.mSource != null ? e.mSource : mPlaceholder);
+                    e.mImage = new WeakReference<>(img);
+                }
+                if (onLoaded != null) {
+                    if (e.mSource != null) {
+                        onLoaded.run();
+                    } else {
+                        e.mCallbacks.add(onLoaded);
+                    }
+                }
+                return img;
+            }
+            entry = new Entry(key, mipmap);
+            image = new Image(mPlaceholder);
+            entry.mImage = new WeakReference<>(image);
+            if (onLoaded != null) {
+                entry.mCallbacks.add(onLoaded);
+            }
+            mEntries.put(key, entry);
+        }
+        Bitmap.decodeAsync(Bitmap.Format.RGBA, () -> context.getResource(path), mDecoder)
+                .whenComplete((bitmap, throwable) -> {
+                    if (bitmap != null) {
+                        entry.mBitmap = bitmap;
+                        mUploads.add(entry);
+                    } else {
+                        ModernUI.LOGGER.warn(MARKER, "Failed to decode image {}", path, throwable);
+                        synchronized (mEntries) {
+                            mEntries.remove(key, entry);
+                        }
+                    }
+                });
+        return image;
+    }
+
+    /**
+     * Sets the max time to upload textures in a frame, at least one chunk is uploaded a frame.
+     *
+     * @param nanos the time in nanoseconds
+     */
+    public void setUploadBudget(long nanos) {
+        mUploadBudget = nanos;
+    }
+
+    /**
+     * Sets the total size of async textures to keep in bytes. Textures still in
+     * use are never deleted, so the usage may exceed the budget.
+     *
+     * @param bytes the size in bytes
+     */
+    public void setMemoryBudget(long bytes) {
+        mMemoryBudget = bytes;
+        synchronized (mEntries) {
+            trim();
+        }
+    }
+
+    /**
+     * Returns the estimated GPU memory used by async textures in bytes.
+     */
+    public long getMemoryUsage() {
+        synchronized (mEntries) {
+            return mMemoryUsage;
+        }
+    }
+
+    /**
+     * Uploads decoded images within the time budget and deletes textures that became
+     * evictable, call this once per frame before rendering.
+     */
+    @RenderThread
+    public void processUploads() {
+        // usages are released when frames are rendered, check the budget again
+        synchronized (mEntries) {
+            trim();
+        }
+        if (mCurrentUpload == null && mUploads.isEmpty()) {
+            return;
+        }
+        final long deadline = RenderCore.timeNanos() + mUploadBudget;
+        final int lastUnpackBuffer = glGetInteger(GL_PIXEL_UNPACK_BUFFER_BINDING);
+        do {
+            Entry entry = mCurrentUpload;
+            if (entry == null) {
+                if ((entry = mUploads.poll()) == null) {
+                    break;
+                }
+                begin(entry);
+                mCurrentUpload = entry;
+            }
+            if (uploadChunk(entry)) {
+                finish(entry);
+                mCurrentUpload = null;
+            }
+        } while (RenderCore.timeNanos() < deadline);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, lastUnpackBuffer);
+    }
+
+    private void begin(@Nonnull Entry entry) {
+        final Bitmap bitmap = entry.mBitmap;
+        final int width = bitmap.getWidth();
+        final int height = bitmap.getHeight();
+        final int maxLevel = entry.mMipmap ?
+                Math.min(31 - Integer.numberOfLeadingZeros(Math.min(width, height)), MAX_MIPMAP_LEVEL) : 0;
+        final Texture2D texture = new Texture2D();
+        texture.init(GL_RGBA8, width, height, maxLevel);
+        entry.mTexture = texture;
+        entry.mMaxLevel = maxLevel;
+        entry.mUploadedRows = 0;
+    }
+
+    // returns true if all rows are uploaded
+    private boolean uploadChunk(@Nonnull Entry entry) {
+        final Bitmap bitmap = entry.mBitmap;
+        final int width = bitmap.getWidth();
+        final int rowBytes = width * bitmap.getFormat().channels;
+        final int row = entry.mUploadedRows;
+        final int rows = Math.min(Math.max(1, CHUNK_SIZE / rowBytes), bitmap.getHeight() - row);
+        final int bytes = rows * rowBytes;
+
+        if (mPixelBuffer == 0) {
+            mPixelBuffer = glCreateBuffers();
+        }
+        // orphan the last storage, so we don't wait for the last transfer
+        glNamedBufferData(mPixelBuffer, bytes, GL_STREAM_DRAW);
+        ByteBuffer mapped = glMapNamedBufferRange(mPixelBuffer, 0, bytes,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (mapped == null) {
+            throw new IllegalStateException("Failed to map pixel buffer");
+        }
+        memCopy(bitmap.getPixels() + (long) row * rowBytes, memAddress(mapped), bytes);
+        glUnmapNamedBuffer(mPixelBuffer);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffer);
+        // the pointer is the offset into the pixel buffer
+        entry.mTexture.upload(0, 0, row, width, rows, 0, 0, 0, 1,
+                bitmap.getFormat().glFormat, GL_UNSIGNED_BYTE, 0);
+        entry.mUploadedRows = row + rows;
+        return entry.mUploadedRows >= bitmap.getHeight();
+    }
+
+    private void finish(@Nonnull Entry entry) {
+        final Bitmap bitmap = entry.mBitmap;
+        final int width = bitmap.getWidth();
+        final int height = bitmap.getHeight();
+        bitmap.release();
+        entry.mBitmap = null;
+
+        final Texture2D texture = entry.mTexture;
+        if (entry.mMaxLevel > 0) {
+            texture.setFilter(true, true);
+            texture.generateMipmap();
+        } else {
+            texture.setFilter(false, false);
+        }
+        long size = (long) width * height * 4;
+        if (entry.mMaxLevel > 0) {
+            size += size / 3;
+        }
+        final Image.Source source = new Image.Source(texture, width, height);
+
+        final List<Runnable> callbacks;
+        synchronized (mEntries) {
+            entry.mSource = source;
+            entry.mSize = size;
+            mMemoryUsage += size;
+            Image image = entry.mImage.get();
+            if (image != null) {
+                image.setSource(source);
+            }
+            callbacks = new ArrayList<>(entry.mCallbacks);
+            entry.mCallbacks.clear();
+            if (mEntries.get(entry.mKey) != entry) {
+                // removed while loading
+                release(entry);
+            }
+            trim();
+        }
+        for (Runnable r : callbacks) {
+            r.run();
+        }
+    }
+
+    // evict unused textures in LRU order until the usage is within the budget, holding the lock
+    private void trim() {
+        if (mMemoryUsage <= mMemoryBudget) {
+            return;
+        }
+        for (Iterator<Entry> it = mEntries.values().iterator(); it.hasNext() && mMemoryUsage > mMemoryBudget; ) {
+            Entry entry = it.next();
+            if (isEvictable(entry)) {
+                it.remove();
+                release(entry);
+            }
+        }
+    }
+
+    // images are not drawn once closed or unreachable, but render nodes and frame packets
+    // recorded before may still draw the texture
+    private static boolean isEvictable(@Nonnull Entry entry) {
+        final Image.Source source = entry.mSource;
+        if (source == null || source.isInUse()) {
+            return false;
+        }
+        final Image image = entry.mImage.get();
+        return image == null || image.isClosed();
+    }
+
+    // holding the lock
+    private void release(@Nonnull Entry entry) {
+        if (entry.mTexture != null) {
+            mMemoryUsage -= entry.mSize;
+            entry.mSize = 0;
+            // this can be called from any thread
+            entry.mTexture.close();
+            entry.mTexture = null;
+        }
+    }
+
+    private static final class Key {
+
+        private final Context mContext;
+        private final Path mPath;
+
+        private Key(Context context, Path path) {
+            mContext = context;
+            mPath = path;
+        }
+
+        @Override
+        public boolean equals(Object o) {
+            if (this == o) return true;
+            if (o == null || getClass() != o.getClass()) return false;
+
+            Key key = (Key) o;
+
+            if (!mContext.equals(key.mContext)) return false;
+            return mPath.equals(key.mPath);
+        }
+
+        @Override
+        public int hashCode() {
+            int result = mContext.hashCode();
+            result = 31 * result + mPath.hashCode();
+            return result;
+        }
+    }
+
+    private static final class Entry {
+
+        private final Key mKey;
+        private final boolean mMipmap;
+
+        // the image handed out, if it's no longer referenced, the texture can be evicted
+        private WeakReference<Image> mImage;
+        private final List<Runnable> mCallbacks = new ArrayList<>(1);
+
+        // set by decoder, cleared when uploaded
+        private volatile Bitmap mBitmap;
+
+        // render thread
+        private Texture2D mTexture;
+        private int mMaxLevel;
+        private int mUploadedRows;
+
+        // set when ready
+        private Image.Source mSource;
+        private long mSize;
+
+        private Entry(Key key, boolean mipmap) {
+            mKey = key;
+            mMipmap = mipmap;
+        }
+    }
 }
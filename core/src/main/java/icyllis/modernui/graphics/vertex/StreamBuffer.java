@@ -0,0 +1,293 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.graphics.vertex;
+
+import icyllis.modernui.ModernUI;
+import icyllis.modernui.annotation.RenderThread;
+import icyllis.modernui.platform.RenderCore;
+import it.unimi.dsi.fastutil.ints.IntArrayList;
+import it.unimi.dsi.fastutil.ints.IntList;
+import it.unimi.dsi.fastutil.longs.LongArrayList;
+import it.unimi.dsi.fastutil.longs.LongList;
+import org.lwjgl.system.MemoryUtil;
+
+import javax.annotation.Nonnull;
+import javax.annotation.concurrent.NotThreadSafe;
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.List;
+
+import static icyllis.modernui.graphics.GLWrapper.*;
+
+/**
+ * A persistently mapped, coherent and triple-buffered vertex buffer for streaming
+ * per-frame data. Elements are written directly to the mapped memory, there's no
+ * upload copy. Each frame region is protected by a fence, so we never write to the
+ * memory that the GPU is still reading.
+ * <p>
+ * The buffer consists of pages, each page is a buffer object containing {@link #FRAMES}
+ * regions, each region holds a fixed number of elements of the same size. When a frame
+ * needs more elements, a new page is chained instead of reallocating the old ones.
+ * Since recording may not happen on the render thread, new pages are backed by client
+ * memory while recording, and created on the render thread later in {@link #flush()}.
+ */
+@NotThreadSafe
+public final class StreamBuffer implements AutoCloseable {
+
+    /**
+     * The number of frames in flight.
+     */
+    public static final int FRAMES = 3;
+
+    private static final int MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    // the size of an element in bytes
+    private final int mStride;
+    // the number of elements of a region in a page
+    private final int mPageCapacity;
+    // the size of a region in bytes
+    private final int mRegionSize;
+
+    // buffer objects and their mapped pointers
+    private final IntList mPages = new IntArrayList();
+    private final LongList mPointers = new LongArrayList();
+    // cached memory views of each region of each page
+    private final List<ByteBuffer[]> mViews = new ArrayList<>();
+
+    // pages created while recording, backed by client memory
+    private final List<ByteBuffer> mPendingPages = new ArrayList<>();
+
+    private final long[] mFences = new long[FRAMES];
+
+    // the current frame region
+    private int mFrame;
+
+    // recording states
+    private ByteBuffer mCurrent;
+    private int mPageIndex = -1;
+    private int mCount;
+
+    // rendering states
+    private int mBoundPage = -1;
+
+    /**
+     * Creates a stream buffer. No GL calls are made here.
+     *
+     * @param stride       the size of an element in bytes
+     * @param pageCapacity the number of elements of a page in a frame
+     */
+    public StreamBuffer(int stride, int pageCapacity) {
+        if (stride <= 0 || pageCapacity <= 0) {
+            throw new IllegalArgumentException();
+        }
+        mStride = stride;
+        mPageCapacity = pageCapacity;
+        mRegionSize = stride * pageCapacity;
+    }
+
+    /**
+     * Returns the buffer to write the next element. The caller must write exactly
+     * one element of {@link #getStride()} bytes before calling this method again.
+     *
+     * @return the memory to write
+     */
+    @Nonnull
+    public ByteBuffer next() {
+        ByteBuffer buffer = mCurrent;
+        if (buffer == null || buffer.remaining() < mStride) {
+            buffer = nextPage();
+        }
+        mCount++;
+        return buffer;
+    }
+
+    /**
+     * Copies consecutive elements to this buffer, they may be split into multiple
+     * pages. The data is read from its position to its limit.
+     *
+     * @param data  the element data, must be a multiple of {@link #getStride()}
+     * @param count the number of elements
+     */
+    public void put(@Nonnull ByteBuffer data, int count) {
+        if (data.remaining() != count * mStride) {
+            throw new IllegalArgumentException();
+        }
+        final int limit = data.limit();
+        while (count > 0) {
+            ByteBuffer buffer = mCurrent;
+            if (buffer == null || buffer.remaining() < mStride) {
+                buffer = nextPage();
+            }
+            int n = Math.min(count, buffer.remaining() / mStride);
+            data.limit(data.position() + n * mStride);
+            buffer.put(data);
+            mCount += n;
+            count -= n;
+        }
+        data.limit(limit);
+    }
+
+    @Nonnull
+    private ByteBuffer nextPage() {
+        final int index = ++mPageIndex;
+        if (index < mPages.size()) {
+            ByteBuffer[] views = mViews.get(index);
+            ByteBuffer view = views[mFrame];
+            if (view == null) {
+                view = MemoryUtil.memByteBuffer(mPointers.getLong(index) + (long) mFrame * mRegionSize, mRegionSize);
+                views[mFrame] = view;
+            } else {
+                view.clear();
+            }
+            mCurrent = view;
+        } else {
+            // we may not be on render thread, create it later
+            mCurrent = MemoryUtil.memAlloc(mRegionSize);
+            mPendingPages.add(mCurrent);
+            ModernUI.LOGGER.debug(MARKER, "Chain a new stream page of {} bytes", mRegionSize);
+        }
+        return mCurrent;
+    }
+
+    /**
+     * @return the number of elements written in the current frame
+     */
+    public int getCount() {
+        return mCount;
+    }
+
+    public int getStride() {
+        return mStride;
+    }
+
+    public int getPageCapacity() {
+        return mPageCapacity;
+    }
+
+    /**
+     * Drops the elements written in the current frame without drawing them, then
+     * the frame can be recorded again from the beginning.
+     */
+    public void discard() {
+        for (ByteBuffer pending : mPendingPages) {
+            MemoryUtil.memFree(pending);
+        }
+        mPendingPages.clear();
+        mCurrent = null;
+        mPageIndex = -1;
+        mCount = 0;
+    }
+
+    /**
+     * Creates buffer objects for pages chained while recording, and copies the
+     * data to the mapped memory. This must be called before drawing.
+     */
+    @RenderThread
+    public void flush() {
+        RenderCore.checkRenderThread();
+        if (mPendingPages.isEmpty()) {
+            return;
+        }
+        final long size = (long) mRegionSize * FRAMES;
+        for (ByteBuffer pending : mPendingPages) {
+            int page = glCreateBuffers();
+            glNamedBufferStorage(page, size, MAP_FLAGS);
+            long pointer = nglMapNamedBufferRange(page, 0, size, MAP_FLAGS);
+            if (pointer == MemoryUtil.NULL) {
+                throw new IllegalStateException("Failed to map stream buffer");
+            }
+            MemoryUtil.memCopy(MemoryUtil.memAddress0(pending),
+                    pointer + (long) mFrame * mRegionSize, pending.position());
+            MemoryUtil.memFree(pending);
+            mPages.add(page);
+            mPointers.add(pointer);
+            mViews.add(new ByteBuffer[FRAMES]);
+        }
+        mPendingPages.clear();
+        mCurrent = null;
+    }
+
+    /**
+     * Binds the page containing the element to the given binding point of a
+     * vertex format, and returns the index of the element in that page.
+     * The result is used as the base vertex or the base instance.
+     *
+     * @param format  the vertex format
+     * @param binding the binding point
+     * @param element the index of the element in the current frame
+     * @return the index relative to the page
+     */
+    @RenderThread
+    public int bind(@Nonnull VertexFormat format, int binding, int element) {
+        final int page = element / mPageCapacity;
+        if (page != mBoundPage) {
+            format.setVertexBuffer(binding, mPages.getInt(page), mFrame * mRegionSize);
+            mBoundPage = page;
+        }
+        return element % mPageCapacity;
+    }
+
+    /**
+     * Fences the current frame and moves to the next frame region, waiting for
+     * the GPU if it's still reading the region. Call this after drawing.
+     */
+    @RenderThread
+    public void finish() {
+        RenderCore.checkRenderThread();
+        mFences[mFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        mFrame = (mFrame + 1) % FRAMES;
+        final long fence = mFences[mFrame];
+        if (fence != MemoryUtil.NULL) {
+            int status;
+            do {
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1_000_000L);
+            } while (status == GL_TIMEOUT_EXPIRED);
+            glDeleteSync(fence);
+            mFences[mFrame] = MemoryUtil.NULL;
+        }
+        mCurrent = null;
+        mPageIndex = -1;
+        mCount = 0;
+        mBoundPage = -1;
+    }
+
+    @RenderThread
+    @Override
+    public void close() {
+        RenderCore.checkRenderThread();
+        for (int i = 0; i < FRAMES; i++) {
+            if (mFences[i] != MemoryUtil.NULL) {
+                glDeleteSync(mFences[i]);
+                mFences[i] = MemoryUtil.NULL;
+            }
+        }
+        for (int page : mPages) {
+            glUnmapNamedBuffer(page);
+            glDeleteBuffers(page);
+        }
+        mPages.clear();
+        mPointers.clear();
+        mViews.clear();
+        for (ByteBuffer pending : mPendingPages) {
+            MemoryUtil.memFree(pending);
+        }
+        mPendingPages.clear();
+        mCurrent = null;
+    }
+}
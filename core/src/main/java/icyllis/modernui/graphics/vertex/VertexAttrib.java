@@ -152,6 +152,7 @@ public class VertexAttrib {
         VEC2(2, 1),
         VEC3(3, 1),
         VEC4(4, 1),
+        MAT2X4(4, 2),
         MAT4(4, 4);
 
         /**
@@ -48,6 +48,10 @@ import java.nio.file.Path;
 import java.nio.file.StandardOpenOption;
 import java.util.Arrays;
 import java.util.Date;
+import java.util.concurrent.Callable;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.CompletionException;
+import java.util.concurrent.Executor;
 import java.util.stream.Collectors;
 
 import static icyllis.modernui.graphics.GLWrapper.*;
@@ -211,6 +215,28 @@ public final class Bitmap implements AutoCloseable {
         }
     }
 
+    /**
+     * Decodes an image on the executor, the channel is opened and closed there. The
+     * pixels are in native memory, so the bitmap can be uploaded from any thread.
+     *
+     * @param format   the format to convert to, or {@code null} to use format in file
+     * @param opener   opens the input channel
+     * @param executor the executor to decode on
+     * @return a future completed with the bitmap, or exceptionally if failed to decode
+     */
+    @Nonnull
+    public static CompletableFuture<Bitmap> decodeAsync(@Nullable Format format,
+                                                        @Nonnull Callable<ReadableByteChannel> opener,
+                                                        @Nonnull Executor executor) {
+        return CompletableFuture.supplyAsync(() -> {
+            try (ReadableByteChannel channel = opener.call()) {
+                return decode(format, channel);
+            } catch (Exception e) {
+                throw new CompletionException(e);
+            }
+        }, executor);
+    }
+
     /**
      * Decodes an image from input stream. This method doesn't close input stream.
      *
@@ -0,0 +1,359 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.platform;
+
+import icyllis.modernui.annotation.RenderThread;
+import icyllis.modernui.annotation.UiThread;
+import jdk.jfr.*;
+
+import javax.annotation.Nonnull;
+import java.util.concurrent.atomic.AtomicIntegerArray;
+import java.util.concurrent.atomic.AtomicLongArray;
+
+import static icyllis.modernui.graphics.GLWrapper.*;
+
+/**
+ * A low-overhead frame profiler. Each phase of the UI thread and the render thread is
+ * timed by {@link #begin()} and {@link #end(int, long)}, a phase may run several times
+ * a frame and the times are summed. When a frame ends, the time of each phase is put
+ * into a ring buffer, which has only one writer, so it's read without locking.
+ * <p>
+ * The GPU time of the canvas is measured by {@code GL_TIME_ELAPSED} queries, the
+ * results are read a few frames later to avoid stalls. The profiler does nothing
+ * unless it's enabled or the JFR event {@code icyllis.modernui.Frame} is recorded.
+ */
+public final class FrameProfiler {
+
+    // UI thread phases
+    public static final int UI_INPUT = 0;
+    public static final int UI_ANIMATION = 1;
+    public static final int UI_LAYOUT = 2;
+    public static final int UI_RECORD = 3;
+    // render thread phases
+    public static final int RENDER_FLUSH = 4;
+    public static final int RENDER_GLYPHS = 5;
+    public static final int RENDER_CANVAS = 6;
+    public static final int RENDER_COMPOSITE = 7;
+    // GPU time of the canvas
+    public static final int GPU_CANVAS = 8;
+
+    public static final int PHASE_COUNT = 9;
+
+    private static final String[] PHASE_NAMES = {
+            "Input", "Animation", "Layout", "Record",
+            "Flush", "Glyphs", "Canvas", "Composite",
+            "GPU Canvas"
+    };
+
+    // counters, summed between two render frames
+    public static final int DRAW_CALLS = 0;
+    public static final int INSTANCES = 1;
+    public static final int INSTANCE_BYTES = 2;
+    public static final int GLYPH_MISSES = 3;
+    public static final int LAYOUT_HITS = 4;
+    public static final int LAYOUT_MISSES = 5;
+
+    public static final int COUNTER_COUNT = 6;
+
+    /**
+     * The number of frames kept.
+     */
+    public static final int RING_SIZE = 64;
+
+    private static final int GPU_QUERIES = 4;
+
+    private static volatile boolean sEnabled;
+    private static volatile boolean sActive;
+
+    private static final EventType sEventType = EventType.getEventType(FrameEvent.class);
+
+    // per-frame sums, each phase is written by only one thread
+    private static final long[] sPhaseTimes = new long[PHASE_COUNT];
+    // [phase * RING_SIZE + frame]
+    private static final AtomicLongArray sRing = new AtomicLongArray(PHASE_COUNT * RING_SIZE);
+    private static final AtomicIntegerArray sCursors = new AtomicIntegerArray(PHASE_COUNT);
+
+    private static final AtomicLongArray sCounters = new AtomicLongArray(COUNTER_COUNT);
+    // the counters of the last frame
+    private static final long[] sLastCounters = new long[COUNTER_COUNT];
+
+    // render thread only
+    private static final int[] sQueries = new int[GPU_QUERIES];
+    private static int sQueryIndex;
+    private static int sQueryPending;
+    private static boolean sQueryStarted;
+
+    private FrameProfiler() {
+    }
+
+    /**
+     * Enables or disables the profiler, the JFR event is recorded regardless.
+     */
+    public static void setEnabled(boolean enabled) {
+        sEnabled = enabled;
+        sActive = enabled || sEventType.isEnabled();
+    }
+
+    public static boolean isActive() {
+        return sActive;
+    }
+
+    /**
+     * Starts a scope.
+     *
+     * @return the start time, or 0 if not profiling
+     */
+    public static long begin() {
+        return sActive ? System.nanoTime() : 0;
+    }
+
+    /**
+     * Ends a scope started by {@link #begin()}, must be called on the thread of the phase.
+     *
+     * @param phase the phase
+     * @param start the return value of {@link #begin()}
+     */
+    public static void end(int phase, long start) {
+        if (start != 0) {
+            sPhaseTimes[phase] += System.nanoTime() - start;
+        }
+    }
+
+    /**
+     * Adds a value to a counter, this can be called from any thread.
+     */
+    public static void count(int counter, long value) {
+        if (sActive) {
+            sCounters.getAndAdd(counter, value);
+        }
+    }
+
+    /**
+     * Ends a frame of the UI thread.
+     */
+    @UiThread
+    public static void endUiFrame() {
+        if (sActive) {
+            commit(UI_INPUT, UI_RECORD);
+        }
+    }
+
+    /**
+     * Ends a frame of the render thread and emits a JFR event if it's recorded.
+     */
+    @RenderThread
+    public static void endRenderFrame() {
+        final boolean recording = sEventType.isEnabled();
+        final boolean active = sEnabled || recording;
+        if (sActive) {
+            commit(RENDER_FLUSH, RENDER_COMPOSITE);
+            for (int i = 0; i < COUNTER_COUNT; i++) {
+                sLastCounters[i] = sCounters.getAndSet(i, 0);
+            }
+            if (recording) {
+                emitEvent();
+            }
+        }
+        sActive = active;
+    }
+
+    private static void commit(int firstPhase, int lastPhase) {
+        for (int phase = firstPhase; phase <= lastPhase; phase++) {
+            put(phase, sPhaseTimes[phase]);
+            sPhaseTimes[phase] = 0;
+        }
+    }
+
+    private static void put(int phase, long time) {
+        final int cursor = sCursors.get(phase);
+        sRing.lazySet(phase * RING_SIZE + (cursor & (RING_SIZE - 1)), time);
+        sCursors.lazySet(phase, cursor + 1);
+    }
+
+    /**
+     * Starts a GPU timer query, must be paired with {@link #endGpu()}.
+     */
+    @RenderThread
+    public static void beginGpu() {
+        if (!sActive) {
+            return;
+        }
+        if (sQueries[0] == 0) {
+            glGenQueries(sQueries);
+        }
+        // read the oldest result if the ring is full, it's usually available already
+        if (sQueryPending == GPU_QUERIES) {
+            readQuery((sQueryIndex - GPU_QUERIES) & (GPU_QUERIES - 1));
+        }
+        glBeginQuery(GL_TIME_ELAPSED, sQueries[sQueryIndex & (GPU_QUERIES - 1)]);
+        sQueryStarted = true;
+    }
+
+    @RenderThread
+    public static void endGpu() {
+        if (!sQueryStarted) {
+            return;
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        sQueryStarted = false;
+        sQueryIndex++;
+        sQueryPending++;
+        // collect the results that are ready
+        while (sQueryPending > 0) {
+            final int index = (sQueryIndex - sQueryPending) & (GPU_QUERIES - 1);
+            if (glGetQueryObjecti(sQueries[index], GL_QUERY_RESULT_AVAILABLE) == GL_FALSE) {
+                break;
+            }
+            readQuery(index);
+        }
+    }
+
+    private static void readQuery(int index) {
+        put(GPU_CANVAS, glGetQueryObjecti64(sQueries[index], GL_QUERY_RESULT));
+        sQueryPending--;
+    }
+
+    /**
+     * Returns the average time of a phase in nanoseconds over the recent frames.
+     */
+    public static long getAverageTime(int phase) {
+        final int cursor = sCursors.get(phase);
+        final int n = Math.min(cursor, RING_SIZE);
+        if (n == 0) {
+            return 0;
+        }
+        long sum = 0;
+        for (int i = 1; i <= n; i++) {
+            sum += sRing.get(phase * RING_SIZE + ((cursor - i) & (RING_SIZE - 1)));
+        }
+        return sum / n;
+    }
+
+    /**
+     * Returns the max time of a phase in nanoseconds over the recent frames.
+     */
+    public static long getMaxTime(int phase) {
+        final int cursor = sCursors.get(phase);
+        long max = 0;
+        for (int i = 1, n = Math.min(cursor, RING_SIZE); i <= n; i++) {
+            max = Math.max(max, sRing.get(phase * RING_SIZE + ((cursor - i) & (RING_SIZE - 1))));
+        }
+        return max;
+    }
+
+    /**
+     * Returns the value of a counter in the last frame.
+     */
+    public static long getLastCount(int counter) {
+        return sLastCounters[counter];
+    }
+
+    @Nonnull
+    public static String getPhaseName(int phase) {
+        return PHASE_NAMES[phase];
+    }
+
+    private static long last(int phase) {
+        final int cursor = sCursors.get(phase);
+        return cursor == 0 ? 0 : sRing.get(phase * RING_SIZE + ((cursor - 1) & (RING_SIZE - 1)));
+    }
+
+    private static void emitEvent() {
+        final FrameEvent event = new FrameEvent();
+        event.input = last(UI_INPUT);
+        event.animation = last(UI_ANIMATION);
+        event.layout = last(UI_LAYOUT);
+        event.record = last(UI_RECORD);
+        event.flush = last(RENDER_FLUSH);
+        event.glyphs = last(RENDER_GLYPHS);
+        event.canvas = last(RENDER_CANVAS);
+        event.composite = last(RENDER_COMPOSITE);
+        event.gpuCanvas = last(GPU_CANVAS);
+        event.drawCalls = sLastCounters[DRAW_CALLS];
+        event.instances = sLastCounters[INSTANCES];
+        event.instanceBytes = sLastCounters[INSTANCE_BYTES];
+        event.glyphMisses = sLastCounters[GLYPH_MISSES];
+        event.layoutHits = sLastCounters[LAYOUT_HITS];
+        event.layoutMisses = sLastCounters[LAYOUT_MISSES];
+        event.commit();
+    }
+
+    @Name("icyllis.modernui.Frame")
+    @Label("Modern UI Frame")
+    @Category("Modern UI")
+    @Description("Phase times and counters of a rendered frame")
+    @StackTrace(false)
+    static final class FrameEvent extends Event {
+
+        @Label("Input")
+        @Timespan
+        long input;
+
+        @Label("Animation")
+        @Timespan
+        long animation;
+
+        @Label("Layout")
+        @Timespan
+        long layout;
+
+        @Label("Record")
+        @Timespan
+        long record;
+
+        @Label("Flush Render Calls")
+        @Timespan
+        long flush;
+
+        @Label("Glyph Uploading")
+        @Timespan
+        long glyphs;
+
+        @Label("Canvas")
+        @Timespan
+        long canvas;
+
+        @Label("Composite")
+        @Timespan
+        long composite;
+
+        @Label("GPU Canvas")
+        @Timespan
+        long gpuCanvas;
+
+        @Label("Draw Calls")
+        long drawCalls;
+
+        @Label("Instances")
+        long instances;
+
+        @Label("Instance Bytes")
+        @DataAmount
+        long instanceBytes;
+
+        @Label("Glyph Cache Misses")
+        long glyphMisses;
+
+        @Label("Layout Cache Hits")
+        long layoutHits;
+
+        @Label("Layout Cache Misses")
+        long layoutMisses;
+    }
+}
@@ -18,9 +18,366 @@
 
 package icyllis.modernui.text;
 
+import icyllis.modernui.graphics.font.FontMetricsInt;
+import icyllis.modernui.text.style.UpdateLayout;
+import it.unimi.dsi.fastutil.ints.IntArrayList;
+
+import javax.annotation.Nonnull;
+import java.lang.ref.WeakReference;
+
+/**
+ * DynamicLayout is a text layout that updates itself as the text is edited or its
+ * spans are changed. Only the paragraphs affected by a change are measured and broken
+ * into lines again, the lines of the rest paragraphs are shifted. So the cost of an
+ * edit depends on the length of the edited paragraph rather than the whole text.
+ * <p>
+ * Span changes are observed through a {@link SpanWatcher} attached to the text.
+ * Editable texts should call {@link #reflow(int, int, int)} after changing chars.
+ */
 public class DynamicLayout extends TextLayout {
 
-    protected DynamicLayout(CharSequence text) {
+    private static final int COLUMNS = 4;
+
+    private static final int START = 0;
+    private static final int TOP = 1;
+    private static final int DESCENT = 2;
+    // float bits
+    private static final int WIDTH = 3;
+
+    @Nonnull
+    private final TextPaint mPaint;
+    @Nonnull
+    private final TextDirectionHeuristic mTextDir;
+    private final boolean mFallbackLineSpacing;
+    private int mWidth;
+
+    /**
+     * Line data, there's always an extra line at the end, its start is
+     * the text length and its top is the layout height.
+     */
+    private final IntArrayList mLines = new IntArrayList();
+
+    // the text length when the last reflow finished
+    private int mLength;
+
+    // temp objects, reused between reflows
+    private final IntArrayList mTmpLines = new IntArrayList();
+    private final FontMetricsInt mTmpFm = new FontMetricsInt();
+    private final LineBreaker.ParagraphConstraints mConstraints = new LineBreaker.ParagraphConstraints();
+    private MeasuredParagraph mMeasured;
+
+    /**
+     * Make a layout for the specified text that will be updated as the text is changed.
+     *
+     * @param text    the text to be laid out, optionally with spans
+     * @param paint   the base paint used for layout
+     * @param width   the width in pixels
+     * @param textDir text direction heuristic for resolving bidi behavior
+     */
+    public DynamicLayout(@Nonnull CharSequence text, @Nonnull TextPaint paint, int width,
+                         @Nonnull TextDirectionHeuristic textDir) {
+        this(text, paint, width, textDir, true);
+    }
+
+    public DynamicLayout(@Nonnull CharSequence text, @Nonnull TextPaint paint, int width,
+                         @Nonnull TextDirectionHeuristic textDir, boolean useLineSpacingFromFallbacks) {
         super(text);
+        mPaint = paint;
+        mWidth = width;
+        mTextDir = textDir;
+        mFallbackLineSpacing = useLineSpacingFromFallbacks;
+
+        mLines.add(0);
+        mLines.add(0);
+        mLines.add(0);
+        mLines.add(0);
+
+        if (text instanceof Spannable) {
+            ((Spannable) text).setSpan(new ChangeWatcher(this), 0, text.length(), 0);
+        }
+        reflow(0, 0, text.length());
+    }
+
+    /**
+     * Update the layout when the chars in the range {@code where ... where + before}
+     * were replaced by {@code after} chars. Only paragraphs intersecting the range are
+     * laid out again.
+     *
+     * @param where  the start of the changed range
+     * @param before the length of the range before the change
+     * @param after  the length of the range after the change
+     */
+    public void reflow(int where, int before, int after) {
+        final CharSequence text = getText();
+        final int len = text.length();
+
+        // expand to paragraph boundaries, they are the same before and after the change
+        int find = TextUtils.lastIndexOf(text, '\n', where - 1);
+        find = find < 0 ? 0 : find + 1;
+        int diff = where - find;
+        before += diff;
+        after += diff;
+        where -= diff;
+
+        int look = TextUtils.indexOf(text, '\n', where + after);
+        look = look < 0 ? len : look + 1;
+        int change = look - (where + after);
+        before += change;
+        after += change;
+
+        final IntArrayList lines = mLines;
+        final int lineCount = getLineCount();
+
+        // the old lines to replace, the empty last line belongs to the last paragraph
+        final int startLine = getLineForOffset(where);
+        final int endLine = where + before >= mLength ? lineCount : getLineForOffset(where + before);
+
+        final int oldTop = lines.getInt(startLine * COLUMNS + TOP);
+        final int oldBottom = lines.getInt(endLine * COLUMNS + TOP);
+
+        final IntArrayList newLines = mTmpLines;
+        final int newBottom = generate(text, where, where + after, oldTop, newLines);
+
+        // shift the rest lines, including the extra line
+        final int dx = after - before;
+        final int dy = newBottom - oldBottom;
+        if (dx != 0 || dy != 0) {
+            for (int i = endLine, e = lineCount; i <= e; i++) {
+                int off = i * COLUMNS;
+                lines.set(off + START, lines.getInt(off + START) + dx);
+                lines.set(off + TOP, lines.getInt(off + TOP) + dy);
+            }
+        }
+
+        lines.removeElements(startLine * COLUMNS, endLine * COLUMNS);
+        lines.addElements(startLine * COLUMNS, newLines.elements(), 0, newLines.size());
+        newLines.clear();
+        mLength = len;
+        if (mMeasured != null) {
+            mMeasured.release();
+        }
+    }
+
+    /**
+     * Lay out the paragraphs in the range and append lines.
+     *
+     * @return the bottom of the last line
+     */
+    private int generate(@Nonnull CharSequence text, int start, int end, int top, @Nonnull IntArrayList out) {
+        final TextPaint paint = mPaint;
+        final FontMetricsInt fm = mTmpFm;
+        final LineBreaker.ParagraphConstraints constraints = mConstraints;
+        constraints.setWidth(mWidth);
+        constraints.setIndent(mWidth);
+        constraints.setTabStops(null, 20);
+
+        for (int paraStart = start, paraEnd; paraStart < end; paraStart = paraEnd) {
+            paraEnd = TextUtils.indexOf(text, '\n', paraStart, end);
+            paraEnd = paraEnd < 0 ? end : paraEnd + 1;
+
+            final MeasuredParagraph measured = MeasuredParagraph.buildForStaticLayout(
+                    paint, text, paraStart, paraEnd, mTextDir, mMeasured);
+            mMeasured = measured;
+
+            final LineBreaker.Result res = LineBreaker.computeLineBreaks(
+                    measured.getMeasuredText(), constraints, null, 0);
+            final int[] spanEnds = measured.getSpanEndCache().elements();
+            final int[] fmCache = measured.getFontMetrics().elements();
+            final int spanCount = measured.getSpanEndCache().size();
+
+            int lineStart = paraStart;
+            for (int i = 0, spanIndex = 0, e = res.getLineCount(); i < e; i++) {
+                final int lineEnd = paraStart + res.getLineBreakOffset(i);
+
+                // the max metrics of spans intersecting the line
+                int ascent = 0, descent = 0;
+                for (int j = spanIndex; j < spanCount; j++) {
+                    ascent = Math.max(ascent, fmCache[j * 2]);
+                    descent = Math.max(descent, fmCache[j * 2 + 1]);
+                    if (spanEnds[j] >= lineEnd) {
+                        break;
+                    }
+                }
+                while (spanIndex < spanCount - 1 && spanEnds[spanIndex] <= lineEnd) {
+                    spanIndex++;
+                }
+                if (mFallbackLineSpacing) {
+                    ascent = Math.max(ascent, Math.round(res.getLineAscent(i)));
+                    descent = Math.max(descent, Math.round(res.getLineDescent(i)));
+                }
+
+                out.add(lineStart);
+                out.add(top);
+                out.add(descent);
+                out.add(Float.floatToRawIntBits(res.getLineWidth(i)));
+                top += ascent + descent;
+                lineStart = lineEnd;
+            }
+        }
+
+        // the empty last paragraph
+        final int len = text.length();
+        if (end == len && (len == 0 || text.charAt(len - 1) == '\n')) {
+            fm.reset();
+            paint.getFontMetrics(fm);
+            out.add(len);
+            out.add(top);
+            out.add(fm.mDescent);
+            out.add(Float.floatToRawIntBits(0));
+            top += fm.mAscent + fm.mDescent;
+        }
+        return top;
+    }
+
+    /**
+     * Set the width, all paragraphs will be laid out again if changed.
+     *
+     * @param width the width in pixels
+     */
+    public void setWidth(int width) {
+        if (mWidth != width) {
+            mWidth = width;
+            reflow(0, mLength, getText().length());
+        }
+    }
+
+    public int getWidth() {
+        return mWidth;
+    }
+
+    public int getLineCount() {
+        return mLines.size() / COLUMNS - 1;
+    }
+
+    /**
+     * Return the text offset of the beginning of the specified line, if the line
+     * is the line count, the text length is returned.
+     */
+    public int getLineStart(int line) {
+        return mLines.getInt(line * COLUMNS + START);
+    }
+
+    /**
+     * Return the text offset after the last character on the specified line.
+     */
+    public int getLineEnd(int line) {
+        return getLineStart(line + 1);
+    }
+
+    /**
+     * Return the vertical position of the top of the specified line, if the line
+     * is the line count, the layout height is returned.
+     */
+    public int getLineTop(int line) {
+        return mLines.getInt(line * COLUMNS + TOP);
+    }
+
+    /**
+     * Return the descent of the specified line.
+     */
+    public int getLineDescent(int line) {
+        return mLines.getInt(line * COLUMNS + DESCENT);
+    }
+
+    /**
+     * Return the vertical position of the baseline of the specified line.
+     */
+    public int getLineBaseline(int line) {
+        return getLineTop(line + 1) - getLineDescent(line);
+    }
+
+    /**
+     * Return the width of the specified line, excluding trailing whitespaces.
+     */
+    public float getLineWidth(int line) {
+        return Float.intBitsToFloat(mLines.getInt(line * COLUMNS + WIDTH));
+    }
+
+    /**
+     * Return the total height of this layout.
+     */
+    public int getHeight() {
+        return getLineTop(getLineCount());
+    }
+
+    /**
+     * Get the line number on which the specified text offset appears.
+     * If you ask for a position before 0, you get 0; if you ask for a position
+     * beyond the end of the text, you get the last line.
+     */
+    public int getLineForOffset(int offset) {
+        int high = getLineCount(), low = -1, guess;
+
+        while (high - low > 1) {
+            guess = (high + low) >>> 1;
+
+            if (getLineStart(guess) > offset)
+                high = guess;
+            else
+                low = guess;
+        }
+
+        return Math.max(low, 0);
+    }
+
+    /**
+     * Get the line number corresponding to the specified vertical position.
+     * If you ask for a position above 0, you get 0; if you ask for a position
+     * below the bottom of the text, you get the last line.
+     */
+    public int getLineForVertical(int vertical) {
+        int high = getLineCount(), low = -1, guess;
+
+        while (high - low > 1) {
+            guess = (high + low) >>> 1;
+
+            if (getLineTop(guess) > vertical)
+                high = guess;
+            else
+                low = guess;
+        }
+
+        return Math.max(low, 0);
+    }
+
+    // weak reference, so the text doesn't keep the layout alive
+    private static final class ChangeWatcher implements SpanWatcher {
+
+        private final WeakReference<DynamicLayout> mLayout;
+
+        ChangeWatcher(DynamicLayout layout) {
+            mLayout = new WeakReference<>(layout);
+        }
+
+        private void reflow(@Nonnull Spannable text, int start, int end) {
+            DynamicLayout layout = mLayout.get();
+            if (layout != null) {
+                layout.reflow(start, end - start, end - start);
+            } else {
+                text.removeSpan(this);
+            }
+        }
+
+        @Override
+        public void onSpanAdded(Spannable text, Object what, int start, int end) {
+            if (what instanceof UpdateLayout) {
+                reflow(text, start, end);
+            }
+        }
+
+        @Override
+        public void onSpanRemoved(Spannable text, Object what, int start, int end) {
+            if (what instanceof UpdateLayout) {
+                reflow(text, start, end);
+            }
+        }
+
+        @Override
+        public void onSpanChanged(Spannable text, Object what, int ost, int oen, int nst, int nen) {
+            if (what instanceof UpdateLayout) {
+                reflow(text, ost, oen);
+                reflow(text, nst, nen);
+            }
+        }
     }
 }
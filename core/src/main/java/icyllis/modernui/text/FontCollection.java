@@ -22,6 +22,8 @@ import com.ibm.icu.impl.UCharacterProperty;
 import com.ibm.icu.lang.UCharacter;
 import com.ibm.icu.lang.UCharacterCategory;
 import icyllis.modernui.ModernUI;
+import it.unimi.dsi.fastutil.ints.Int2ShortMap;
+import it.unimi.dsi.fastutil.ints.Int2ShortOpenHashMap;
 import org.apache.logging.log4j.Marker;
 import org.apache.logging.log4j.MarkerManager;
 
@@ -218,6 +220,13 @@ public class FontCollection {
     @Nonnull
     private final Font[] mFonts;
 
+    // the font index cache for code points, 0 is unknown, others are (index + 1)
+    // of mFonts followed by all font families, see getFamilyForChar()
+    // BMP pages of 256 code points are allocated lazily, races are benign
+    private final short[][] mBmpFontIndex = new short[256][];
+    // supplementary planes, guarded by itself
+    private final Int2ShortMap mSuppFontIndex = new Int2ShortOpenHashMap();
+
     private FontCollection(@Nonnull Font[] fonts) {
         if (fonts.length == 0) {
             throw new IllegalArgumentException("Font set cannot be empty");
@@ -225,13 +234,33 @@ public class FontCollection {
         mFonts = fonts;
     }
 
-    // calculate font runs
+    /**
+     * Calculate font runs, this allocates a new list and runs.
+     *
+     * @see #itemize(char[], int, int, RunBuffer)
+     */
+    @Nonnull
     public List<Run> itemize(@Nonnull final char[] text, final int offset, final int limit) {
+        final RunBuffer result = new RunBuffer();
+        itemize(text, offset, limit, result);
+        return result.toList();
+    }
+
+    /**
+     * Calculate font runs into a reusable buffer, the buffer is cleared first.
+     * Run objects in the buffer are recycled, they are valid until the next call.
+     *
+     * @param text   the text buffer
+     * @param offset the start index
+     * @param limit  the end index
+     * @param result the buffer to receive runs
+     */
+    public void itemize(@Nonnull final char[] text, final int offset, final int limit,
+                        @Nonnull final RunBuffer result) {
         it.unimi.dsi.fastutil.Arrays.ensureFromTo(text.length, offset, limit);
+        result.clear();
         if (offset == limit)
-            return Collections.emptyList();
-
-        final List<Run> result = new ArrayList<>();
+            return;
 
         Run lastRun = null;
         Font lastFamily = null;
@@ -283,16 +312,20 @@ public class FontCollection {
             } else running = false;
 
             boolean shouldContinueRun = false;
+            Font family = null;
             if (doesNotNeedFontSupport(ch)) {
                 // Always continue if the character is a format character not needed to be in the font.
                 shouldContinueRun = true;
             } else if (lastFamily != null && (isStickyWhitelisted(ch) || isCombining(ch))) {
                 // Continue using existing font as long as it has coverage and is whitelisted.
-                shouldContinueRun = lastFamily.canDisplay(ch);
+                family = getFamilyForChar(ch);
+                shouldContinueRun = family == lastFamily || lastFamily.canDisplay(ch);
             }
 
             if (!shouldContinueRun) {
-                Font family = getFamilyForChar(ch);
+                if (family == null) {
+                    family = getFamilyForChar(ch);
+                }
                 if (pos == 0 || family != lastFamily) {
                     int start = pos;
                     // Workaround for combining marks and emoji modifiers until we implement
@@ -306,7 +339,8 @@ public class FontCollection {
                         if (lastRun != null) {
                             lastRun.mEnd -= prevLength;
                             if (lastRun.mStart == lastRun.mEnd) {
-                                result.remove(lastRun);
+                                // the last run is always the last one in the buffer
+                                result.removeLast();
                             }
                         }
                         start -= prevLength;
@@ -318,9 +352,7 @@ public class FontCollection {
                         // start to be 0 to include those characters).
                         start = offset;
                     }
-                    Run run = new Run(family, start, 0);
-                    result.add(run);
-                    lastRun = run;
+                    lastRun = result.add(family, start, 0);
                     lastFamily = family;
                 }
             }
@@ -334,9 +366,8 @@ public class FontCollection {
         if (lastFamily == null) {
             // No character needed any font support, so it doesn't really matter which font they end up
             // getting displayed in. We put the whole string in one run, using the first font.
-            result.add(new Run(mFonts[0], offset, limit));
+            result.add(mFonts[0], offset, limit);
         }
-        return result;
     }
 
     // raw array
@@ -345,15 +376,44 @@ public class FontCollection {
         return mFonts;
     }
 
-    // no scores
+    // no scores, the result is cached, so canDisplay() is probed once per code point
     private Font getFamilyForChar(int ch) {
-        for (Font font : mFonts)
-            if (font.canDisplay(ch))
-                return font;
-        for (Font font : FontCollection.sAllFontFamilies)
-            if (font.canDisplay(ch))
-                return font;
-        return mFonts[0];
+        int index;
+        if (ch < 0x10000) {
+            short[] page = mBmpFontIndex[ch >> 8];
+            if (page == null) {
+                mBmpFontIndex[ch >> 8] = page = new short[256];
+            }
+            index = page[ch & 0xFF];
+            if (index == 0) {
+                page[ch & 0xFF] = (short) (index = findFamilyForChar(ch) + 1);
+            }
+        } else {
+            synchronized (mSuppFontIndex) {
+                index = mSuppFontIndex.get(ch);
+            }
+            if (index == 0) {
+                index = findFamilyForChar(ch) + 1;
+                synchronized (mSuppFontIndex) {
+                    mSuppFontIndex.put(ch, (short) index);
+                }
+            }
+        }
+        index--;
+        return index < mFonts.length ? mFonts[index] : sAllFontFamilies.get(index - mFonts.length);
+    }
+
+    // the index of mFonts followed by all font families
+    private int findFamilyForChar(int ch) {
+        final Font[] fonts = mFonts;
+        for (int i = 0; i < fonts.length; i++)
+            if (fonts[i].canDisplay(ch))
+                return i;
+        final List<Font> families = FontCollection.sAllFontFamilies;
+        for (int i = 0, e = families.size(); i < e; i++)
+            if (families.get(i).canDisplay(ch))
+                return fonts.length + i;
+        return 0;
     }
 
     @Override
@@ -372,8 +432,8 @@ public class FontCollection {
     // font run, child of style run
     public static class Run {
 
-        private final Font mFont;
-        private final int mStart;
+        private Font mFont;
+        private int mStart;
         private int mEnd;
 
         public Run(Font font, int start, int end) {
@@ -397,4 +457,55 @@ public class FontCollection {
             return mEnd;
         }
     }
+
+    /**
+     * A reusable list of font runs, run objects are recycled between itemizations.
+     */
+    public static class RunBuffer {
+
+        private final ArrayList<Run> mRuns = new ArrayList<>();
+        private int mSize;
+
+        public RunBuffer() {
+        }
+
+        public int size() {
+            return mSize;
+        }
+
+        @Nonnull
+        public Run get(int index) {
+            Objects.checkIndex(index, mSize);
+            return mRuns.get(index);
+        }
+
+        public void clear() {
+            mSize = 0;
+        }
+
+        @Nonnull
+        private Run add(Font font, int start, int end) {
+            final Run run;
+            if (mSize < mRuns.size()) {
+                run = mRuns.get(mSize);
+                run.mFont = font;
+                run.mStart = start;
+                run.mEnd = end;
+            } else {
+                mRuns.add(run = new Run(font, start, end));
+            }
+            mSize++;
+            return run;
+        }
+
+        private void removeLast() {
+            mSize--;
+        }
+
+        // a copy of the current runs, the buffer should not be used any more
+        @Nonnull
+        private List<Run> toList() {
+            return mSize == 0 ? Collections.emptyList() : new ArrayList<>(mRuns.subList(0, mSize));
+        }
+    }
 }
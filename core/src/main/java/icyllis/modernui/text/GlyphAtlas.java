@@ -18,29 +18,35 @@
 
 package icyllis.modernui.text;
 
+import icyllis.modernui.ModernUI;
 import icyllis.modernui.annotation.RenderThread;
-import icyllis.modernui.graphics.texture.Texture2D;
+import icyllis.modernui.graphics.font.GlyphPage;
+import icyllis.modernui.math.Rect;
 import icyllis.modernui.platform.Bitmap;
+import icyllis.modernui.platform.RenderCore;
 import it.unimi.dsi.fastutil.ints.Int2ObjectMap;
 import it.unimi.dsi.fastutil.ints.Int2ObjectMaps;
 import it.unimi.dsi.fastutil.ints.Int2ObjectOpenHashMap;
 
 import javax.annotation.Nonnull;
+import javax.annotation.Nullable;
 import javax.annotation.concurrent.ThreadSafe;
 import java.io.IOException;
-import java.util.function.IntFunction;
+import java.util.ArrayList;
+import java.util.List;
 
 import static icyllis.modernui.graphics.GLWrapper.GL_ALPHA;
 import static icyllis.modernui.graphics.GLWrapper.GL_UNSIGNED_BYTE;
 
 /**
  * Maintains a font texture atlas, which is specified with a font family, size and style.
- * The glyphs in the texture are tightly packed, dynamically generated with mipmaps. Each
- * glyph is represented as a TexturedGlyph.
+ * The glyphs are packed into fixed-size pages with a skyline packer, each glyph is
+ * represented as a GlyphInfo.
  * <p>
- * The initial texture size is 256*256, and each enlargement double the height and width
- * alternately. The max texture size would be 16384*16384 and the image is 8-bit grayscale.
- * The OpenGL texture id may change due to enlarging the texture size.
+ * Pages are never resized. When all pages are full, a new page is allocated until
+ * {@link #MAX_PAGES}, then the least recently used page is evicted. Glyphs of an evicted
+ * page return to the created state in place and will be uploaded again when queried, so
+ * holders of a GlyphInfo see the change without any other invalidation.
  */
 @ThreadSafe
 public class GlyphAtlas {
@@ -51,82 +57,137 @@ public class GlyphAtlas {
      */
     private static final int GLYPH_BORDER = 1;
 
-    private static final int INITIAL_SIZE = 256;
+    /**
+     * The width and height of a page, the image is 8-bit grayscale.
+     */
+    public static final int PAGE_SIZE = 1024;
+
+    /**
+     * The max number of pages before evicting, this is a soft limit.
+     */
+    public static final int MAX_PAGES = 4;
 
     private static final int MIPMAP_LEVEL = 4;
 
+    // a page used within this time is never evicted, it may be drawing
+    private static final long EVICTION_AGE_MILLIS = 1000;
+
     // OpenHashMap uses less memory than RBTree/AVLTree, but higher than ArrayMap
     private final Int2ObjectMap<GlyphInfo> mGlyphs =
             Int2ObjectMaps.synchronize(new Int2ObjectOpenHashMap<>());
 
-    // texture object is immutable, but texture ID (the int) can change by resizing
-    private final Texture2D mTexture = new Texture2D();
-
-    private final IntFunction<GlyphInfo> mFactory = i -> new GlyphInfo(mTexture);
-
-    private int mPosX = GLYPH_BORDER;
-    private int mPosY = GLYPH_BORDER;
-
-    private int mLineHeight;
-
-    private int mWidth;
-    private int mHeight;
+    // render thread only
+    private final List<GlyphPage> mPages = new ArrayList<>();
+    private final Rect mTmpRect = new Rect();
 
     public GlyphAtlas() {
     }
 
     @Nonnull
     public GlyphInfo getGlyph(int glyphCode) {
-        return mGlyphs.computeIfAbsent(glyphCode, mFactory);
+        GlyphInfo glyph = mGlyphs.computeIfAbsent(glyphCode, i -> new GlyphInfo());
+        GlyphPage page = glyph.page;
+        if (page != null) {
+            page.markUsed(RenderCore.timeMillis());
+        }
+        return glyph;
     }
 
     public void export() {
         try {
-            Bitmap.download(Bitmap.Format.RGBA, mTexture)
-                    .saveDialog(Bitmap.SaveFormat.PNG, 0);
+            for (GlyphPage page : mPages) {
+                Bitmap.download(Bitmap.Format.RGBA, page.getTexture())
+                        .saveDialog(Bitmap.SaveFormat.PNG, 0);
+            }
         } catch (IOException e) {
             e.printStackTrace();
         }
     }
 
+    /**
+     * Allocates a region for the glyph image and uploads it. The glyph becomes ready after this,
+     * metrics other than the size should be assigned before calling this method.
+     *
+     * @param glyph  the glyph to stitch
+     * @param width  the width of the glyph image
+     * @param height the height of the glyph image
+     * @param pixels a pointer to alpha data, or an offset into the bound pixel unpack buffer
+     */
     @RenderThread
-    public void stitch(GlyphInfo glyph, long data) {
-        if (mWidth == 0) {
-            enlarge();
+    public void stitch(@Nonnull GlyphInfo glyph, int width, int height, long pixels) {
+        if (width == 0 || height == 0) {
+            // nothing to draw, e.g. white spaces
+            glyph.height = 0;
+            glyph.width = 0;
+            return;
+        }
+        final Rect r = mTmpRect;
+        final GlyphPage page = allocate(width + GLYPH_BORDER * 2, height + GLYPH_BORDER * 2, r);
+        if (page == null) {
+            ModernUI.LOGGER.warn(GlyphManager.MARKER, "Glyph is too large to fit in a page: {}x{}",
+                    width, height);
+            glyph.height = 0;
+            glyph.width = 0;
+            return;
         }
-        if (mPosX + glyph.width + GLYPH_BORDER >= mWidth) {
-            mPosX = GLYPH_BORDER;
-            if (mWidth == mHeight && mWidth != INITIAL_SIZE) {
-                mPosX += mWidth >> 1;
+        final int x = r.left + GLYPH_BORDER;
+        final int y = r.top + GLYPH_BORDER;
+        page.getTexture().upload(0, x, y, width, height, width,
+                0, 0, 1, GL_ALPHA, GL_UNSIGNED_BYTE, pixels);
+
+        final float size = page.getSize();
+        glyph.u1 = x / size;
+        glyph.v1 = y / size;
+        glyph.u2 = (x + width) / size;
+        glyph.v2 = (y + height) / size;
+        glyph.texture = page.getTexture();
+        glyph.page = page;
+        glyph.height = height;
+        // width is the state marker, assign it last
+        glyph.width = width;
+        page.markUsed(RenderCore.timeMillis());
+    }
+
+    @Nullable
+    private GlyphPage allocate(int width, int height, @Nonnull Rect out) {
+        for (GlyphPage page : mPages) {
+            if (page.allocate(width, height, out)) {
+                return page;
             }
-            mPosY += mLineHeight + GLYPH_BORDER << 1;
-            mLineHeight = 0;
         }
-        if (mPosY + glyph.height + GLYPH_BORDER >= mHeight) {
-            if (mWidth != mHeight) {
-                mPosX = GLYPH_BORDER + mWidth;
-                mPosY = GLYPH_BORDER;
+        GlyphPage page = null;
+        if (mPages.size() >= MAX_PAGES) {
+            GlyphPage lru = null;
+            for (GlyphPage p : mPages) {
+                if (lru == null || p.getLastUsed() < lru.getLastUsed()) {
+                    lru = p;
+                }
+            }
+            if (RenderCore.timeMillis() - lru.getLastUsed() >= EVICTION_AGE_MILLIS) {
+                evict(lru);
+                page = lru;
             }
-            enlarge();
         }
-
-        mTexture.upload(0, mPosX, mPosY, glyph.width, glyph.height, glyph.width,
-                0, 0, 1, GL_ALPHA, GL_UNSIGNED_BYTE, data);
-
-        mPosX += glyph.width + GLYPH_BORDER << 1;
-        mLineHeight = Math.max(mLineHeight, glyph.height);
+        if (page == null) {
+            page = new GlyphPage(PAGE_SIZE, MIPMAP_LEVEL);
+            mPages.add(page);
+        }
+        return page.allocate(width, height, out) ? page : null;
     }
 
-    private void enlarge() {
-        if (mWidth == 0) {
-            mWidth = mHeight = INITIAL_SIZE;
-            mTexture.initCompat(GL_ALPHA, INITIAL_SIZE, INITIAL_SIZE, MIPMAP_LEVEL);
-            return;
-        } else if (mHeight != mWidth) {
-            mWidth <<= 1;
-        } else {
-            mHeight <<= 1;
+    private void evict(@Nonnull GlyphPage page) {
+        int count = 0;
+        synchronized (mGlyphs) {
+            for (GlyphInfo glyph : mGlyphs.values()) {
+                if (glyph.page == page) {
+                    glyph.page = null;
+                    glyph.texture = null;
+                    glyph.width = GlyphInfo.CREATED;
+                    count++;
+                }
+            }
         }
-        mTexture.resize(mWidth, mHeight, true);
+        page.evict();
+        ModernUI.LOGGER.debug(GlyphManager.MARKER, "Evicted a glyph page with {} glyphs", count);
     }
 }
@@ -18,6 +18,7 @@
 
 package icyllis.modernui.text;
 
+import icyllis.modernui.graphics.font.GlyphPage;
 import icyllis.modernui.graphics.texture.Texture2D;
 
 /**
@@ -36,9 +37,11 @@ public class GlyphInfo {
     static final int UPLOADING = -2;
 
     /**
-     * The texture that contains this glyph image.
+     * The atlas page and its texture that contains this glyph image, null before
+     * the glyph is uploaded or after the page is evicted.
      */
-    final Texture2D texture;
+    GlyphPage page;
+    Texture2D texture;
 
     /**
      * The horizontal advance in pixels of this glyph.
@@ -56,9 +59,10 @@ public class GlyphInfo {
     int offsetY;
 
     /**
-     * The total width of this glyph image in pixels.
+     * The total width of this glyph image in pixels, or a state marker
+     * before the glyph is ready.
      */
-    int width;
+    volatile int width;
 
     /**
      * The total height of this glyph image in pixels.
@@ -85,9 +89,19 @@ public class GlyphInfo {
      */
     float v2;
 
-    public GlyphInfo(Texture2D texture) {
-        this.texture = texture;
+    public GlyphInfo() {
         // use the width as the marker before it's assigned
         width = CREATED;
     }
+
+    /**
+     * Returns whether the glyph image has been rasterized and uploaded. Until then,
+     * the glyph should be rendered as a placeholder, that is, nothing but the advance.
+     * A ready glyph may have no texture if its image is empty.
+     *
+     * @return true if the glyph is ready to draw
+     */
+    public boolean isReady() {
+        return width >= 0;
+    }
 }
@@ -18,21 +18,45 @@
 
 package icyllis.modernui.text;
 
+import icyllis.modernui.ModernUI;
 import icyllis.modernui.annotation.RenderThread;
+import icyllis.modernui.graphics.font.GlyphManagerBase;
+import icyllis.modernui.platform.FrameProfiler;
 import icyllis.modernui.platform.RenderCore;
-import org.lwjgl.BufferUtils;
+import org.apache.logging.log4j.Marker;
+import org.apache.logging.log4j.MarkerManager;
 import org.lwjgl.system.MemoryUtil;
 
 import javax.annotation.Nonnull;
 import java.awt.*;
+import java.awt.font.FontRenderContext;
 import java.awt.font.GlyphVector;
 import java.awt.image.BufferedImage;
 import java.nio.ByteBuffer;
+import java.util.ArrayList;
 import java.util.HashMap;
+import java.util.List;
 import java.util.Map;
-
+import java.util.Queue;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import static icyllis.modernui.graphics.GLWrapper.*;
+
+/**
+ * Rasterizes glyphs and stitches them into glyph atlases. Glyph images are rasterized
+ * by a worker pool, each worker has its own image and Graphics2D. Finished images are
+ * queued and uploaded on the render thread in batches, through a pixel unpack buffer
+ * with a single transfer per batch. Until a glyph is uploaded, it should be rendered
+ * as a placeholder, see {@link GlyphInfo#isReady()}.
+ */
 public class GlyphManager {
 
+    public static final Marker MARKER = MarkerManager.getMarker("GlyphManager");
+
     /**
      * Transparent (alpha zero) black background color for use with BufferedImage.clearRect().
      */
@@ -44,24 +68,30 @@ public class GlyphManager {
     private static volatile GlyphManager sInstance;
 
     /**
-     * Draw a single glyph onto this image and then loaded from here into an OpenGL texture.
+     * The font render context used for layout and rasterization, matching the rendering hints.
+     */
+    private final FontRenderContext mFontRenderContext = new FontRenderContext(null,
+            RenderingHints.VALUE_TEXT_ANTIALIAS_ON, RenderingHints.VALUE_FRACTIONALMETRICS_ON);
+
+    /**
+     * Rasterizes glyph images, AWT rendering is slow so it's not on the render thread.
      */
-    private BufferedImage mImage;
+    private final ExecutorService mWorkerPool;
 
     /**
-     * The Graphics2D associated with glyph image and used for bit blit.
+     * Each worker draws glyphs onto its own image.
      */
-    private Graphics2D mGraphics;
+    private final ThreadLocal<Rasterizer> mRasterizer = ThreadLocal.withInitial(Rasterizer::new);
 
     /**
-     * Intermediate data array for use with image.
+     * Rasterized glyphs waiting for uploading, from any worker.
      */
-    private int[] mImageData;
+    private final Queue<RasterGlyph> mPendingGlyphs = new ConcurrentLinkedQueue<>();
 
     /**
-     * A direct buffer used for loading the pre-rendered glyph images into OpenGL textures.
+     * Whether a flush is recorded and not yet run.
      */
-    private ByteBuffer mImageBuffer;
+    private final AtomicBoolean mFlushScheduled = new AtomicBoolean();
 
     /**
      * All font atlases, with specified font family, size and style.
@@ -73,7 +103,18 @@ public class GlyphManager {
      */
     private final Object mQueryLock = new Object();
 
+    // render thread only
+    private final List<RasterGlyph> mUploadGlyphs = new ArrayList<>();
+    private int mStagingBuffer = INVALID_ID;
+
     private GlyphManager() {
+        final int threads = Math.max(1, Math.min(4, Runtime.getRuntime().availableProcessors() >> 1));
+        final AtomicInteger index = new AtomicInteger();
+        mWorkerPool = Executors.newFixedThreadPool(threads, target -> {
+            Thread thread = new Thread(target, "mui-glyph-worker-" + index.getAndIncrement());
+            thread.setDaemon(true);
+            return thread;
+        });
         // init
         reload();
     }
@@ -94,8 +135,9 @@ public class GlyphManager {
      * Reload the glyph manager, clear all created textures.
      */
     public void reload() {
-        mAtlases = new HashMap<>();
-        allocateImage(64, 64);
+        synchronized (mQueryLock) {
+            mAtlases = new HashMap<>();
+        }
     }
 
     /**
@@ -110,7 +152,7 @@ public class GlyphManager {
      */
     @Nonnull
     public GlyphVector layoutGlyphVector(@Nonnull Font font, char[] text, int start, int limit, boolean isRtl) {
-        return font.layoutGlyphVector(mGraphics.getFontRenderContext(), text, start, limit,
+        return font.layoutGlyphVector(mFontRenderContext, text, start, limit,
                 isRtl ? Font.LAYOUT_RIGHT_TO_LEFT : Font.LAYOUT_LEFT_TO_RIGHT);
     }
 
@@ -118,6 +160,9 @@ public class GlyphManager {
      * Given a derived font and a glyph code within that font, locate the glyph's pre-rendered image
      * in the glyph atlas and return its cache entry,. The entry stores the texture with the
      * pre-rendered glyph image, as well as the position and size of that image within the texture.
+     * <p>
+     * If the glyph is not cached, it will be rasterized asynchronously and the returned entry is
+     * not ready until it's uploaded in a later frame, see {@link GlyphInfo#isReady()}.
      *
      * @param font      the font (with size and style) to which this glyphCode belongs and which
      *                  was used to pre-render the glyph,
@@ -132,9 +177,13 @@ public class GlyphManager {
         }
         GlyphInfo glyph = atlas.getGlyph(glyphCode);
         if (glyph.width == GlyphInfo.CREATED) {
-            RenderCore.recordRenderCall(
-                    () -> cacheGlyph(font, glyphCode, atlas, glyph));
-            glyph.width = GlyphInfo.UPLOADING;
+            synchronized (glyph) {
+                if (glyph.width == GlyphInfo.CREATED) {
+                    glyph.width = GlyphInfo.UPLOADING;
+                    FrameProfiler.count(FrameProfiler.GLYPH_MISSES, 1);
+                    mWorkerPool.execute(() -> rasterize(font, glyphCode, atlas, glyph));
+                }
+            }
         }
         return glyph;
     }
@@ -143,60 +192,187 @@ public class GlyphManager {
         mAtlases.values().forEach(GlyphAtlas::export);
     }
 
+    // worker thread
+    private void rasterize(@Nonnull Font font, int glyphCode, @Nonnull GlyphAtlas atlas, @Nonnull GlyphInfo glyph) {
+        RasterGlyph result;
+        try {
+            result = mRasterizer.get().rasterize(font, glyphCode);
+        } catch (Throwable t) {
+            ModernUI.LOGGER.error(MARKER, "Failed to rasterize glyph {} of {}", glyphCode, font, t);
+            result = new RasterGlyph(0, 0, 0, 0, 0, MemoryUtil.NULL);
+        }
+        result.atlas = atlas;
+        result.glyph = glyph;
+        mPendingGlyphs.offer(result);
+        // one render call for all glyphs finished before the next flush
+        if (mFlushScheduled.compareAndSet(false, true)) {
+            RenderCore.recordRenderCall(this::flushGlyphs);
+        }
+    }
+
+    /**
+     * Uploads all rasterized glyphs. Their images are copied into a pixel unpack buffer
+     * with one transfer, then each atlas page is updated from that buffer.
+     */
     @RenderThread
-    private void cacheGlyph(@Nonnull Font font, int glyphCode, @Nonnull GlyphAtlas atlas, @Nonnull GlyphInfo glyph) {
-        // there's no need to layout glyph vector, we only draw the specific glyphCode
-        // which is already laid-out in LayoutEngine
-        GlyphVector vector = font.createGlyphVector(mGraphics.getFontRenderContext(), new int[]{glyphCode});
+    private void flushGlyphs() {
+        final long start = FrameProfiler.begin();
+        try {
+            uploadGlyphs();
+        } finally {
+            FrameProfiler.end(FrameProfiler.RENDER_GLYPHS, start);
+        }
+    }
 
-        Rectangle bounds = vector.getGlyphPixelBounds(0, null, 0, 0);
-        glyph.advance = vector.getGlyphMetrics(0).getAdvanceX();
-        glyph.offsetX = bounds.x;
-        glyph.offsetY = bounds.y;
-        glyph.width = bounds.width;
-        glyph.height = bounds.height;
+    private void uploadGlyphs() {
+        // reset first, glyphs finished after this point will schedule another flush
+        mFlushScheduled.set(false);
+        final List<RasterGlyph> glyphs = mUploadGlyphs;
+        long size = 0;
+        RasterGlyph r;
+        while ((r = mPendingGlyphs.poll()) != null) {
+            glyphs.add(r);
+            size += r.width * r.height;
+        }
+        if (glyphs.isEmpty()) {
+            return;
+        }
+        if (size > 0) {
+            if (mStagingBuffer == INVALID_ID) {
+                mStagingBuffer = glCreateBuffers();
+            }
+            final int buffer = mStagingBuffer;
+            // orphan the previous storage, so we never wait for the previous transfer
+            glNamedBufferData(buffer, size, GL_STREAM_DRAW);
+            ByteBuffer mapped = glMapNamedBufferRange(buffer, 0, size,
+                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (mapped == null) {
+                throw new IllegalStateException("Failed to map glyph staging buffer");
+            }
+            final long address = MemoryUtil.memAddress(mapped);
+            long pos = 0;
+            for (RasterGlyph glyph : glyphs) {
+                if (glyph.pixels != MemoryUtil.NULL) {
+                    final int bytes = glyph.width * glyph.height;
+                    MemoryUtil.memCopy(glyph.pixels, address + pos, bytes);
+                    MemoryUtil.nmemFree(glyph.pixels);
+                    pos += bytes;
+                }
+            }
+            glUnmapNamedBuffer(buffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        }
+        long offset = 0;
+        for (RasterGlyph glyph : glyphs) {
+            GlyphInfo info = glyph.glyph;
+            info.advance = glyph.advance;
+            info.offsetX = glyph.offsetX;
+            info.offsetY = glyph.offsetY;
+            // the pointer is used as an offset when the unpack buffer is bound
+            glyph.atlas.stitch(info, glyph.width, glyph.height, offset);
+            offset += glyph.width * glyph.height;
+        }
+        if (size > 0) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glyphs.clear();
+    }
 
-        if (bounds.width > mImage.getWidth() || bounds.height > mImage.getHeight()) {
-            allocateImage(mImage.getWidth() << 1, mImage.getHeight() << 1);
+    /**
+     * The rasterized image and metrics of a glyph.
+     */
+    private static final class RasterGlyph {
+
+        private final float advance;
+        private final int offsetX;
+        private final int offsetY;
+        private final int width;
+        private final int height;
+        // native memory, freed after uploading
+        private final long pixels;
+
+        private GlyphAtlas atlas;
+        private GlyphInfo glyph;
+
+        private RasterGlyph(float advance, int offsetX, int offsetY, int width, int height, long pixels) {
+            this.advance = advance;
+            this.offsetX = offsetX;
+            this.offsetY = offsetY;
+            this.width = width;
+            this.height = height;
+            this.pixels = pixels;
         }
+    }
 
-        // give it an offset to draw at origin
-        mGraphics.drawGlyphVector(vector, -bounds.x, -bounds.y);
+    /**
+     * Per-thread rasterization context.
+     */
+    private static final class Rasterizer {
+
+        /**
+         * Draw a single glyph onto this image and then loaded from here into an OpenGL texture.
+         */
+        private BufferedImage mImage;
 
-        // copy raw pixel data from BufferedImage to imageData array with one integer per pixel in 0xAARRGGBB form
-        mImage.getRGB(0, 0, bounds.width, bounds.height, mImageData, 0, bounds.width);
+        /**
+         * The Graphics2D associated with glyph image and used for bit blit.
+         */
+        private Graphics2D mGraphics;
 
-        final int size = bounds.width * bounds.height;
-        for (int i = 0; i < size; i++) {
-            // alpha channel for grayscale texture
-            mImageBuffer.put((byte) (mImageData[i] >>> 24));
+        private Rasterizer() {
+            allocateImage(64, 64);
         }
-        mImageBuffer.flip();
 
-        atlas.stitch(glyph, MemoryUtil.memAddress(mImageBuffer));
+        @Nonnull
+        private RasterGlyph rasterize(@Nonnull Font font, int glyphCode) {
+            // there's no need to layout glyph vector, we only draw the specific glyphCode
+            // which is already laid-out in LayoutEngine
+            GlyphVector vector = font.createGlyphVector(mGraphics.getFontRenderContext(), new int[]{glyphCode});
+
+            Rectangle bounds = vector.getGlyphPixelBounds(0, null, 0, 0);
+            final float advance = vector.getGlyphMetrics(0).getAdvanceX();
+            final int width = bounds.width;
+            final int height = bounds.height;
+            if (width == 0 || height == 0) {
+                return new RasterGlyph(advance, bounds.x, bounds.y, 0, 0, MemoryUtil.NULL);
+            }
 
-        mGraphics.clearRect(0, 0, mImage.getWidth(), mImage.getHeight());
-        mImageBuffer.clear();
-    }
+            if (width > mImage.getWidth() || height > mImage.getHeight()) {
+                int newWidth = mImage.getWidth();
+                int newHeight = mImage.getHeight();
+                while (width > newWidth || height > newHeight) {
+                    newWidth <<= 1;
+                    newHeight <<= 1;
+                }
+                allocateImage(newWidth, newHeight);
+            }
 
-    private void allocateImage(int width, int height) {
-        mImage = new BufferedImage(width, height, BufferedImage.TYPE_INT_ARGB);
-        mGraphics = mImage.createGraphics();
+            mGraphics.clearRect(0, 0, width, height);
+            // give it an offset to draw at origin
+            mGraphics.drawGlyphVector(vector, -bounds.x, -bounds.y);
 
-        mImageData = new int[width * height];
-        mImageBuffer = BufferUtils.createByteBuffer(width * height);
+            // alpha channel for grayscale texture, read from the raster directly
+            final long pixels = MemoryUtil.nmemAllocChecked(width * height);
+            GlyphManagerBase.extractAlpha(mImage, 0, 0, width, height, pixels);
+            return new RasterGlyph(advance, bounds.x, bounds.y, width, height, pixels);
+        }
 
-        // set background color for use with clearRect()
-        mGraphics.setBackground(BG_COLOR);
+        private void allocateImage(int width, int height) {
+            mImage = new BufferedImage(width, height, BufferedImage.TYPE_INT_ARGB);
+            mGraphics = mImage.createGraphics();
 
-        // drawImage() to this buffer will copy all source pixels instead of alpha blending them into the current image
-        mGraphics.setComposite(AlphaComposite.Src);
+            // set background color for use with clearRect()
+            mGraphics.setBackground(BG_COLOR);
 
-        // this only for shape rendering, so we turn it off
-        mGraphics.setRenderingHint(RenderingHints.KEY_ANTIALIASING, RenderingHints.VALUE_ANTIALIAS_OFF);
+            // drawImage() to this buffer will copy all source pixels instead of alpha blending them into the current image
+            mGraphics.setComposite(AlphaComposite.Src);
 
-        // enable text antialias and highly precise rendering
-        mGraphics.setRenderingHint(RenderingHints.KEY_TEXT_ANTIALIASING, RenderingHints.VALUE_TEXT_ANTIALIAS_ON);
-        mGraphics.setRenderingHint(RenderingHints.KEY_FRACTIONALMETRICS, RenderingHints.VALUE_FRACTIONALMETRICS_ON);
+            // this only for shape rendering, so we turn it off
+            mGraphics.setRenderingHint(RenderingHints.KEY_ANTIALIASING, RenderingHints.VALUE_ANTIALIAS_OFF);
+
+            // enable text antialias and highly precise rendering
+            mGraphics.setRenderingHint(RenderingHints.KEY_TEXT_ANTIALIASING, RenderingHints.VALUE_TEXT_ANTIALIAS_ON);
+            mGraphics.setRenderingHint(RenderingHints.KEY_FRACTIONALMETRICS, RenderingHints.VALUE_FRACTIONALMETRICS_ON);
+        }
     }
 }
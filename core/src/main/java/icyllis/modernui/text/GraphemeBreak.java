@@ -77,9 +77,67 @@ public final class GraphemeBreak {
      */
     public static boolean sUseICU = true;
 
+    /**
+     * Chars below this are Latin, IPA or spacing modifiers, they are never RTL,
+     * combining marks, surrogates or emoji. Combining diacritical marks start here.
+     */
+    public static final char SIMPLE_LIMIT = 0x0300;
+
     private GraphemeBreak() {
     }
 
+    /**
+     * Returns true if the text is "simple", which contains only LTR chars that are
+     * not combining marks, surrogates or emoji. In such text, every char is a grapheme
+     * cluster except CR LF, and it requires no bidirectional analysis.
+     *
+     * @param text  the text
+     * @param start the start index
+     * @param end   the end index
+     * @return true if simple
+     */
+    public static boolean isSimpleText(@Nonnull char[] text, int start, int end) {
+        for (int i = start; i < end; i++) {
+            if (text[i] >= SIMPLE_LIMIT) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // GB3, do not break between CR and LF
+    private static boolean isSimpleBoundary(@Nonnull char[] text, int contextStart, int contextEnd, int offset) {
+        return offset <= contextStart || offset >= contextEnd
+                || text[offset - 1] != '\r' || text[offset] != '\n';
+    }
+
+    // cursor movement in simple text, same results as ICU
+    private static int getTextRunCursorSimple(@Nonnull char[] text, int contextStart, int contextEnd,
+                                              int offset, int op) {
+        switch (op) {
+            case AT_OR_AFTER:
+                if (isSimpleBoundary(text, contextStart, contextEnd, offset))
+                    return offset;
+                // fallthrough
+            case AFTER:
+                if (offset >= contextEnd)
+                    return offset;
+                offset++;
+                return isSimpleBoundary(text, contextStart, contextEnd, offset) ? offset : offset + 1;
+            case AT_OR_BEFORE:
+                if (isSimpleBoundary(text, contextStart, contextEnd, offset))
+                    return offset;
+                // fallthrough
+            case BEFORE:
+                if (offset <= contextStart)
+                    return offset;
+                offset--;
+                return isSimpleBoundary(text, contextStart, contextEnd, offset) ? offset : offset - 1;
+            default:
+                return isSimpleBoundary(text, contextStart, contextEnd, offset) ? offset : -1;
+        }
+    }
+
     /**
      * Returns the next cursor position in the run.
      * <p>
@@ -113,6 +171,9 @@ public final class GraphemeBreak {
                 || op > AT) {
             throw new IndexOutOfBoundsException();
         }
+        if (isSimpleText(text, contextStart, contextEnd)) {
+            return getTextRunCursorSimple(text, contextStart, contextEnd, offset, op);
+        }
         return sUseICU ? getTextRunCursorICU(new CharArrayIterator(text, contextStart, contextEnd), locale, offset, op)
                 : getTextRunCursorImpl(null, text, contextStart, contextLength, offset, op);
     }
@@ -172,7 +233,16 @@ public final class GraphemeBreak {
 
     public static void getTextRuns(@Nonnull char[] text, @Nonnull Locale locale, int contextStart, int contextEnd,
                                    @Nonnull RunConsumer consumer) {
-        if (sUseICU) {
+        if (isSimpleText(text, contextStart, contextEnd)) {
+            for (int i = contextStart; i < contextEnd; ) {
+                int next = i + 1;
+                if (text[i] == '\r' && next < contextEnd && text[next] == '\n') {
+                    next++;
+                }
+                consumer.onRun(i, next);
+                i = next;
+            }
+        } else if (sUseICU) {
             final BreakIterator breaker = BreakIterator.getCharacterInstance(locale);
             breaker.setText(new CharArrayIterator(text, contextStart, contextEnd));
             int prevOffset = contextStart;
@@ -21,9 +21,21 @@ package icyllis.modernui.text;
 import javax.annotation.Nonnull;
 import java.util.ArrayList;
 import java.util.List;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.atomic.AtomicInteger;
 
 public class PrecomputedText {
 
+    /**
+     * The min number of chars measured by a task in parallel mode. Paragraphs are independent,
+     * consecutive paragraphs are grouped into tasks of at least this length.
+     */
+    public static final int PARALLEL_CHUNK_SIZE = 2048;
+
+    private static volatile ExecutorService sWorkerPool;
+
     public static class ParagraphInfo {
 
         public final int paragraphEnd;
@@ -61,4 +73,83 @@ public class PrecomputedText {
         }
         return list.toArray(new ParagraphInfo[0]);
     }
+
+    /**
+     * Create measured paragraphs, and measure them on text workers in parallel if the text is
+     * long enough. The result is the same as sequential measurement. The calling thread is blocked
+     * until all paragraphs are measured, the text and paint must not be modified until then.
+     *
+     * @param parallel true to allow parallel measurement
+     * @see #createMeasuredParagraphsAsync(TextPaint, CharSequence, int, int, TextDirectionHeuristic)
+     */
+    public static ParagraphInfo[] createMeasuredParagraphs(@Nonnull TextPaint paint, @Nonnull CharSequence text,
+                                                           int start, int end, @Nonnull TextDirectionHeuristic dir,
+                                                           boolean parallel) {
+        // a worker waiting for other workers may deadlock
+        if (!parallel || end - start < PARALLEL_CHUNK_SIZE * 2 || Thread.currentThread() instanceof Worker) {
+            return createMeasuredParagraphs(paint, text, start, end, dir);
+        }
+        return createMeasuredParagraphsAsync(paint, text, start, end, dir).join();
+    }
+
+    /**
+     * Create measured paragraphs asynchronously on text workers, paragraphs are measured in parallel,
+     * then assembled in order. The paint is copied, but the text must not be modified until the
+     * returned future is completed, use an immutable text if possible.
+     *
+     * @return a future of measured paragraphs in order
+     */
+    @Nonnull
+    public static CompletableFuture<ParagraphInfo[]> createMeasuredParagraphsAsync(@Nonnull TextPaint paint,
+                                                                                   @Nonnull CharSequence text,
+                                                                                   int start, int end,
+                                                                                   @Nonnull TextDirectionHeuristic dir) {
+        final TextPaint copy = new TextPaint();
+        copy.set(paint);
+        final ExecutorService pool = getWorkerPool();
+        final List<CompletableFuture<ParagraphInfo[]>> chunks = new ArrayList<>();
+        for (int chunkStart = start, chunkEnd; chunkStart < end; chunkStart = chunkEnd) {
+            // chunks are split at paragraph boundaries, so each chunk produces the same paragraphs
+            chunkEnd = TextUtils.indexOf(text, '\n', Math.min(chunkStart + PARALLEL_CHUNK_SIZE, end) - 1, end);
+            if (chunkEnd < 0) {
+                chunkEnd = end;
+            } else {
+                chunkEnd++;
+            }
+            final int s = chunkStart, e = chunkEnd;
+            chunks.add(CompletableFuture.supplyAsync(() -> createMeasuredParagraphs(copy, text, s, e, dir), pool));
+        }
+        return CompletableFuture.allOf(chunks.toArray(new CompletableFuture[0])).thenApply(v -> {
+            final List<ParagraphInfo> list = new ArrayList<>();
+            for (CompletableFuture<ParagraphInfo[]> chunk : chunks) {
+                for (ParagraphInfo info : chunk.join()) {
+                    list.add(info);
+                }
+            }
+            return list.toArray(new ParagraphInfo[0]);
+        });
+    }
+
+    @Nonnull
+    private static ExecutorService getWorkerPool() {
+        if (sWorkerPool == null) {
+            synchronized (PrecomputedText.class) {
+                if (sWorkerPool == null) {
+                    final int threads = Math.max(1, Math.min(4, Runtime.getRuntime().availableProcessors() >> 1));
+                    final AtomicInteger index = new AtomicInteger();
+                    sWorkerPool = Executors.newFixedThreadPool(threads,
+                            target -> new Worker(target, "mui-text-worker-" + index.getAndIncrement()));
+                }
+            }
+        }
+        return sWorkerPool;
+    }
+
+    private static final class Worker extends Thread {
+
+        Worker(Runnable target, String name) {
+            super(target, name);
+            setDaemon(true);
+        }
+    }
 }
@@ -301,7 +301,7 @@ public class StaticLayout extends TextLayout {
         PrecomputedText.ParagraphInfo[] paragraphInfo;
         final Spanned spanned = (source instanceof Spanned) ? (Spanned) source : null;
 
-        paragraphInfo = PrecomputedText.createMeasuredParagraphs(paint, source, bufStart, bufEnd, textDir);
+        paragraphInfo = PrecomputedText.createMeasuredParagraphs(paint, source, bufStart, bufEnd, textDir, true);
 
         for (int paraIndex = 0, paraStart = 0, paraEnd;
              paraIndex < paragraphInfo.length;
@@ -39,6 +39,13 @@ public abstract class TextLayout {
         mText = text;
     }
 
+    /**
+     * Return the text that is displayed by this Layout.
+     */
+    public final CharSequence getText() {
+        return mText;
+    }
+
     /**
      * Returns the same as <code>text.getSpans()</code>, except where
      * <code>start</code> and <code>end</code> are the same and are not
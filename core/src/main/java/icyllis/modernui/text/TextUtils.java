@@ -164,4 +164,23 @@ public final class TextUtils {
 
         return -1;
     }
+
+    public static int lastIndexOf(CharSequence s, char ch, int last) {
+        if (s instanceof String)
+            return ((String) s).lastIndexOf(ch, last);
+        return lastIndexOf(s, ch, 0, last);
+    }
+
+    public static int lastIndexOf(@Nonnull CharSequence s, char ch, int start, int last) {
+        if (last < 0)
+            return -1;
+        if (last >= s.length())
+            last = s.length() - 1;
+
+        for (int i = last; i >= start; i--)
+            if (s.charAt(i) == ch)
+                return i;
+
+        return -1;
+    }
 }
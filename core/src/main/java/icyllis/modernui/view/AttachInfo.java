@@ -19,6 +19,8 @@
 package icyllis.modernui.view;
 
 import icyllis.modernui.math.PointF;
+import icyllis.modernui.math.Rect;
+import icyllis.modernui.math.RectF;
 
 /**
  * A set of information given to a view when it is attached to its parent
@@ -38,6 +40,12 @@ final class AttachInfo {
 
     PointF mTmpPointF = new PointF();
 
+    /**
+     * Temporary rects used to compute invalidation regions.
+     */
+    final RectF mTmpInvalRect = new RectF();
+    final Rect mTmpRect = new Rect();
+
     AttachInfo(ViewRootImpl viewRootImpl) {
         mViewRootImpl = viewRootImpl;
     }
@@ -18,6 +18,7 @@
 
 package icyllis.modernui.view;
 
+import it.unimi.dsi.fastutil.longs.LongArrayList;
 import it.unimi.dsi.fastutil.objects.ObjectArrayList;
 import org.apache.commons.lang3.builder.ToStringBuilder;
 import org.apache.commons.lang3.builder.ToStringStyle;
@@ -25,6 +26,7 @@ import org.lwjgl.glfw.GLFW;
 import org.lwjgl.system.Platform;
 
 import javax.annotation.Nonnull;
+import java.util.List;
 
 /**
  * Object that indicates movement events (mouse, touchpad etc)
@@ -380,8 +382,11 @@ public final class MotionEvent extends InputEvent {
      */
     public static final int AXIS_HSCROLL = 10;
 
-    @Deprecated
-    private static final int HISTORY_CURRENT = Integer.MIN_VALUE;
+    /**
+     * The max number of historical samples kept in a batched event, older samples are
+     * discarded.
+     */
+    private static final int MAX_HISTORY_SIZE = 64;
 
     private static final float INVALID_CURSOR_POSITION = Float.NaN;
 
@@ -428,6 +433,12 @@ public final class MotionEvent extends InputEvent {
     private final ObjectArrayList<PointerProperties> mPointerProperties = new ObjectArrayList<>();
     private final ObjectArrayList<PointerCoords> mPointerCoords = new ObjectArrayList<>();
 
+    // historical samples of a batched movement, oldest first, the current sample is not included.
+    // pointer coords are indexed by (historyIndex * pointerCount + pointerIndex), they are
+    // reused after recycling, so the list may be larger than the history
+    private final LongArrayList mSampleEventTimes = new LongArrayList();
+    private final ObjectArrayList<PointerCoords> mSamplePointerCoords = new ObjectArrayList<>();
+
     private MotionEvent() {
 
     }
@@ -552,10 +563,32 @@ public final class MotionEvent extends InputEvent {
         mRawYCursorPosition = other.mRawYCursorPosition;
         mDownTime = other.mDownTime;
         mEventTime = other.mEventTime;
-        mPointerProperties.clear();
-        mPointerProperties.addAll(other.mPointerProperties);
-        mPointerCoords.clear();
-        mPointerCoords.addAll(other.mPointerCoords);
+        final int pointerCount = other.getPointerCount();
+        mPointerProperties.size(pointerCount);
+        mPointerCoords.size(pointerCount);
+        for (int i = 0; i < pointerCount; i++) {
+            setPointer(i, other.mPointerProperties.get(i), other.mPointerCoords.get(i));
+        }
+        mSampleEventTimes.clear();
+        for (int i = 0, e = other.getHistorySize(); i < e; i++) {
+            addSample(other.mSampleEventTimes.getLong(i), other.mSamplePointerCoords,
+                    i * pointerCount, 0, 0);
+        }
+    }
+
+    // the source may be shared temporary objects, always copy them into objects owned by this event
+    private void setPointer(int pointerIndex, @Nonnull PointerProperties properties,
+                            @Nonnull PointerCoords coords) {
+        PointerProperties p = mPointerProperties.get(pointerIndex);
+        if (p == null) {
+            mPointerProperties.set(pointerIndex, p = new PointerProperties());
+        }
+        p.copyFrom(properties);
+        PointerCoords c = mPointerCoords.get(pointerIndex);
+        if (c == null) {
+            mPointerCoords.set(pointerIndex, c = new PointerCoords());
+        }
+        c.copyFrom(coords);
     }
 
     @SuppressWarnings("SameParameterValue")
@@ -583,10 +616,12 @@ public final class MotionEvent extends InputEvent {
         mRawYCursorPosition = rawYCursorPosition;
         mDownTime = downTime;
         mEventTime = eventTime;
-        mPointerProperties.clear();
-        mPointerProperties.addElements(0, pointerProperties, 0, pointerCount);
-        mPointerCoords.clear();
-        mPointerCoords.addElements(0, pointerCoords, 0, pointerCount);
+        mPointerProperties.size(pointerCount);
+        mPointerCoords.size(pointerCount);
+        for (int i = 0; i < pointerCount; i++) {
+            setPointer(i, pointerProperties[i], pointerCoords[i]);
+        }
+        mSampleEventTimes.clear();
         updateCursorPosition();
     }
 
@@ -828,39 +863,10 @@ public final class MotionEvent extends InputEvent {
         setAction(ACTION_CANCEL);
     }
 
-    /*private long getEventTimeNanos(int historyPos) {
-        if (historyPos == HISTORY_CURRENT) {
-            return mSampleEventTimes.getLong(getHistorySize());
-        } else {
-            if (historyPos < 0 || historyPos >= getHistorySize()) {
-                throw new IllegalArgumentException("historyPos out of range");
-            }
-            return mSampleEventTimes.getLong(historyPos);
-        }
-    }*/
-
     private PointerCoords getRawPointerCoords(int pointerIndex) {
         return mPointerCoords.get(pointerIndex);
     }
 
-    /*private PointerCoords getHistoricalRawPointerCoords(int pointerIndex, int historyIndex) {
-        return mSamplePointerCoords.get(historyIndex * getPointerCount() + pointerIndex);
-    }*/
-
-    /*private float getAxisValue(int axis, int pointerIndex, int historyPos) {
-        if (pointerIndex < 0 || pointerIndex >= getPointerCount()) {
-            throw new IllegalArgumentException("pointerIndex out of range");
-        }
-        if (historyPos == HISTORY_CURRENT) {
-            return getAxisValue(axis, pointerIndex);
-        } else {
-            if (historyPos < 0 || historyPos >= getHistorySize()) {
-                throw new IllegalArgumentException("historyPos out of range");
-            }
-            return getHistoricalAxisValue(axis, pointerIndex, historyPos);
-        }
-    }*/
-
     private float getRawAxisValue(int axis, int pointerIndex) {
         if (pointerIndex < 0 || pointerIndex >= getPointerCount()) {
             throw new IllegalArgumentException("pointerIndex out of range");
@@ -895,8 +901,79 @@ public final class MotionEvent extends InputEvent {
         getRawPointerCoords(pointerIndex).setAxisValue(axis, value);
     }
 
-    /*private float getHistoricalAxisValue(int axis, int pointerIndex, int historyIndex) {
-        float value = getHistoricalRawPointerCoords(pointerIndex, historyIndex).getAxisValue(axis);
+    /**
+     * Returns the number of historical samples in this event. Consecutive movements
+     * delivered in the same frame are batched into a single event, the movements that
+     * occurred before the current one are historical samples, oldest first. They can be
+     * used for computing velocity.
+     *
+     * @return the number of historical samples
+     */
+    public final int getHistorySize() {
+        return mSampleEventTimes.size();
+    }
+
+    /**
+     * Returns the time (in ms) that a historical movement occurred.
+     *
+     * @param pos which historical value to return, 0..getHistorySize()-1
+     * @see #getEventTime()
+     */
+    public final long getHistoricalEventTime(int pos) {
+        return getHistoricalEventTimeNano(pos) / 1000000;
+    }
+
+    /**
+     * Returns the time (in ns) that a historical movement occurred.
+     *
+     * @param pos which historical value to return, 0..getHistorySize()-1
+     * @see #getEventTimeNano()
+     */
+    public final long getHistoricalEventTimeNano(int pos) {
+        if (pos < 0 || pos >= getHistorySize()) {
+            throw new IllegalArgumentException("historyPos out of range");
+        }
+        return mSampleEventTimes.getLong(pos);
+    }
+
+    /**
+     * {@link #getHistoricalX(int, int)} for the first pointer index.
+     */
+    public final float getHistoricalX(int pos) {
+        return getHistoricalAxisValue(AXIS_X, 0, pos);
+    }
+
+    /**
+     * {@link #getHistoricalY(int, int)} for the first pointer index.
+     */
+    public final float getHistoricalY(int pos) {
+        return getHistoricalAxisValue(AXIS_Y, 0, pos);
+    }
+
+    public final float getHistoricalX(int pointerIndex, int pos) {
+        return getHistoricalAxisValue(AXIS_X, pointerIndex, pos);
+    }
+
+    public final float getHistoricalY(int pointerIndex, int pos) {
+        return getHistoricalAxisValue(AXIS_Y, pointerIndex, pos);
+    }
+
+    /**
+     * Returns the historical value of the requested axis, for the given pointer
+     * index, the same as {@link #getAxisValue(int, int)} for the current sample.
+     *
+     * @param axis         the axis identifier
+     * @param pointerIndex raw index of pointer to retrieve
+     * @param pos          which historical value to return, 0..getHistorySize()-1
+     */
+    public final float getHistoricalAxisValue(int axis, int pointerIndex, int pos) {
+        if (pointerIndex < 0 || pointerIndex >= getPointerCount()) {
+            throw new IllegalArgumentException("pointerIndex out of range");
+        }
+        if (pos < 0 || pos >= getHistorySize()) {
+            throw new IllegalArgumentException("historyPos out of range");
+        }
+        float value = mSamplePointerCoords.get(pos * getPointerCount() + pointerIndex).getAxisValue(axis);
         switch (axis) {
             case AXIS_X:
                 return value + mXOffset;
@@ -904,7 +981,98 @@ public final class MotionEvent extends InputEvent {
                 return value + mYOffset;
         }
         return value;
-    }*/
+    }
+
+    /**
+     * Adds a new movement to the batch of movements in this event, the current movement
+     * becomes a historical sample. This is only for single pointer events.
+     *
+     * @param eventTime the time (in ns) of the movement
+     * @param x         the new X position
+     * @param y         the new Y position
+     * @param modifiers the new modifier keys state
+     */
+    public final void addBatch(long eventTime, float x, float y, int modifiers) {
+        addSample(mEventTime, mPointerCoords, 0, 0, 0);
+        final PointerCoords coords = getRawPointerCoords(0);
+        coords.setAxisValue(AXIS_X, x - mXOffset);
+        coords.setAxisValue(AXIS_Y, y - mYOffset);
+        mEventTime = eventTime;
+        mModifiers = modifiers;
+        updateCursorPosition();
+    }
+
+    /**
+     * Merges a later movement into this event, all samples of the other event are added
+     * to the batch and its current sample becomes the current one. This is possible only
+     * if both events are movements of the same pointers and buttons.
+     *
+     * @param event the later event, it's not modified
+     * @return true if merged, false if they are not compatible
+     */
+    public final boolean addBatch(@Nonnull MotionEvent event) {
+        final int pointerCount = getPointerCount();
+        if (mAction != event.mAction || mButtonState != event.mButtonState ||
+                pointerCount != event.getPointerCount()) {
+            return false;
+        }
+        for (int i = 0; i < pointerCount; i++) {
+            if (getPointerId(i) != event.getPointerId(i)) {
+                return false;
+            }
+        }
+        // the raw coords of the other event in the space of this event
+        final float dx = event.mXOffset - mXOffset;
+        final float dy = event.mYOffset - mYOffset;
+        addSample(mEventTime, mPointerCoords, 0, 0, 0);
+        for (int i = 0, e = event.getHistorySize(); i < e; i++) {
+            addSample(event.mSampleEventTimes.getLong(i), event.mSamplePointerCoords,
+                    i * pointerCount, dx, dy);
+        }
+        for (int i = 0; i < pointerCount; i++) {
+            final PointerCoords coords = getRawPointerCoords(i);
+            coords.copyFrom(event.getRawPointerCoords(i));
+            offsetCoords(coords, dx, dy);
+        }
+        mEventTime = event.mEventTime;
+        mModifiers = event.mModifiers;
+        updateCursorPosition();
+        return true;
+    }
+
+    // append a historical sample, the coords are copied
+    private void addSample(long eventTime, @Nonnull List<PointerCoords> coords, int offset, float dx, float dy) {
+        final int pointerCount = getPointerCount();
+        final ObjectArrayList<PointerCoords> samples = mSamplePointerCoords;
+        if (getHistorySize() == MAX_HISTORY_SIZE) {
+            // discard the oldest one, and move its coords to the end for reuse
+            mSampleEventTimes.removeLong(0);
+            for (int i = 0; i < pointerCount; i++) {
+                samples.add(samples.remove(0));
+            }
+        }
+        final int base = getHistorySize() * pointerCount;
+        for (int i = 0; i < pointerCount; i++) {
+            PointerCoords c;
+            if (base + i < samples.size()) {
+                c = samples.get(base + i);
+            } else {
+                samples.add(c = new PointerCoords());
+            }
+            c.copyFrom(coords.get(offset + i));
+            offsetCoords(c, dx, dy);
+        }
+        mSampleEventTimes.add(eventTime);
+    }
+
+    private static void offsetCoords(@Nonnull PointerCoords coords, float dx, float dy) {
+        if (dx != 0) {
+            coords.setAxisValue(AXIS_X, coords.getAxisValue(AXIS_X) + dx);
+        }
+        if (dy != 0) {
+            coords.setAxisValue(AXIS_Y, coords.getAxisValue(AXIS_Y) + dy);
+        }
+    }
 
     /**
      * Get axis value for the first pointer index (may be an
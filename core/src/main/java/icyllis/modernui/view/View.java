@@ -23,8 +23,13 @@ import icyllis.modernui.animation.AnimationHandler;
 import icyllis.modernui.annotation.CallSuper;
 import icyllis.modernui.annotation.UiThread;
 import icyllis.modernui.graphics.Canvas;
+import icyllis.modernui.graphics.GLCanvas;
+import icyllis.modernui.graphics.Layer;
+import icyllis.modernui.graphics.RenderNode;
 import icyllis.modernui.graphics.drawable.Drawable;
 import icyllis.modernui.math.*;
+import it.unimi.dsi.fastutil.longs.Long2LongMap;
+import it.unimi.dsi.fastutil.longs.Long2LongOpenHashMap;
 import org.apache.logging.log4j.Marker;
 import org.apache.logging.log4j.MarkerManager;
 import org.lwjgl.glfw.GLFW;
@@ -86,6 +91,7 @@ public class View implements Drawable.Callback {
      * |--------|--------|--------|--------|
      *       1                               PFLAG_CANCEL_NEXT_UP_EVENT
      *     1                                 PFLAG_HOVERED
+     *    1                                  PFLAG_INVALIDATED
      * |--------|--------|--------|--------|
      */
     static final int PFLAG_SKIP_DRAW = 0x00000080;
@@ -104,7 +110,19 @@ public class View implements Drawable.Callback {
      */
     private static final int PFLAG_HOVERED = 0x10000000;
 
+    /**
+     * Indicates that the content of this view or its descendants changed, the
+     * render node must be recorded again in the next draw.
+     */
+    static final int PFLAG_INVALIDATED = 0x20000000;
+
     private static final int PFLAG2_BACKGROUND_SIZE_CHANGED = 0x00000001;
+    /**
+     * The measured dimension was restored from the measure cache, but descendants
+     * may have been measured with other specs since then, so onMeasure() must be
+     * called again before layout.
+     */
+    private static final int PFLAG2_MEASURE_NEEDED_BEFORE_LAYOUT = 0x00000002;
 
     // private flags
     int mPrivateFlags;
@@ -287,6 +305,23 @@ public class View implements Drawable.Callback {
     private int mPrevWidthMeasureSpec = Integer.MIN_VALUE;
     private int mPrevHeightMeasureSpec = Integer.MIN_VALUE;
 
+    /**
+     * Measured dimensions keyed by measure specs, so a view measured several times
+     * in a layout pass with the same specs calls onMeasure() only once. This is
+     * cleared when a layout is requested.
+     */
+    @Nullable
+    private Long2LongMap mMeasureCache;
+
+    /**
+     * The layout pass being performed, and the number of times onMeasure() was called
+     * on this view in the pass, for finding expensive layouts.
+     */
+    private static int sMeasurePass;
+    private static int sMeasureTotal;
+    private int mMeasurePass;
+    private int mMeasureCount;
+
     /**
      * The measurement result in onMeasure(), used to layout
      */
@@ -305,6 +340,37 @@ public class View implements Drawable.Callback {
      */
     private ViewGroup.LayoutParams mLayoutParams;
 
+    /**
+     * The retained display list of this view, including its children.
+     */
+    private RenderNode mRenderNode;
+
+    /**
+     * Indicates that the view does not have a layer.
+     *
+     * @see #setLayerType(int)
+     */
+    public static final int LAYER_TYPE_NONE = 0;
+
+    /**
+     * Indicates that the view has a hardware layer. The view and its children are
+     * rendered into an offscreen texture, which is drawn with the transition alpha
+     * and matrix of the view. The layer is rendered again only if the view or its
+     * descendants are invalidated, so animating the alpha or the matrix of a complex
+     * view is cheap. Other values are reserved.
+     *
+     * @see #setLayerType(int)
+     */
+    public static final int LAYER_TYPE_HARDWARE = 2;
+
+    private int mLayerType = LAYER_TYPE_NONE;
+
+    /**
+     * The offscreen layer if the view has a hardware layer or is translucent.
+     */
+    @Nullable
+    private Layer mLayer;
+
     /**
      * This method is called by ViewGroup.drawChild() to have each child view draw itself.
      */
@@ -342,23 +408,71 @@ public class View implements Drawable.Callback {
             hasSpace = canvas.clipRect(0, 0, getWidth(), getHeight());
         }
 
-        canvas.translate(-sx, -sy);
-
         if (hasSpace) {
-            //TODO stacked offscreen rendering
-            /*if (alpha < 1) {
-
-            }*/
-
-            if ((mPrivateFlags & PFLAG_SKIP_DRAW) == PFLAG_SKIP_DRAW) {
-                dispatchDraw(canvas);
+            final int width = getWidth();
+            final int height = getHeight();
+            // translucent views are composited as a whole, otherwise overlapping children
+            // are blended with each other, unless the content never overlaps
+            if (canvas instanceof GLCanvas && width > 0 && height > 0 &&
+                    (mLayerType == LAYER_TYPE_HARDWARE || (alpha < 1 && hasOverlappingRendering()))) {
+                final GLCanvas glCanvas = (GLCanvas) canvas;
+                Layer layer = mLayer;
+                if (layer == null) {
+                    layer = mLayer = Layer.obtain(width, height);
+                } else {
+                    layer.setSize(width, height);
+                }
+                // render again only if the content changed
+                if ((mPrivateFlags & PFLAG_INVALIDATED) != 0 || !layer.isValid()) {
+                    mPrivateFlags &= ~PFLAG_INVALIDATED;
+                    if (mRenderNode != null) {
+                        // out of date when the layer is released
+                        mRenderNode.discard();
+                    }
+                    glCanvas.beginLayer(layer);
+                    glCanvas.translate(-sx, -sy);
+                    drawContent(canvas);
+                    glCanvas.endLayer(layer);
+                }
+                glCanvas.drawLayer(layer, (int) (alpha * 255 + 0.5f));
+            } else if (canvas instanceof GLCanvas) {
+                final GLCanvas glCanvas = (GLCanvas) canvas;
+                // no longer composited
+                destroyLayer();
+                canvas.translate(-sx, -sy);
+                // the alpha goes to paint colors directly
+                final float parentAlpha = glCanvas.getAlphaMultiplier();
+                if (alpha < 1) {
+                    glCanvas.setAlphaMultiplier(parentAlpha * alpha);
+                }
+                RenderNode node = mRenderNode;
+                if (node == null) {
+                    node = mRenderNode = new RenderNode();
+                }
+                // replay if nothing changed, otherwise record again
+                if ((mPrivateFlags & PFLAG_INVALIDATED) != 0 || !glCanvas.drawRenderNode(node)) {
+                    mPrivateFlags &= ~PFLAG_INVALIDATED;
+                    glCanvas.beginRecording(node);
+                    drawContent(canvas);
+                    glCanvas.endRecording(node);
+                }
+                glCanvas.setAlphaMultiplier(parentAlpha);
             } else {
-                draw(canvas);
+                canvas.translate(-sx, -sy);
+                drawContent(canvas);
             }
         }
         canvas.restoreToCount(saveCount);
     }
 
+    private void drawContent(@Nonnull Canvas canvas) {
+        if ((mPrivateFlags & PFLAG_SKIP_DRAW) == PFLAG_SKIP_DRAW) {
+            dispatchDraw(canvas);
+        } else {
+            draw(canvas);
+        }
+    }
+
     /**
      * Raw method that directly draws this view and its background, foreground,
      * overlay and all children to the given canvas. When implementing a view,
@@ -609,6 +723,12 @@ public class View implements Drawable.Callback {
      * @param bottom bottom position, relative to parent
      */
     public void layout(int left, int top, int right, int bottom) {
+        if ((mPrivateFlags2 & PFLAG2_MEASURE_NEEDED_BEFORE_LAYOUT) != 0) {
+            onMeasure(mPrevWidthMeasureSpec, mPrevHeightMeasureSpec);
+            countMeasure();
+            mPrivateFlags2 &= ~PFLAG2_MEASURE_NEEDED_BEFORE_LAYOUT;
+        }
+
         boolean changed = setFrame(left, top, right, bottom);
 
         if (changed || (mPrivateFlags & PFLAG_LAYOUT_REQUIRED) != 0) {
@@ -683,6 +803,7 @@ public class View implements Drawable.Callback {
      * <p>
      * This method is used to post the onMeasure() event, and the actual
      * measurement work is performed in {@link #onMeasure(int, int)}.
+     * The results are cached by specs until {@link #requestLayout()}.
      *
      * @param widthMeasureSpec  width measure specification imposed by the parent
      * @param heightMeasureSpec height measure specification imposed by the parent
@@ -708,17 +829,34 @@ public class View implements Drawable.Callback {
         }
 
         if (needsLayout) {
-            // remove the flag first anyway
-            mPrivateFlags &= ~PFLAG_MEASURED_DIMENSION_SET;
+            final long key = (long) widthMeasureSpec << 32 | (long) heightMeasureSpec & 0xffffffffL;
+            if (mMeasureCache == null) {
+                mMeasureCache = new Long2LongOpenHashMap(2);
+                mMeasureCache.defaultReturnValue(-1);
+            }
+            // forced views were never measured with the specs since the cache was cleared
+            final long cached = mMeasureCache.get(key);
+            if (cached != -1) {
+                setMeasuredDimension((int) (cached >> 32), (int) cached);
+                mPrivateFlags2 |= PFLAG2_MEASURE_NEEDED_BEFORE_LAYOUT;
+            } else {
+                // remove the flag first anyway
+                mPrivateFlags &= ~PFLAG_MEASURED_DIMENSION_SET;
 
-            // measure ourselves, this should set the measured dimension flag back
-            onMeasure(widthMeasureSpec, heightMeasureSpec);
+                // measure ourselves, this should set the measured dimension flag back
+                onMeasure(widthMeasureSpec, heightMeasureSpec);
 
-            // the flag should be added in onMeasure() by calling setMeasuredDimension()
-            if ((mPrivateFlags & PFLAG_MEASURED_DIMENSION_SET) == 0) {
-                throw new IllegalStateException(getClass().getName() +
-                        "#onMeasure() did not set the measured dimension" +
-                        "by calling setMeasuredDimension()");
+                // the flag should be added in onMeasure() by calling setMeasuredDimension()
+                if ((mPrivateFlags & PFLAG_MEASURED_DIMENSION_SET) == 0) {
+                    throw new IllegalStateException(getClass().getName() +
+                            "#onMeasure() did not set the measured dimension" +
+                            "by calling setMeasuredDimension()");
+                }
+
+                mMeasureCache.put(key, (long) mMeasuredWidth << 32 | (long) mMeasuredHeight & 0xffffffffL);
+                mPrivateFlags2 &= ~PFLAG2_MEASURE_NEEDED_BEFORE_LAYOUT;
+
+                countMeasure();
             }
 
             mPrivateFlags |= PFLAG_LAYOUT_REQUIRED;
@@ -728,6 +866,43 @@ public class View implements Drawable.Callback {
         mPrevHeightMeasureSpec = heightMeasureSpec;
     }
 
+    private void countMeasure() {
+        if (mMeasurePass != sMeasurePass) {
+            mMeasurePass = sMeasurePass;
+            mMeasureCount = 0;
+        }
+        sMeasureTotal++;
+        if (++mMeasureCount == 2 && ModernUI.LOGGER.isDebugEnabled(MARKER)) {
+            ModernUI.LOGGER.debug(MARKER, "{} was measured more than once in a layout pass", this);
+        }
+    }
+
+    /**
+     * Starts a new layout pass, measure counts of the last pass are reset lazily.
+     */
+    static void startMeasurePass() {
+        sMeasurePass++;
+        sMeasureTotal = 0;
+    }
+
+    /**
+     * @return the total number of onMeasure() calls in the last layout pass
+     */
+    static int getMeasureTotal() {
+        return sMeasureTotal;
+    }
+
+    /**
+     * Returns the number of times {@link #onMeasure(int, int)} was called on this view
+     * in the last layout pass. A count greater than one indicates that the parent
+     * measures this view with different specs, which may be expensive for a deep tree.
+     *
+     * @return the measure count
+     */
+    public final int getMeasureCount() {
+        return mMeasurePass == sMeasurePass ? mMeasureCount : 0;
+    }
+
     /**
      * Measure the view and its content to determine the measured width and the
      * measured height. This method is invoked by {@link #measure(int, int)} and
@@ -956,6 +1131,10 @@ public class View implements Drawable.Callback {
         mViewFlags = (mViewFlags & ~mask) | (flag & mask);
 
         final int change = mViewFlags ^ old;
+
+        if ((change & VISIBILITY_MASK) != 0) {
+            invalidate();
+        }
     }
 
     /**
@@ -1007,7 +1186,7 @@ public class View implements Drawable.Callback {
 
         // Invalidate too, since the default behavior for views is to be
         // be drawn at 50% alpha rather than to change the drawable.
-        //invalidate(true);
+        invalidate();
 
         if (!enabled) {
             //cancelPendingInputEvents();
@@ -1043,12 +1222,62 @@ public class View implements Drawable.Callback {
     }
 
     /**
-     * Invalidate the whole view hierarchy. All views will be redrawn
-     * in the future.
+     * Invalidate the content of this view. This view and its ancestors will be
+     * recorded again in the future, other views replay their render nodes.
+     * Only the area of this view on screen will be redrawn.
      */
     public final void invalidate() {
-        if (mAttachInfo != null) {
-            mAttachInfo.mViewRootImpl.invalidate();
+        mPrivateFlags |= PFLAG_INVALIDATED;
+        invalidateViewProperty();
+    }
+
+    /**
+     * Invalidate the area of this view after changing a property that affects only how
+     * this view is drawn by its parent, such as the matrix or the alpha. Only ancestors
+     * will be recorded again, so the layer of this view can be kept.
+     */
+    private void invalidateViewProperty() {
+        ViewParent parent = mParent;
+        while (parent instanceof View) {
+            final View view = (View) parent;
+            view.mPrivateFlags |= PFLAG_INVALIDATED;
+            parent = view.mParent;
+        }
+        final AttachInfo info = mAttachInfo;
+        if (info != null) {
+            final RectF r = info.mTmpInvalRect;
+            r.set(0, 0, getWidth(), getHeight());
+            transformToRoot(r);
+            final Rect dirty = info.mTmpRect;
+            r.roundOut(dirty);
+            info.mViewRootImpl.invalidate(dirty);
+        }
+    }
+
+    /**
+     * Maps a rect in this view's local coordinates to the root view's coordinates,
+     * the same as what's done in {@link #draw(Canvas, ViewGroup, boolean)}.
+     *
+     * @param r the rect to transform
+     */
+    private void transformToRoot(@Nonnull RectF r) {
+        View view = this;
+        ViewParent parent = mParent;
+        while (parent instanceof View) {
+            if (!view.hasIdentityMatrix()) {
+                view.getMatrix().transform(r);
+            }
+            if (view.mTransitionMatrix != null) {
+                view.mTransitionMatrix.transform(r);
+            }
+            r.offset(view.mLeft, view.mTop);
+            final View p = (View) parent;
+            // the root view is drawn without scrolling
+            if (p.mParent instanceof View) {
+                r.offset(-p.mScrollX, -p.mScrollY);
+            }
+            view = p;
+            parent = p.mParent;
         }
     }
 
@@ -1557,7 +1786,10 @@ public class View implements Drawable.Callback {
      */
     public void setTranslationX(float translationX) {
         ensureTransformation();
+        // invalidate both the old and new areas
+        invalidateViewProperty();
         mTransformation.setTranslationX(translationX);
+        invalidateViewProperty();
     }
 
     /**
@@ -1573,7 +1805,9 @@ public class View implements Drawable.Callback {
      * @see #getTransitionMatrix()
      */
     public final void setTransitionMatrix(@Nullable Matrix4 matrix) {
+        invalidateViewProperty();
         mTransitionMatrix = matrix;
+        invalidateViewProperty();
     }
 
     /**
@@ -1593,10 +1827,105 @@ public class View implements Drawable.Callback {
         return mTransitionMatrix;
     }
 
+    /**
+     * Changes the transition alpha of the view. This is only used in the transition animation
+     * framework. A translucent view is rendered into an offscreen layer, then drawn with the
+     * alpha, see {@link #setLayerType(int)} for keeping the layer and
+     * {@link #hasOverlappingRendering()} for skipping it.
+     *
+     * @param alpha the opacity of the view, 0..1
+     * @see #getTransitionAlpha()
+     */
+    public final void setTransitionAlpha(float alpha) {
+        alpha = Math.max(0, Math.min(1, alpha));
+        if (mTransitionAlpha != alpha) {
+            mTransitionAlpha = alpha;
+            invalidateViewProperty();
+        }
+    }
+
+    /**
+     * Returns the transition alpha of the view, 1 by default.
+     *
+     * @return the opacity of the view, 0..1
+     * @see #setTransitionAlpha(float)
+     */
+    public final float getTransitionAlpha() {
+        return mTransitionAlpha;
+    }
+
+    /**
+     * Specifies the type of layer backing this view. With {@link #LAYER_TYPE_HARDWARE},
+     * the view and its descendants are cached in an offscreen layer, which is useful
+     * for transition animations on complex views, such as fading or sliding menus.
+     * The layer is rendered again when the view or its descendants are invalidated.
+     * <p>
+     * The layer is released when the type is set back to {@link #LAYER_TYPE_NONE}
+     * or the view is detached from window.
+     *
+     * @param layerType the type of layer to use
+     * @see #getLayerType()
+     */
+    public void setLayerType(int layerType) {
+        if (layerType != LAYER_TYPE_NONE && layerType != LAYER_TYPE_HARDWARE) {
+            throw new IllegalArgumentException("Not a valid layer type " + layerType);
+        }
+        if (mLayerType == layerType) {
+            return;
+        }
+        mLayerType = layerType;
+        if (layerType == LAYER_TYPE_NONE) {
+            // obtained again on next draw if still translucent
+            destroyLayer();
+        }
+        invalidate();
+    }
+
+    private void destroyLayer() {
+        if (mLayer != null) {
+            mLayer.recycle();
+            mLayer = null;
+        }
+    }
+
+    /**
+     * Returns whether this view has content that overlaps itself, such as a
+     * background and a text, or overlapping children. Such a view is rendered into
+     * an offscreen layer to be made translucent correctly. Otherwise the alpha is
+     * multiplied into colors directly, which is much faster.
+     * <p>
+     * By default this returns true, override it if the content never overlaps.
+     *
+     * @return true if the content overlaps, false otherwise
+     * @see #setTransitionAlpha(float)
+     */
+    public boolean hasOverlappingRendering() {
+        return true;
+    }
+
+    /**
+     * Returns the type of layer backing this view.
+     *
+     * @return {@link #LAYER_TYPE_NONE} or {@link #LAYER_TYPE_HARDWARE}
+     * @see #setLayerType(int)
+     */
+    public int getLayerType() {
+        return mLayerType;
+    }
+
     void dispatchAttachedToWindow(AttachInfo info) {
         mAttachInfo = info;
     }
 
+    // release the graphics resources, they are obtained again if attached again
+    void dispatchDetachedFromWindow() {
+        mAttachInfo = null;
+        destroyLayer();
+        if (mRenderNode != null) {
+            mRenderNode.discard();
+        }
+    }
+
     /**
      * Request layout if layout information changed.
      * This will schedule a layout pass of the view tree.
@@ -1604,7 +1933,12 @@ public class View implements Drawable.Callback {
     public void requestLayout() {
         boolean requestParent = (mPrivateFlags & PFLAG_FORCE_LAYOUT) == 0;
 
+        if (mMeasureCache != null) {
+            mMeasureCache.clear();
+        }
+
         mPrivateFlags |= PFLAG_FORCE_LAYOUT;
+        mPrivateFlags |= PFLAG_INVALIDATED;
 
         if (requestParent && mParent != null) {
             mParent.requestLayout();
@@ -1616,6 +1950,9 @@ public class View implements Drawable.Callback {
      * layout pass.
      */
     public void forceLayout() {
+        if (mMeasureCache != null) {
+            mMeasureCache.clear();
+        }
         mPrivateFlags |= PFLAG_FORCE_LAYOUT;
     }
 
@@ -1630,6 +1967,7 @@ public class View implements Drawable.Callback {
     public void refreshDrawableState() {
         mPrivateFlags |= PFLAG_DRAWABLE_STATE_DIRTY;
         drawableStateChanged();
+        invalidate();
 
         ViewParent parent = mParent;
         if (parent != null) {
@@ -1727,6 +2065,7 @@ public class View implements Drawable.Callback {
         if (background != null) {
             background.setCallback(this);
         }
+        invalidate();
     }
 
     /**
@@ -696,17 +696,35 @@ public abstract class ViewGroup extends View implements ViewParent {
      * @param params layout params of the view
      */
     public void addView(@Nonnull View child, int index, @Nonnull LayoutParams params) {
-        addViewInner(child, index, params);
+        addViewInner(child, index, params, false);
     }
 
-    private void addViewInner(@Nonnull final View child, int index, @Nonnull LayoutParams params) {
+    /**
+     * Adds a view during layout. This is useful if in your onLayout() method,
+     * you need to add more views (as does the list view for example).
+     * <p>
+     * If index is negative, it means put it at the end of the list.
+     *
+     * @param child  the view to add to the group
+     * @param index  the index at which the child must be added or -1 to add last
+     * @param params the layout parameters to associate with the child
+     * @return true if the child was added, false otherwise
+     */
+    protected boolean addViewInLayout(@Nonnull View child, int index, @Nonnull LayoutParams params) {
+        return addViewInner(child, index, params, true);
+    }
+
+    private boolean addViewInner(@Nonnull final View child, int index, @Nonnull LayoutParams params,
+                                 boolean preventRequestLayout) {
         if (child.getParent() != null) {
             ModernUI.LOGGER.fatal(MARKER,
                     "Failed to add child view {} to {}. The child has already a parent.", child, this);
-            return;
+            return false;
         }
 
-        requestLayout();
+        if (!preventRequestLayout) {
+            requestLayout();
+        }
 
         if (!checkLayoutParams(params)) {
             params = convertLayoutParams(params);
@@ -726,6 +744,75 @@ public abstract class ViewGroup extends View implements ViewParent {
         if (attachInfo != null) {
             child.dispatchAttachedToWindow(attachInfo);
         }
+        return true;
+    }
+
+    /**
+     * Removes a range of views during layout, the removed views have no parent
+     * and can be added to any view group again. This is useful if in your onLayout()
+     * method, you need to remove views.
+     *
+     * @param start the index of the first view to remove from the group
+     * @param count the number of views to remove from the group
+     */
+    protected void removeViewsInLayout(int start, int count) {
+        final int end = start + count;
+        if (start < 0 || count < 0 || end > mChildrenCount) {
+            throw new IndexOutOfBoundsException("start=" + start + " count=" + count
+                    + " childCount=" + mChildrenCount);
+        }
+        if (count == 0) {
+            return;
+        }
+        final View[] children = mChildren;
+        final boolean detach = mAttachInfo != null;
+        for (int i = start; i < end; i++) {
+            final View view = children[i];
+            removeTargets(view);
+            if (detach) {
+                view.dispatchDetachedFromWindow();
+            }
+            view.assignParent(null);
+        }
+        System.arraycopy(children, end, children, start, mChildrenCount - end);
+        for (int i = mChildrenCount - count; i < mChildrenCount; i++) {
+            children[i] = null;
+        }
+        mChildrenCount -= count;
+    }
+
+    // the removed child no longer receives events
+    private void removeTargets(@Nonnull View child) {
+        TouchTarget prevTouch = null;
+        for (TouchTarget target = mFirstTouchTarget; target != null; ) {
+            final TouchTarget next = target.next;
+            if (target.child == child) {
+                if (prevTouch == null) {
+                    mFirstTouchTarget = next;
+                } else {
+                    prevTouch.next = next;
+                }
+                target.recycle();
+            } else {
+                prevTouch = target;
+            }
+            target = next;
+        }
+        HoverTarget prevHover = null;
+        for (HoverTarget target = mFirstHoverTarget; target != null; ) {
+            final HoverTarget next = target.next;
+            if (target.child == child) {
+                if (prevHover == null) {
+                    mFirstHoverTarget = next;
+                } else {
+                    prevHover.next = next;
+                }
+                target.recycle();
+            } else {
+                prevHover = target;
+            }
+            target = next;
+        }
     }
 
     public View getChildAt(int index) {
@@ -800,9 +887,9 @@ public abstract class ViewGroup extends View implements ViewParent {
 
         final View[] children = mChildren;
         mChildrenCount = 0;
+        final boolean detach = mAttachInfo != null;
 
         /*final View focused = mFocused;
-        final boolean detach = mAttachInfo != null;
         boolean clearChildFocus = false;
 
         needGlobalAttributesUpdate(false);*/
@@ -838,6 +925,9 @@ public abstract class ViewGroup extends View implements ViewParent {
             dispatchViewRemoved(view);
 
             view.mParent = null;*/
+            if (detach) {
+                view.dispatchDetachedFromWindow();
+            }
             children[i] = null;
         }
 
@@ -1171,6 +1261,14 @@ public abstract class ViewGroup extends View implements ViewParent {
         }
     }
 
+    @Override
+    final void dispatchDetachedFromWindow() {
+        for (int i = 0; i < mChildrenCount; i++) {
+            mChildren[i].dispatchDetachedFromWindow();
+        }
+        super.dispatchDetachedFromWindow();
+    }
+
     @Override
     protected void tick(int ticks) {
         final View[] views = mChildren;
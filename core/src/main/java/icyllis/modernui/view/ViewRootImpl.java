@@ -21,13 +21,14 @@ package icyllis.modernui.view;
 import icyllis.modernui.ModernUI;
 import icyllis.modernui.annotation.UiThread;
 import icyllis.modernui.graphics.GLCanvas;
+import icyllis.modernui.math.Rect;
+import icyllis.modernui.platform.FrameProfiler;
 import icyllis.modernui.platform.RenderCore;
 import org.apache.logging.log4j.Marker;
 import org.apache.logging.log4j.MarkerManager;
 
 import javax.annotation.Nonnull;
 import javax.annotation.Nullable;
-import java.util.LinkedList;
 
 /**
  * The top of a view hierarchy, implementing the needed protocol between View and
@@ -44,16 +45,23 @@ public final class ViewRootImpl implements ViewParent {
     private final GLCanvas mCanvas;
     private final Handler mHandler;
 
-    private final LinkedList<InputEvent> mInputEvents = new LinkedList<>();
+    // a ring buffer of pending input events, guarded by the lock, events are enqueued
+    // from the main thread and processed on UI thread
+    private InputEvent[] mInputEvents = new InputEvent[16];
+    private int mInputHead;
+    private int mInputCount;
+    private final Object mInputLock = new Object();
 
     private boolean mTraversalScheduled;
     private boolean mWillDrawSoon;
     private boolean mIsDrawing;
-    private boolean mHasDrawn;
     private boolean mLayoutRequested;
     private boolean mInvalidated;
     private boolean mKeepInvalidated;
 
+    // the union of invalidated areas to draw
+    private final Rect mDirty = new Rect();
+
     private boolean hasDragOperation;
 
     private View mView;
@@ -156,57 +164,124 @@ public final class ViewRootImpl implements ViewParent {
         int height = mHeight;
         if (mLayoutRequested || width != host.getMeasuredWidth() || height != host.getMeasuredHeight()) {
             long startTime = RenderCore.timeNanos();
+            final long layoutStart = FrameProfiler.begin();
 
             int widthSpec = MeasureSpec.makeMeasureSpec(width, MeasureSpec.Mode.EXACTLY);
             int heightSpec = MeasureSpec.makeMeasureSpec(height, MeasureSpec.Mode.EXACTLY);
 
+            View.startMeasurePass();
             host.measure(widthSpec, heightSpec);
 
             host.layout(0, 0, host.getMeasuredWidth(), host.getMeasuredHeight());
+            FrameProfiler.end(FrameProfiler.UI_LAYOUT, layoutStart);
 
             ModernUI.LOGGER.info(MARKER, "Layout done in {} \u03bcs, window size: {}x{}",
                     (RenderCore.timeNanos() - startTime) / 1000.0f, width, height);
+            if (ModernUI.LOGGER.isDebugEnabled(MARKER)) {
+                ModernUI.LOGGER.debug(MARKER, "Layout pass called onMeasure() {} times", View.getMeasureTotal());
+            }
             mLayoutRequested = false;
+            mInvalidated = true;
+            mDirty.set(0, 0, width, height);
         }
 
         mWillDrawSoon = false;
 
-        //TODO
-        //if (mInvalidated) {
-        mIsDrawing = true;
-        mCanvas.reset(width, height);
-        host.draw(mCanvas);
-        mIsDrawing = false;
-        if (mKeepInvalidated) {
-            mKeepInvalidated = false;
-        } else {
-            mInvalidated = false;
+        // the last frame is kept if nothing changed, and unchanged views
+        // replay their render nodes rather than drawing again
+        if (mInvalidated) {
+            if (!mDirty.intersect(0, 0, width, height)) {
+                // invisible changes
+                mDirty.setEmpty();
+                mInvalidated = false;
+                return;
+            }
+            final long recordStart = FrameProfiler.begin();
+            mIsDrawing = true;
+            mCanvas.reset(width, height);
+            host.draw(mCanvas);
+            mIsDrawing = false;
+            FrameProfiler.end(FrameProfiler.UI_RECORD, recordStart);
+            // the render thread redraws only this region, the rest is kept from last frame
+            if (!mCanvas.submitFrame(mDirty)) {
+                // the render thread is busy, the frame is dropped, draw it again
+                mKeepInvalidated = false;
+                scheduleTraversal();
+            } else if (mKeepInvalidated) {
+                mKeepInvalidated = false;
+            } else {
+                mInvalidated = false;
+                mDirty.setEmpty();
+            }
         }
-        mHasDrawn = true;
-        //}
     }
 
+    /**
+     * Enqueues an input event, the event will be recycled after processing. Consecutive
+     * movements are batched into the last pending event, so that they will be dispatched
+     * only once in a frame, and others are kept as historical samples.
+     *
+     * @param event the event obtained from the pool
+     */
     public void enqueueInputEvent(@Nonnull InputEvent event) {
-        mInputEvents.add(event);
+        synchronized (mInputLock) {
+            if (mInputCount > 0 && event instanceof MotionEvent) {
+                final InputEvent last = mInputEvents[(mInputHead + mInputCount - 1) & (mInputEvents.length - 1)];
+                if (last instanceof MotionEvent && isBatchable((MotionEvent) event) &&
+                        ((MotionEvent) last).addBatch((MotionEvent) event)) {
+                    event.recycle();
+                    return;
+                }
+            }
+            if (mInputCount == mInputEvents.length) {
+                // grow, and unwrap the ring
+                final InputEvent[] queue = new InputEvent[mInputCount << 1];
+                final int n = mInputEvents.length - mInputHead;
+                System.arraycopy(mInputEvents, mInputHead, queue, 0, n);
+                System.arraycopy(mInputEvents, 0, queue, n, mInputHead);
+                mInputEvents = queue;
+                mInputHead = 0;
+            }
+            mInputEvents[(mInputHead + mInputCount) & (mInputEvents.length - 1)] = event;
+            mInputCount++;
+        }
+    }
+
+    private static boolean isBatchable(@Nonnull MotionEvent event) {
+        final int action = event.getActionMasked();
+        return action == MotionEvent.ACTION_MOVE || action == MotionEvent.ACTION_HOVER_MOVE;
+    }
+
+    @Nullable
+    private InputEvent pollInputEvent() {
+        synchronized (mInputLock) {
+            if (mInputCount == 0) {
+                return null;
+            }
+            final InputEvent event = mInputEvents[mInputHead];
+            mInputEvents[mInputHead] = null;
+            mInputHead = (mInputHead + 1) & (mInputEvents.length - 1);
+            mInputCount--;
+            return event;
+        }
     }
 
     public void doProcessInputEvents() {
         checkThread();
-        if (mView != null) {
-            InputEvent event;
-            while ((event = mInputEvents.poll()) != null) {
-                try {
-                    if (event instanceof KeyEvent) {
-                        processKeyEvent((KeyEvent) event);
-                    } else {
-                        processPointerEvent((MotionEvent) event);
-                    }
-                } finally {
-                    event.recycle();
+        InputEvent event;
+        while ((event = pollInputEvent()) != null) {
+            try {
+                if (mView == null) {
+                    continue;
+                }
+                if (event instanceof KeyEvent) {
+                    processKeyEvent((KeyEvent) event);
+                } else {
+                    processPointerEvent((MotionEvent) event);
                 }
+            } finally {
+                event.recycle();
             }
-        } else {
-            mInputEvents.clear();
         }
     }
 
@@ -242,12 +317,6 @@ public final class ViewRootImpl implements ViewParent {
         }
     }*/
 
-    public boolean isReadyForRendering() {
-        boolean b = mHasDrawn;
-        mHasDrawn = false;
-        return b;
-    }
-
     void performDragEvent(DragEvent event) {
         if (hasDragOperation) {
 
@@ -260,8 +329,21 @@ public final class ViewRootImpl implements ViewParent {
         }
     }
 
+    // invalidate the whole window
     void invalidate() {
         checkThread();
+        mDirty.set(0, 0, mWidth, mHeight);
+        scheduleDraw();
+    }
+
+    // invalidate an area in pixels relative to the window
+    void invalidate(@Nonnull Rect dirty) {
+        checkThread();
+        mDirty.union(dirty);
+        scheduleDraw();
+    }
+
+    private void scheduleDraw() {
         mInvalidated = true;
         if (!mWillDrawSoon) {
             if (mIsDrawing) {
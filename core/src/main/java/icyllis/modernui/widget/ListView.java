@@ -0,0 +1,698 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.widget;
+
+import icyllis.modernui.graphics.Canvas;
+import icyllis.modernui.graphics.Paint;
+import icyllis.modernui.graphics.drawable.Drawable;
+import icyllis.modernui.math.Rect;
+import icyllis.modernui.util.Pool;
+import icyllis.modernui.util.Pools;
+import icyllis.modernui.view.MeasureSpec;
+import icyllis.modernui.view.MotionEvent;
+import icyllis.modernui.view.View;
+import icyllis.modernui.view.ViewConfig;
+import icyllis.modernui.view.ViewGroup;
+import it.unimi.dsi.fastutil.ints.Int2ObjectOpenHashMap;
+import it.unimi.dsi.fastutil.longs.Long2IntOpenHashMap;
+
+import javax.annotation.Nonnull;
+import javax.annotation.Nullable;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+/**
+ * A view group that shows a large collection of items in a vertically scrolling list,
+ * or a grid if the column count is greater than 1. The items are provided by an
+ * {@link Adapter}.
+ * <p>
+ * Only the items in the visible rows and in a few rows around them (the prefetch window)
+ * have views. When an item leaves the window, its view is removed and put into the pool
+ * of its view type, then it will be bound to another item of the same type, so the number
+ * of views doesn't depend on the number of items.
+ * <p>
+ * All rows have the same height, which is either specified by {@link #setRowHeight(int)}
+ * or measured from the first item, so the scroll range is known without measuring every
+ * item. If the adapter has stable IDs, views stay with their items through
+ * {@link Adapter#notifyDataSetChanged()}, only new items are bound and only moved items
+ * are laid out again.
+ */
+public class ListView extends ViewGroup {
+
+    /**
+     * The ID of items if the adapter has no stable IDs.
+     */
+    public static final long NO_ID = -1;
+
+    private static final int DEFAULT_PREFETCH_ROWS = 2;
+    private static final int RECYCLE_POOL_SIZE = 16;
+
+    private final Scroller mScroller = new Scroller();
+
+    @Nullable
+    private Adapter mAdapter;
+
+    private int mColumnCount = 1;
+    private int mPrefetchRows = DEFAULT_PREFETCH_ROWS;
+
+    // specified by user, or 0 to measure the first item
+    private int mFixedRowHeight;
+    // the row height in use, or -1 if not measured yet
+    private int mRowHeight = -1;
+
+    private int mPendingScrollPosition = -1;
+
+    // view type to recycled views
+    private final Int2ObjectOpenHashMap<Pool<View>> mRecyclePools = new Int2ObjectOpenHashMap<>();
+
+    // the items that have views, [first, end)
+    private int mFirstPosition;
+    private int mEndPosition;
+
+    private boolean mDataSetChanged;
+    private boolean mInFill;
+
+    // temp storage of fill()
+    private View[] mActiveViews = new View[0];
+    private final Long2IntOpenHashMap mIdToPosition = new Long2IntOpenHashMap();
+
+    public ListView() {
+        mIdToPosition.defaultReturnValue(-1);
+        setVerticalScrollBarEnabled(true);
+        setVerticalScrollbarThumbDrawable(new Drawable() {
+            private int alpha = 255;
+
+            @Override
+            public void draw(@Nonnull Canvas canvas) {
+                Paint paint = Paint.take();
+                paint.setRGBA(84, 190, 196, (int) (alpha * 0.5));
+                Rect bounds = getBounds();
+                canvas.drawRoundRect(bounds.left, bounds.top + 1, bounds.right - 1, bounds.bottom - 1, bounds.width() / 2f - 0.5f, paint);
+            }
+
+            @Override
+            public void setAlpha(int alpha) {
+                this.alpha = alpha;
+            }
+        });
+    }
+
+    /**
+     * Sets the adapter that provides the items, the views of the previous adapter
+     * are discarded.
+     *
+     * @param adapter the new adapter, or null to clear the list
+     */
+    public void setAdapter(@Nullable Adapter adapter) {
+        if (mAdapter == adapter) {
+            return;
+        }
+        if (mAdapter != null) {
+            mAdapter.mObservers.remove(this);
+            for (int i = 0, count = getChildCount(); i < count; i++) {
+                mAdapter.onViewRecycled(getChildAt(i));
+            }
+        }
+        removeViewsInLayout(0, getChildCount());
+        // view types are defined by the adapter
+        mRecyclePools.clear();
+        mAdapter = adapter;
+        if (adapter != null) {
+            adapter.mObservers.add(this);
+        }
+        mScroller.forceFinished(true);
+        mScrollY = 0;
+        mRowHeight = -1;
+        mFirstPosition = mEndPosition = 0;
+        mDataSetChanged = true;
+        requestLayout();
+        invalidate();
+    }
+
+    @Nullable
+    public Adapter getAdapter() {
+        return mAdapter;
+    }
+
+    /**
+     * Sets the number of columns, the list becomes a grid if it's greater than 1.
+     * Items are placed from left to right, then top to bottom.
+     *
+     * @param columnCount the number of columns, at least 1
+     */
+    public void setColumnCount(int columnCount) {
+        columnCount = Math.max(1, columnCount);
+        if (mColumnCount != columnCount) {
+            mColumnCount = columnCount;
+            mRowHeight = -1;
+            requestLayout();
+        }
+    }
+
+    public int getColumnCount() {
+        return mColumnCount;
+    }
+
+    /**
+     * Sets the height of all rows, the items will be measured with exactly this height.
+     *
+     * @param rowHeight the row height in pixels, or 0 to use the height of the first item
+     */
+    public void setRowHeight(int rowHeight) {
+        rowHeight = Math.max(0, rowHeight);
+        if (mFixedRowHeight != rowHeight) {
+            mFixedRowHeight = rowHeight;
+            mRowHeight = -1;
+            requestLayout();
+        }
+    }
+
+    /**
+     * Sets the number of rows above and below the visible rows that are bound ahead,
+     * so that views are ready before they are scrolled into view.
+     *
+     * @param prefetchRows the number of rows on each side, default is 2
+     */
+    public void setPrefetchRows(int prefetchRows) {
+        prefetchRows = Math.max(0, prefetchRows);
+        if (mPrefetchRows != prefetchRows) {
+            mPrefetchRows = prefetchRows;
+            requestLayout();
+        }
+    }
+
+    /**
+     * Returns the adapter position of the item bound to a child view.
+     *
+     * @param child a child view of this list
+     * @return the position, or -1 if the view is not a bound item of this list
+     */
+    public int getPositionForView(@Nonnull View child) {
+        if (child.getParent() == this) {
+            return ((LayoutParams) child.getLayoutParams()).mPosition;
+        }
+        return -1;
+    }
+
+    /**
+     * Returns the position of the first item in the visible rows.
+     */
+    public int getFirstVisiblePosition() {
+        if (mRowHeight <= 0) {
+            return 0;
+        }
+        return mScrollY / mRowHeight * mColumnCount;
+    }
+
+    /**
+     * Scrolls the list immediately to make the row of the item at top.
+     *
+     * @param position the adapter position
+     */
+    public void scrollToPosition(int position) {
+        mScroller.forceFinished(true);
+        if (mRowHeight < 0 || mDataSetChanged) {
+            mPendingScrollPosition = position;
+            requestLayout();
+            return;
+        }
+        mScrollY = Math.min(position / mColumnCount * mRowHeight, getMaxScrollY());
+        fill();
+        awakenScrollBars();
+        invalidate();
+    }
+
+    /**
+     * Scrolls the list smoothly to make the row of the item at top.
+     *
+     * @param position the adapter position
+     */
+    public void smoothScrollToPosition(int position) {
+        if (mRowHeight < 0 || mDataSetChanged) {
+            scrollToPosition(position);
+            return;
+        }
+        final int y = Math.min(position / mColumnCount * mRowHeight, getMaxScrollY());
+        mScroller.startScroll(mScrollX, mScrollY, 0, y - mScrollY);
+        invalidate();
+    }
+
+    @Override
+    public void addView(@Nonnull View child, int index, @Nonnull ViewGroup.LayoutParams params) {
+        throw new UnsupportedOperationException("Views of ListView are provided by its adapter");
+    }
+
+    @Override
+    public void requestLayout() {
+        // binding items may request layout, they are measured right after that
+        if (!mInFill) {
+            super.requestLayout();
+        }
+    }
+
+    @Override
+    protected void onMeasure(int widthMeasureSpec, int heightMeasureSpec) {
+        // the content is virtual, so fill the space given by parent
+        setMeasuredDimension(getDefaultSize(getMinimumWidth(), widthMeasureSpec),
+                getDefaultSize(getMinimumHeight(), heightMeasureSpec));
+    }
+
+    @Override
+    protected void onSizeChanged(int width, int height, int prevWidth, int prevHeight) {
+        super.onSizeChanged(width, height, prevWidth, prevHeight);
+        if (width != prevWidth) {
+            mRowHeight = -1;
+        }
+    }
+
+    @Override
+    protected void onLayout(boolean changed, int left, int top, int right, int bottom) {
+        fill();
+    }
+
+    /**
+     * Makes the items in the prefetch window have views, recycles the others,
+     * then binds, measures and lays out the views if needed.
+     */
+    private void fill() {
+        final Adapter adapter = mAdapter;
+        final int itemCount = adapter == null ? 0 : adapter.getItemCount();
+        mInFill = true;
+        try {
+            if (itemCount == 0) {
+                for (int i = getChildCount() - 1; i >= 0; i--) {
+                    final View child = getChildAt(i);
+                    removeViewsInLayout(i, 1);
+                    recycleView(child);
+                }
+                mScrollY = 0;
+                mFirstPosition = mEndPosition = 0;
+                mPendingScrollPosition = -1;
+                mDataSetChanged = false;
+                return;
+            }
+            final int columnCount = mColumnCount;
+            final int columnWidth = getWidth() / columnCount;
+            if (mRowHeight < 0) {
+                mRowHeight = mFixedRowHeight > 0 ? mFixedRowHeight : measureRowHeight(adapter, columnWidth);
+            }
+            final int rowHeight = Math.max(1, mRowHeight);
+            if (mPendingScrollPosition >= 0) {
+                mScrollY = mPendingScrollPosition / columnCount * rowHeight;
+                mPendingScrollPosition = -1;
+            }
+            mScrollY = Math.max(0, Math.min(mScrollY, getMaxScrollY()));
+
+            final int first = computeFirstPosition(rowHeight);
+            final int end = computeEndPosition(itemCount, rowHeight);
+
+            if (mActiveViews.length < end - first) {
+                mActiveViews = new View[end - first];
+            }
+            final View[] active = mActiveViews;
+            final boolean dataSetChanged = mDataSetChanged;
+            final boolean stableIds = adapter.hasStableIds();
+            if (dataSetChanged && stableIds) {
+                mIdToPosition.clear();
+                for (int position = first; position < end; position++) {
+                    mIdToPosition.put(adapter.getItemId(position), position);
+                }
+            }
+
+            // keep the views whose items are still in the window
+            for (int i = getChildCount() - 1; i >= 0; i--) {
+                final View child = getChildAt(i);
+                final LayoutParams lp = (LayoutParams) child.getLayoutParams();
+                int position = lp.mPosition;
+                if (dataSetChanged) {
+                    if (stableIds) {
+                        position = mIdToPosition.get(lp.mItemId);
+                    } else {
+                        // the item may be different, rebind it
+                        lp.mBound = false;
+                    }
+                    if (position >= first && position < end &&
+                            adapter.getItemViewType(position) != lp.mViewType) {
+                        position = -1;
+                    }
+                }
+                if (position >= first && position < end && active[position - first] == null) {
+                    active[position - first] = child;
+                    lp.mPosition = position;
+                } else {
+                    removeViewsInLayout(i, 1);
+                    recycleView(child);
+                }
+            }
+
+            for (int position = first; position < end; position++) {
+                View child = active[position - first];
+                if (child == null) {
+                    child = obtainView(adapter, position);
+                }
+                final LayoutParams lp = (LayoutParams) child.getLayoutParams();
+                if (!lp.mBound) {
+                    lp.mItemId = stableIds ? adapter.getItemId(position) : NO_ID;
+                    adapter.onBindView(child, position);
+                    lp.mBound = true;
+                }
+                // these do nothing if the view has not changed
+                measureItem(child, columnWidth);
+                final int childLeft = position % columnCount * columnWidth;
+                final int childTop = position / columnCount * rowHeight;
+                child.layout(childLeft, childTop,
+                        childLeft + child.getMeasuredWidth(), childTop + child.getMeasuredHeight());
+            }
+            Arrays.fill(active, 0, end - first, null);
+
+            mFirstPosition = first;
+            mEndPosition = end;
+            mDataSetChanged = false;
+        } finally {
+            mInFill = false;
+        }
+    }
+
+    private int measureRowHeight(@Nonnull Adapter adapter, int columnWidth) {
+        final View view = obtainView(adapter, 0);
+        adapter.onBindView(view, 0);
+        measureItem(view, columnWidth);
+        final int height = view.getMeasuredHeight();
+        removeViewsInLayout(getChildCount() - 1, 1);
+        recycleView(view);
+        return height;
+    }
+
+    private void measureItem(@Nonnull View child, int columnWidth) {
+        final ViewGroup.LayoutParams lp = child.getLayoutParams();
+        final int widthSpec = getChildMeasureSpec(
+                MeasureSpec.makeMeasureSpec(columnWidth, MeasureSpec.Mode.EXACTLY), 0, lp.width);
+        final int heightSpec = getChildMeasureSpec(mFixedRowHeight > 0 ?
+                MeasureSpec.makeMeasureSpec(mFixedRowHeight, MeasureSpec.Mode.EXACTLY) :
+                MeasureSpec.makeMeasureSpec(0, MeasureSpec.Mode.UNSPECIFIED), 0, lp.height);
+        child.measure(widthSpec, heightSpec);
+    }
+
+    // get a view from the pool or the adapter, and add it as the last child
+    @Nonnull
+    private View obtainView(@Nonnull Adapter adapter, int position) {
+        final int viewType = adapter.getItemViewType(position);
+        final Pool<View> pool = mRecyclePools.get(viewType);
+        View view = pool != null ? pool.acquire() : null;
+        if (view == null) {
+            view = adapter.onCreateView(this, viewType);
+        }
+        final ViewGroup.LayoutParams params = view.getLayoutParams();
+        final LayoutParams lp;
+        if (params instanceof LayoutParams) {
+            lp = (LayoutParams) params;
+        } else if (params != null) {
+            lp = new LayoutParams(params);
+        } else {
+            lp = createDefaultLayoutParams();
+        }
+        lp.mViewType = viewType;
+        lp.mPosition = position;
+        lp.mBound = false;
+        if (!addViewInLayout(view, -1, lp)) {
+            throw new IllegalStateException("The view created by adapter has already a parent");
+        }
+        return view;
+    }
+
+    private void recycleView(@Nonnull View view) {
+        if (mAdapter != null) {
+            mAdapter.onViewRecycled(view);
+        }
+        final LayoutParams lp = (LayoutParams) view.getLayoutParams();
+        lp.mPosition = -1;
+        lp.mItemId = NO_ID;
+        lp.mBound = false;
+        Pool<View> pool = mRecyclePools.get(lp.mViewType);
+        if (pool == null) {
+            pool = Pools.simple(RECYCLE_POOL_SIZE);
+            mRecyclePools.put(lp.mViewType, pool);
+        }
+        // drop the view if the pool is full
+        pool.release(view);
+    }
+
+    // the first position to lay out at the current scroll, including prefetched rows
+    private int computeFirstPosition(int rowHeight) {
+        return Math.max(0, mScrollY / rowHeight - mPrefetchRows) * mColumnCount;
+    }
+
+    // the end position (exclusive) to lay out at the current scroll, including prefetched rows
+    private int computeEndPosition(int itemCount, int rowHeight) {
+        final int rowCount = (itemCount + mColumnCount - 1) / mColumnCount;
+        final int lastRow = Math.min(rowCount - 1, (mScrollY + getHeight()) / rowHeight + mPrefetchRows);
+        return Math.min(itemCount, (lastRow + 1) * mColumnCount);
+    }
+
+    private int getMaxScrollY() {
+        if (mAdapter == null || mRowHeight <= 0) {
+            return 0;
+        }
+        final int rowCount = (mAdapter.getItemCount() + mColumnCount - 1) / mColumnCount;
+        return Math.max(0, rowCount * mRowHeight - getHeight());
+    }
+
+    void onDataSetChanged() {
+        mDataSetChanged = true;
+        requestLayout();
+        invalidate();
+    }
+
+    void onItemChanged(int position) {
+        if (position < mFirstPosition || position >= mEndPosition) {
+            // the item has no view
+            return;
+        }
+        for (int i = 0, count = getChildCount(); i < count; i++) {
+            final LayoutParams lp = (LayoutParams) getChildAt(i).getLayoutParams();
+            if (lp.mPosition == position) {
+                lp.mBound = false;
+                requestLayout();
+                invalidate();
+                break;
+            }
+        }
+    }
+
+    @Override
+    public void computeScroll() {
+        if (mScroller.computeScrollOffset()) {
+            mScrollY = mScroller.getCurrY();
+            awakenScrollBars();
+            if (mAdapter != null && mRowHeight > 0 && !mDataSetChanged) {
+                final int rowHeight = mRowHeight;
+                // we are in the draw pass, update the views before they are drawn,
+                // if the rows at either edge are not laid out
+                if (computeFirstPosition(rowHeight) < mFirstPosition ||
+                        computeEndPosition(mAdapter.getItemCount(), rowHeight) > mEndPosition) {
+                    fill();
+                }
+            }
+        }
+    }
+
+    @Override
+    protected int computeVerticalScrollRange() {
+        if (mAdapter == null || mRowHeight <= 0) {
+            return getHeight();
+        }
+        return getMaxScrollY() + getHeight();
+    }
+
+    @Override
+    protected int computeVerticalScrollOffset() {
+        return Math.max(0, super.computeVerticalScrollOffset());
+    }
+
+    @Override
+    public boolean onGenericMotionEvent(MotionEvent event) {
+        if (event.getAction() == MotionEvent.ACTION_SCROLL) {
+            float delta = event.getAxisValue(MotionEvent.AXIS_VSCROLL);
+            final int maxY = getMaxScrollY();
+            final int scrollY = mScrollY;
+            int dy = Math.round(delta * -60.0f * ViewConfig.get().getViewScale());
+            // the final position is stale if the scroller was stopped
+            final int finalY = mScroller.isFinished() ? scrollY : mScroller.getFinalY();
+            dy = Math.max(0, Math.min(finalY + dy, maxY)) - scrollY;
+            mScroller.startScroll(mScrollX, scrollY, 0, dy);
+            invalidate();
+            return dy != 0;
+        }
+        return super.onGenericMotionEvent(event);
+    }
+
+    @Nonnull
+    @Override
+    protected LayoutParams convertLayoutParams(@Nonnull ViewGroup.LayoutParams params) {
+        if (params instanceof LayoutParams) {
+            return (LayoutParams) params;
+        }
+        return new LayoutParams(params);
+    }
+
+    @Nonnull
+    @Override
+    protected LayoutParams createDefaultLayoutParams() {
+        return new LayoutParams(LayoutParams.MATCH_PARENT, LayoutParams.WRAP_CONTENT);
+    }
+
+    @Override
+    protected boolean checkLayoutParams(@Nullable ViewGroup.LayoutParams params) {
+        return params instanceof LayoutParams;
+    }
+
+    /**
+     * Layout params of item views, also track the item bound to the view.
+     */
+    public static class LayoutParams extends ViewGroup.LayoutParams {
+
+        int mPosition = -1;
+        int mViewType;
+        long mItemId = NO_ID;
+        boolean mBound;
+
+        /**
+         * Creates a new set of layout parameters with the specified width
+         * and height.
+         *
+         * @param width  either {@link #WRAP_CONTENT},
+         *               {@link #MATCH_PARENT}, or a fixed value
+         * @param height either {@link #WRAP_CONTENT},
+         *               {@link #MATCH_PARENT}, or a fixed value
+         */
+        public LayoutParams(int width, int height) {
+            super(width, height);
+        }
+
+        /**
+         * Copies the width and height of the source, the item is not copied.
+         *
+         * @param source the layout params to copy from.
+         */
+        public LayoutParams(@Nonnull ViewGroup.LayoutParams source) {
+            super(source);
+        }
+
+        @Nonnull
+        @Override
+        public LayoutParams copy() {
+            return new LayoutParams(this);
+        }
+    }
+
+    /**
+     * Provides the items of a {@link ListView}. An adapter creates views for each
+     * view type and binds items to them, views are reused for other items of the same
+     * view type, so binding must reset everything that depends on the item.
+     */
+    public static abstract class Adapter {
+
+        private final List<ListView> mObservers = new ArrayList<>(1);
+
+        /**
+         * Returns the number of items.
+         */
+        public abstract int getItemCount();
+
+        /**
+         * Returns the view type of the item, views are only reused for the items of
+         * the same view type.
+         *
+         * @param position the adapter position
+         * @return the view type, default is 0
+         */
+        public int getItemViewType(int position) {
+            return 0;
+        }
+
+        /**
+         * Creates a new view for the view type, the view should have no parent.
+         *
+         * @param parent   the list to add the view to
+         * @param viewType the view type
+         * @return the new view
+         */
+        @Nonnull
+        public abstract View onCreateView(@Nonnull ListView parent, int viewType);
+
+        /**
+         * Binds the item at the position to a view of its view type.
+         *
+         * @param view     the view created by {@link #onCreateView(ListView, int)}
+         * @param position the adapter position
+         */
+        public abstract void onBindView(@Nonnull View view, int position);
+
+        /**
+         * Called when a view no longer shows an item, such as to release resources.
+         *
+         * @param view the view to be recycled
+         */
+        public void onViewRecycled(@Nonnull View view) {
+        }
+
+        /**
+         * Returns whether {@link #getItemId(int)} is unique for each item and doesn't
+         * change when the items are added, removed or moved.
+         *
+         * @return true if the adapter has stable IDs, default is false
+         */
+        public boolean hasStableIds() {
+            return false;
+        }
+
+        /**
+         * Returns the stable ID of the item, used only if {@link #hasStableIds()}.
+         *
+         * @param position the adapter position
+         * @return the ID of the item
+         */
+        public long getItemId(int position) {
+            return NO_ID;
+        }
+
+        /**
+         * Notifies that the items have changed. With stable IDs, the views of the items
+         * that still exist are moved to their new positions without binding, otherwise
+         * all views are bound again.
+         */
+        public final void notifyDataSetChanged() {
+            for (ListView list : mObservers) {
+                list.onDataSetChanged();
+            }
+        }
+
+        /**
+         * Notifies that the data of an item has changed, its view will be bound again.
+         *
+         * @param position the adapter position
+         */
+        public final void notifyItemChanged(int position) {
+            for (ListView list : mObservers) {
+                list.onItemChanged(position);
+            }
+        }
+    }
+}
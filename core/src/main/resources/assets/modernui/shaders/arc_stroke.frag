@@ -2,36 +2,32 @@
 
 precision mediump float;
 
-layout(std140, binding = 3) uniform PaintBlock {
-    vec4 u_Radius;
-    vec2 u_CenterPos;
-    vec2 u_Angle;
-};
-
 smooth in vec2 f_Position;
 smooth in vec4 f_Color;
+flat in vec4 f_Paint0; // radius
+flat in vec4 f_Paint1; // center, angle
 
 layout(location = 0) out vec4 fragColor;
 
 void main() {
-    vec2 dir = f_Position - u_CenterPos;
+    vec2 dir = f_Position - f_Paint1.xy;
 
     // smoothing normal direction
-    float d1 = abs(length(dir) - u_Radius.x) - u_Radius.z;
-    float a1 = smoothstep(-u_Radius.y, 0.0, d1);
+    float d1 = abs(length(dir) - f_Paint0.x) - f_Paint0.z;
+    float a1 = smoothstep(-f_Paint0.y, 0.0, d1);
 
     // angle (0,360) in degrees
-    float c = cos(u_Angle.y * 0.00872664626);
+    float c = cos(f_Paint1.w * 0.00872664626);
 
     // direction vector from the circle origin to the middle of the arc
-    float f = u_Angle.x * 0.01745329252;
+    float f = f_Paint1.z * 0.01745329252;
     vec2 up = vec2(cos(f), sin(f));
 
     // smoothing tangent direction
     float d2 = dot(up, normalize(dir)) - c;
 
     // proportional to how much `d2` changes between pixels
-    float w = u_Radius.y * fwidth(d2);
+    float w = f_Paint0.y * fwidth(d2);
     float a2 = smoothstep(w * -0.5, w * 0.5, d2);
 
     // mix alpha value
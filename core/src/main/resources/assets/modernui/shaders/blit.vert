@@ -0,0 +1,12 @@
+#version 450 core
+
+smooth out vec2 f_TexCoord;
+
+void main() {
+    // a triangle covering the viewport, no vertex buffer is needed
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+    f_TexCoord = pos;
+
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -2,20 +2,17 @@
 
 precision mediump float;
 
-layout(std140, binding = 2) uniform PaintBlock {
-    vec4 u_Radius;
-    vec2 u_CenterPos;
-};
-
 smooth in vec2 f_Position;
 smooth in vec4 f_Color;
+flat in vec4 f_Paint0; // radius
+flat in vec4 f_Paint1; // center
 
 layout(location = 0) out vec4 fragColor;
 
 void main() {
-    float v = length(f_Position - u_CenterPos);
+    float v = length(f_Position - f_Paint1.xy);
 
-    float a = 1.0 - smoothstep(u_Radius.x - u_Radius.y, u_Radius.x, v);
+    float a = 1.0 - smoothstep(f_Paint0.x - f_Paint0.y, f_Paint0.x, v);
 
     fragColor = f_Color * vec4(1.0, 1.0, 1.0, a);
 }
\ No newline at end of file
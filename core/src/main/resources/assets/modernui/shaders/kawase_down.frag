@@ -0,0 +1,22 @@
+#version 450 core
+
+precision mediump float;
+
+layout(location = 0) uniform sampler2D u_Sampler;
+// half texel size of the source texture
+layout(location = 1) uniform vec2 u_HalfTexel;
+layout(location = 2) uniform float u_Offset;
+
+smooth in vec2 f_TexCoord;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    vec2 d = u_HalfTexel * u_Offset;
+    vec4 sum = texture(u_Sampler, f_TexCoord) * 4.0;
+    sum += texture(u_Sampler, f_TexCoord - d);
+    sum += texture(u_Sampler, f_TexCoord + d);
+    sum += texture(u_Sampler, f_TexCoord + vec2(d.x, -d.y));
+    sum += texture(u_Sampler, f_TexCoord - vec2(d.x, -d.y));
+    fragColor = sum / 8.0;
+}
@@ -0,0 +1,27 @@
+#version 450 core
+
+precision mediump float;
+
+layout(location = 0) uniform sampler2D u_Sampler;
+// half texel size of the source texture
+layout(location = 1) uniform vec2 u_HalfTexel;
+layout(location = 2) uniform float u_Offset;
+// the alpha of the output, used when compositing
+layout(location = 3) uniform float u_Alpha;
+
+smooth in vec2 f_TexCoord;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    vec2 d = u_HalfTexel * u_Offset;
+    vec4 sum = texture(u_Sampler, f_TexCoord + vec2(-d.x * 2.0, 0.0));
+    sum += texture(u_Sampler, f_TexCoord + vec2(-d.x, d.y)) * 2.0;
+    sum += texture(u_Sampler, f_TexCoord + vec2(0.0, d.y * 2.0));
+    sum += texture(u_Sampler, f_TexCoord + vec2(d.x, d.y)) * 2.0;
+    sum += texture(u_Sampler, f_TexCoord + vec2(d.x * 2.0, 0.0));
+    sum += texture(u_Sampler, f_TexCoord + vec2(d.x, -d.y)) * 2.0;
+    sum += texture(u_Sampler, f_TexCoord + vec2(0.0, -d.y * 2.0));
+    sum += texture(u_Sampler, f_TexCoord + vec2(-d.x, -d.y)) * 2.0;
+    fragColor = vec4((sum / 12.0).rgb, u_Alpha);
+}
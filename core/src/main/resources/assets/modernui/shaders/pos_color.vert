@@ -4,16 +4,26 @@ layout(std140, binding = 0) uniform MatrixBlock {
     mat4 u_Projection;
 };
 
-layout(location = 0) in vec2 a_Pos;
-layout(location = 1) in vec4 a_Color;
-layout(location = 2) in mat4 a_ModelView;
+// per-instance, each instance is a quad drawn as triangle strip
+layout(location = 0) in vec4 a_Bounds;
+layout(location = 1) in mat4 a_Color;
+layout(location = 5) in mat2x4 a_Paint;
+layout(location = 7) in mat4 a_ModelView;
 
 smooth out vec2 f_Position;
 smooth out vec4 f_Color;
+flat out vec4 f_Paint0;
+flat out vec4 f_Paint1;
 
 void main() {
-    f_Position = a_Pos;
-    f_Color = a_Color;
+    // CCW, left-bottom, right-bottom, left-top, right-top
+    vec2 pos = vec2((gl_VertexID & 1) == 0 ? a_Bounds.x : a_Bounds.z,
+                    (gl_VertexID & 2) == 0 ? a_Bounds.w : a_Bounds.y);
 
-    gl_Position = u_Projection * a_ModelView * vec4(a_Pos, 0.0, 1.0);
-}
\ No newline at end of file
+    f_Position = pos;
+    f_Color = a_Color[gl_VertexID];
+    f_Paint0 = a_Paint[0];
+    f_Paint1 = a_Paint[1];
+
+    gl_Position = u_Projection * a_ModelView * vec4(pos, 0.0, 1.0);
+}
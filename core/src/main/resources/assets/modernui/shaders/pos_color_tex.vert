@@ -4,19 +4,30 @@ layout(std140, binding = 0) uniform MatrixBlock {
     mat4 u_Projection;
 };
 
-layout(location = 0) in vec2 a_Pos;
-layout(location = 1) in vec4 a_Color;
-layout(location = 2) in vec2 a_UV;
-layout(location = 3) in mat4 a_ModelView;
+// per-instance, each instance is a quad drawn as triangle strip
+layout(location = 0) in vec4 a_Bounds;
+layout(location = 1) in mat4 a_Color;
+layout(location = 5) in vec4 a_UV;
+layout(location = 6) in mat2x4 a_Paint;
+layout(location = 8) in mat4 a_ModelView;
 
 smooth out vec2 f_Position;
 smooth out vec4 f_Color;
 smooth out vec2 f_TexCoord;
+flat out vec4 f_Paint0;
+flat out vec4 f_Paint1;
 
 void main() {
-    f_Position = a_Pos;
-    f_Color = a_Color;
-    f_TexCoord = a_UV;
+    // CCW, left-bottom, right-bottom, left-top, right-top
+    bool right = (gl_VertexID & 1) != 0;
+    bool top = (gl_VertexID & 2) != 0;
+    vec2 pos = vec2(right ? a_Bounds.z : a_Bounds.x, top ? a_Bounds.y : a_Bounds.w);
 
-    gl_Position = u_Projection * a_ModelView * vec4(a_Pos, 0.0, 1.0);
-}
\ No newline at end of file
+    f_Position = pos;
+    f_Color = a_Color[gl_VertexID];
+    f_TexCoord = vec2(right ? a_UV.z : a_UV.x, top ? a_UV.y : a_UV.w);
+    f_Paint0 = a_Paint[0];
+    f_Paint1 = a_Paint[1];
+
+    gl_Position = u_Projection * a_ModelView * vec4(pos, 0.0, 1.0);
+}
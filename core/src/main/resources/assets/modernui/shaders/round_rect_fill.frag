@@ -2,25 +2,22 @@
 
 precision mediump float;
 
-layout(std140, binding = 1) uniform PaintBlock {
-    vec4 u_InnerRect;
-    vec3 u_Radius;
-};
-
 smooth in vec2 f_Position;
 smooth in vec4 f_Color;
+flat in vec4 f_Paint0; // inner rect
+flat in vec4 f_Paint1; // radius, smooth, half stroke
 
 layout(location = 0) out vec4 fragColor;
 
 void main() {
-    vec2 tl = u_InnerRect.xy - f_Position;
-    vec2 br = f_Position - u_InnerRect.zw;
+    vec2 tl = f_Paint0.xy - f_Position;
+    vec2 br = f_Position - f_Paint0.zw;
 
     vec2 dis = max(br, tl);
 
-    float v = length(max(vec2(0.0), dis)) - u_Radius.x;
+    float v = length(max(vec2(0.0), dis)) - f_Paint1.x;
 
-    float a = 1.0 - smoothstep(-u_Radius.y, 0.0, v);
+    float a = 1.0 - smoothstep(-f_Paint1.y, 0.0, v);
 
     fragColor = f_Color * vec4(1.0, 1.0, 1.0, a);
 }
\ No newline at end of file
@@ -164,6 +164,7 @@ public final class Config {
         private final ForgeConfigSpec.ConfigValue<String> tooltipColor;
         private final ForgeConfigSpec.BooleanValue ding;
         private final ForgeConfigSpec.BooleanValue hudBars;
+        private final ForgeConfigSpec.BooleanValue showDirtyRegions;
 
         private final ForgeConfigSpec.ConfigValue<List<? extends String>> blurBlacklist;
 
@@ -177,6 +178,7 @@ public final class Config {
         private final ForgeConfigSpec.IntValue mipmapLevel;
         //private final ForgeConfigSpec.IntValue resolutionLevel;
         private final ForgeConfigSpec.IntValue defaultFontSize;
+        private final ForgeConfigSpec.BooleanValue foldDigits;
 
         private Client(@Nonnull ForgeConfigSpec.Builder builder) {
             builder.comment("Screen Config")
@@ -228,6 +230,9 @@ public final class Config {
             hudBars = builder.comment(
                     "Show additional HUD bars added by ModernUI on the bottom-left of the screen.")
                     .define("hudBars", false);
+            showDirtyRegions = builder.comment(
+                    "Flash the regions of Modern UI screens that are redrawn each frame, for debugging.")
+                    .define("showDirtyRegions", false);
 
             builder.pop();
 
@@ -266,6 +271,10 @@ public final class Config {
             defaultFontSize = builder.comment(
                     "The default font size for texts with no size specified. (deprecated, to be removed)")
                     .defineInRange("defaultFontSize", 16, 12, 20);
+            foldDigits = builder.comment(
+                    "Reuse text layouts of strings that differ only in their digits, such as coordinates and counters.",
+                    "All digits will be drawn with the same width, setting to false can make proportional digits.")
+                    .define("foldDigits", true);
 
             builder.pop();
 
@@ -289,6 +298,7 @@ public final class Config {
                 ModernUI.LOGGER.error(ModernUI.MARKER, "Wrong color format for setting tooltip color: {}", tooltipColor, e);
             }
             UIManager.sPlaySoundOnLoaded = ding.get();
+            UIManager.sShowDirtyRegions = showDirtyRegions.get();
             //TestHUD.sBars = hudBars.get();
 
             Minecraft.getInstance().submit(() -> ModernFontRenderer.change(globalRenderer.get(), allowShadow.get()));
@@ -299,6 +309,7 @@ public final class Config {
             GlyphManagerForge.sMipmapLevel = mipmapLevel.get();
             //GlyphManager.sResolutionLevel = resolutionLevel.get();
             TextLayoutProcessor.sDefaultFontSize = defaultFontSize.get();
+            TextLayoutProcessor.sFoldDigits = foldDigits.get();
         }
     }
 
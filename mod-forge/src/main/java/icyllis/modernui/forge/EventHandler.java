@@ -18,12 +18,18 @@
 
 package icyllis.modernui.forge;
 
+import com.github.benmanes.caffeine.cache.stats.CacheStats;
 import icyllis.modernui.ModernUI;
+import icyllis.modernui.graphics.font.GlyphManagerForge;
 import icyllis.modernui.screen.BlurHandler;
+import icyllis.modernui.platform.FrameProfiler;
 import icyllis.modernui.platform.RenderCore;
 import icyllis.modernui.screen.OpenMenuEvent;
+import icyllis.modernui.test.TestHUD;
 import icyllis.modernui.test.TestMenu;
 import icyllis.modernui.test.TestUI;
+import icyllis.modernui.textmc.TextLayoutProcessor;
+import net.minecraft.client.Minecraft;
 import net.minecraft.client.ProgressOption;
 import net.minecraft.client.gui.screens.Screen;
 import net.minecraft.client.gui.screens.VideoSettingsScreen;
@@ -37,6 +43,7 @@ import net.minecraftforge.client.event.GuiOpenEvent;
 import net.minecraftforge.client.event.GuiScreenEvent;
 import net.minecraftforge.client.event.ModelBakeEvent;
 import net.minecraftforge.client.event.ModelRegistryEvent;
+import net.minecraftforge.client.event.RenderGameOverlayEvent;
 import net.minecraftforge.client.model.ModelLoader;
 import net.minecraftforge.event.TickEvent;
 import net.minecraftforge.event.entity.player.PlayerInteractEvent;
@@ -46,6 +53,7 @@ import net.minecraftforge.fml.common.Mod;
 
 import javax.annotation.Nonnull;
 import javax.annotation.Nullable;
+import java.util.List;
 import java.util.Map;
 import java.util.Objects;
 import java.util.function.Function;
@@ -159,9 +167,32 @@ final class EventHandler {
         static void onRenderTick(@Nonnull TickEvent.RenderTickEvent event) {
             if (event.phase == TickEvent.Phase.END) {
                 RenderCore.flushRenderCalls();
+                GlyphManagerForge.nextFrame();
+                TestHUD.nextFrame();
+                // profile only when the results are shown, JFR recording enables it as well
+                FrameProfiler.setEnabled(Minecraft.getInstance().options.renderDebug);
             }
         }
 
+        @SubscribeEvent
+        static void onRenderDebugText(@Nonnull RenderGameOverlayEvent.Text event) {
+            if (!Minecraft.getInstance().options.renderDebug) {
+                return;
+            }
+            final TextLayoutProcessor processor = TextLayoutProcessor.getInstance();
+            final CacheStats stats = processor.getCacheStats();
+            final List<String> right = event.getRight();
+            right.add("");
+            right.add(String.format("[Modern UI] Layout Cache: %d (%d glyphs)",
+                    processor.getCacheSize(), processor.getCacheWeight()));
+            right.add(String.format("Hit Rate: %.1f%%, Evicted: %d",
+                    stats.hitRate() * 100, stats.evictionCount()));
+            right.add("Text Draw Calls: " + TestHUD.getTextDrawCalls());
+            right.add("");
+            right.add("[Modern UI] Frame Profiler (avg / max)");
+            TestHUD.addProfilerLines(right);
+        }
+
         /*@SubscribeEvent(receiveCanceled = true)
         static void onGuiOpen(@Nonnull GuiOpenEvent event) {
 
@@ -86,6 +86,9 @@ public final class ModernUIForge extends ModernUI {
 
         if (FMLEnvironment.dist.isClient()) {
             if (!isDataGen) {
+                // linked program binaries, invalidated by the shader sources and the driver
+                ShaderManager.getInstance().setBinaryCacheDirectory(
+                        FMLPaths.GAMEDIR.get().resolve(ModernUI.ID).resolve("shader_cache"));
                 ((ReloadableResourceManager) Minecraft.getInstance().getResourceManager())
                         .registerReloadListener(
                                 (ISelectiveResourceReloadListener) (manager, predicate) -> {
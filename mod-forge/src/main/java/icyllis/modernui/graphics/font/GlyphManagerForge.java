@@ -19,7 +19,8 @@
 package icyllis.modernui.graphics.font;
 
 import icyllis.modernui.ModernUI;
-import icyllis.modernui.graphics.texture.Texture2D;
+import icyllis.modernui.math.Rect;
+import icyllis.modernui.platform.FrameProfiler;
 import icyllis.modernui.platform.RenderCore;
 import icyllis.modernui.text.FontCollection;
 import icyllis.modernui.textmc.VanillaTextKey;
@@ -31,6 +32,8 @@ import it.unimi.dsi.fastutil.longs.Long2ObjectMap;
 import it.unimi.dsi.fastutil.longs.Long2ObjectMaps;
 import it.unimi.dsi.fastutil.longs.Long2ObjectRBTreeMap;
 import it.unimi.dsi.fastutil.objects.ObjectArrayList;
+import it.unimi.dsi.fastutil.objects.Reference2IntMap;
+import it.unimi.dsi.fastutil.objects.Reference2IntOpenHashMap;
 import org.apache.commons.lang3.StringUtils;
 import org.apache.logging.log4j.Marker;
 import org.apache.logging.log4j.MarkerManager;
@@ -38,13 +41,12 @@ import org.lwjgl.BufferUtils;
 import org.lwjgl.system.MemoryUtil;
 
 import javax.annotation.Nonnull;
-import javax.annotation.Nullable;
 import java.awt.*;
 import java.awt.font.GlyphVector;
-import java.awt.geom.Point2D;
 import java.awt.image.BufferedImage;
 import java.io.File;
 import java.nio.ByteBuffer;
+import java.util.ArrayList;
 import java.util.List;
 import java.util.Locale;
 import java.util.Optional;
@@ -149,20 +151,14 @@ public class GlyphManagerForge extends GlyphManagerBase {
     private Graphics2D tempStringGraphics;
 
 
-    /**
-     * Intermediate data array for use with textureImage.getRgb().
-     */
-    //TODO May Out of bounds
-    private final int[] mImageData = new int[((1 << 6) * (1 << 6)) << 1];
-
     /**
      * A direct buffer used with glTexSubImage2D(). Used for loading the pre-rendered glyph
-     * images from the glyphCacheImage BufferedImage into OpenGL textures.
+     * images from the glyphCacheImage BufferedImage into OpenGL textures. Grows if needed.
      */
-    private final ByteBuffer mUploadBuffer = BufferUtils.createByteBuffer(mImageData.length);
+    private ByteBuffer mUploadBuffer = BufferUtils.createByteBuffer(((1 << 6) * (1 << 6)) << 1);
 
     // the head address
-    private final long mDataPtr = MemoryUtil.memAddress(mUploadBuffer);
+    private long mDataPtr = MemoryUtil.memAddress(mUploadBuffer);
 
     /*
      * A single integer direct buffer with native byte ordering used for returning values from glGenTextures().
@@ -178,10 +174,34 @@ public class GlyphManagerForge extends GlyphManagerBase {
 
 
     /**
-     * ID of current OpenGL cache texture being used by cacheGlyphs() to store
-     * pre-rendered glyph images. Render thread only.
+     * Atlas pages storing pre-rendered glyph images, each page is a fixed-size texture
+     * packed by a skyline packer. Render thread only.
+     */
+    private final List<GlyphPage> mPages = new ArrayList<>();
+
+    /**
+     * The max number of atlas pages before evicting the least recently used one.
+     * This is a soft limit, pages used in the current frame are never evicted.
+     */
+    private static final int MAX_PAGES = 4;
+
+    /**
+     * The current frame index, used to find the least recently used page.
      */
-    private Texture2D mTexture;
+    public static int sFrame;
+
+    /**
+     * Increased when a page is evicted, cached layouts referring glyphs should be dropped.
+     */
+    private int mGeneration;
+
+    /**
+     * The generation right after each page was last evicted, glyphs obtained before
+     * that are invalid, see {@link #isEvicted(TexturedGlyph, int)}.
+     */
+    private final Reference2IntMap<GlyphPage> mEvictedGenerations = new Reference2IntOpenHashMap<>();
+
+    private final Rect mTmpRect = new Rect();
 
     /**
      * A cache of pre-rendered glyphs mapping each glyph by its glyphCode to
@@ -204,27 +224,6 @@ public class GlyphManagerForge extends GlyphManagerBase {
     @Deprecated
     private int emojiTexture;*/
 
-    /**
-     * The X coordinate of the upper=left corner in glyphCacheImage where the next glyph image should be stored. Glyphs are
-     * always added left-to-right on the current line until it fills up, at which point they continue filling the texture on
-     * the next line.
-     */
-    private int mCurrPosX = GLYPH_SPACING;
-
-    /**
-     * The Y coordinate of the upper-left corner in glyphCacheImage where the next glyph image should be stored. Glyphs are
-     * stored left-to-right in horizontal lines, and top-to-bottom until the entire texture fills up. At that point, a new
-     * texture is allocated to keep storing additional glyphs, and the original texture remains allocated for the lifetime of
-     * the application.
-     */
-    private int mCurrPosY = GLYPH_SPACING;
-
-    /**
-     * The height in pixels of the current line of glyphs getting written into the texture. This value determines by how much
-     * cachePosY will get incremented when the current horizontal line in the texture fills up.
-     */
-    private int mCurrLineHeight = 0;
-
     /**
      * A single instance of GlyphManager is allocated for internal use.
      */
@@ -236,7 +235,6 @@ public class GlyphManagerForge extends GlyphManagerBase {
         /* The drawImage() to this buffer will copy all source pixels instead of alpha blending them into the current image */
         mGlyphGraphics.setComposite(AlphaComposite.Src);
 
-        allocateGlyphTexture();
         //allocateStringImage(STRING_WIDTH, STRING_HEIGHT);
 
         loadPreferredFonts();
@@ -257,18 +255,16 @@ public class GlyphManagerForge extends GlyphManagerBase {
      * Reload fonts, clear all cached data
      */
     public void reload() {
-        mCurrPosX = GLYPH_SPACING;
-        mCurrPosY = GLYPH_SPACING;
-        mCurrLineHeight = 0;
+        mGeneration++;
         mFontKeyMap.clear();
         mGlyphCache.clear();
         mDigitsMap.clear();
         //mEmojiMap.clear();
-        mTexture = null;
+        mPages.clear();
+        mEvictedGenerations.clear();
         //emojiTexture = 0;
         TextRenderType.deleteTextures();
         mSelectedFonts.clear();
-        allocateGlyphTexture();
         loadPreferredFonts();
         setRenderingHints();
         ModernUI.LOGGER.debug(MARKER, "Font engine reloaded");
@@ -428,8 +424,16 @@ public class GlyphManagerForge extends GlyphManagerBase {
     public TexturedGlyph lookupGlyph(Font font, int glyphCode) {
         // the key should be cached in layout step, see deriveFont()
         long fontKey = (long) mFontKeyMap.getInt(font) << 32;
-        return mGlyphCache.computeIfAbsent(fontKey | glyphCode,
-                l -> cacheGlyph(font, glyphCode));
+        // not computeIfAbsent, caching may evict a page and remove entries of the map
+        TexturedGlyph glyph = mGlyphCache.get(fontKey | glyphCode);
+        if (glyph == null) {
+            FrameProfiler.count(FrameProfiler.GLYPH_MISSES, 1);
+            glyph = cacheGlyph(font, glyphCode);
+            mGlyphCache.put(fontKey | glyphCode, glyph);
+        }
+        // a glyph queried in this frame may be drawn later, don't evict it
+        glyph.getPage().markUsed(sFrame);
+        return glyph;
     }
 
     /**
@@ -464,40 +468,33 @@ public class GlyphManagerForge extends GlyphManagerBase {
         int renderWidth = (int) renderBounds.getWidth();
         int renderHeight = (int) renderBounds.getHeight();
 
-        if (mCurrPosX + renderWidth + GLYPH_SPACING >= TEXTURE_SIZE) {
-            mCurrPosX = GLYPH_SPACING;
-            mCurrPosY += mCurrLineHeight + GLYPH_SPACING * 2;
-            mCurrLineHeight = 0;
-        }
-        if (mCurrPosY + renderHeight + GLYPH_SPACING >= TEXTURE_SIZE) {
-            mCurrPosX = GLYPH_SPACING;
-            mCurrPosY = GLYPH_SPACING;
-            allocateGlyphTexture();
-        }
-
         int baselineX = (int) renderBounds.getX();
         int baselineY = (int) renderBounds.getY();
         float advance = vector.getGlyphMetrics(0).getAdvanceX();
 
         mGlyphGraphics.setFont(font);
 
-        int x = mCurrPosX - GLYPH_BORDER;
-        int y = mCurrPosY - GLYPH_BORDER;
-        int width = renderWidth + GLYPH_BORDER * 2;
-        int height = renderHeight + GLYPH_BORDER * 2;
+        final Rect r = mTmpRect;
+        GlyphPage page = allocatePage(renderWidth + GLYPH_BORDER * 2, renderHeight + GLYPH_BORDER * 2, r);
 
-        mGlyphGraphics.drawGlyphVector(vector, mCurrPosX - baselineX, mCurrPosY - baselineY);
+        int x = r.left;
+        int y = r.top;
+        int width = r.width();
+        int height = r.height();
 
-        uploadTexture(x, y, width, height);
+        // the image is shared by all pages, clear the previous content in this region
+        mGlyphGraphics.clearRect(x, y, width, height);
+        mGlyphGraphics.drawGlyphVector(vector, x + GLYPH_BORDER - baselineX, y + GLYPH_BORDER - baselineY);
+
+        uploadTexture(page, x, y, width, height);
 
-        mCurrLineHeight = Math.max(mCurrLineHeight, renderHeight);
-        mCurrPosX += renderWidth + GLYPH_SPACING * 2;
         final float f = getResolutionFactor();
+        final float size = page.getSize();
 
-        return new TexturedGlyph(mTexture, advance / f, baselineX / f, baselineY / f,
+        return new TexturedGlyph(page, advance / f, baselineX / f, baselineY / f,
                 width / f, height / f,
-                (float) x / TEXTURE_SIZE, (float) y / TEXTURE_SIZE,
-                (float) (x + width) / TEXTURE_SIZE, (float) (y + height) / TEXTURE_SIZE);
+                x / size, y / size,
+                (x + width) / size, (y + height) / size);
     }
 
     /**
@@ -509,8 +506,16 @@ public class GlyphManagerForge extends GlyphManagerBase {
     public TexturedGlyph[] lookupDigits(Font font) {
         // the key should be cached in layout step
         int fontKey = mFontKeyMap.getInt(font);
-        return mDigitsMap.computeIfAbsent(fontKey,
-                l -> cacheDigits(font));
+        TexturedGlyph[] digits = mDigitsMap.get(fontKey);
+        if (digits == null) {
+            FrameProfiler.count(FrameProfiler.GLYPH_MISSES, 10);
+            digits = cacheDigits(font);
+            mDigitsMap.put(fontKey, digits);
+        }
+        for (TexturedGlyph glyph : digits) {
+            glyph.getPage().markUsed(sFrame);
+        }
+        return digits;
     }
 
     /**
@@ -553,25 +558,6 @@ public class GlyphManagerForge extends GlyphManagerBase {
             int renderWidth = (int) renderBounds.getWidth();
             int renderHeight = (int) renderBounds.getHeight();
 
-            if (i == 0) {
-                if (mCurrPosX + renderWidth + GLYPH_SPACING >= TEXTURE_SIZE) {
-                    mCurrPosX = GLYPH_SPACING;
-                    mCurrPosY += mCurrLineHeight + GLYPH_SPACING * 2;
-                    mCurrLineHeight = 0;
-                }
-            } else {
-                if (mCurrPosX + standardRenderWidth + GLYPH_SPACING >= TEXTURE_SIZE) {
-                    mCurrPosX = GLYPH_SPACING;
-                    mCurrPosY += mCurrLineHeight + GLYPH_SPACING * 2;
-                    mCurrLineHeight = 0;
-                }
-            }
-            if (mCurrPosY + renderHeight + GLYPH_SPACING >= TEXTURE_SIZE) {
-                mCurrPosX = GLYPH_SPACING;
-                mCurrPosY = GLYPH_SPACING;
-                allocateGlyphTexture();
-            }
-
             int baselineX = (int) renderBounds.getX();
             int baselineY = (int) renderBounds.getY();
             if (i == 0) {
@@ -579,253 +565,50 @@ public class GlyphManagerForge extends GlyphManagerBase {
                 standardRenderWidth = renderWidth;
             }
 
-            int x = mCurrPosX - GLYPH_BORDER;
-            int y = mCurrPosY - GLYPH_BORDER;
-            int width;
-            if (i == 0) {
-                width = renderWidth + GLYPH_BORDER * 2;
-            } else {
-                width = standardRenderWidth + GLYPH_BORDER * 2;
-            }
-            int height = renderHeight + GLYPH_BORDER * 2;
+            final Rect r = mTmpRect;
+            GlyphPage page = allocatePage(standardRenderWidth + GLYPH_BORDER * 2, renderHeight + GLYPH_BORDER * 2, r);
+
+            int x = r.left;
+            int y = r.top;
+            int width = r.width();
+            int height = r.height();
 
+            mGlyphGraphics.clearRect(x, y, width, height);
             // ASCII digits are not allowed to be laid-out into other code points
             if (i == 0) {
-                mGlyphGraphics.drawString(String.valueOf(chars), mCurrPosX - baselineX, mCurrPosY - baselineY);
+                mGlyphGraphics.drawString(String.valueOf(chars), x + GLYPH_BORDER - baselineX, y + GLYPH_BORDER - baselineY);
             } else {
                 // align to center
                 int offset = Math.round((standardAdvance - vector.getGlyphMetrics(0).getAdvanceX()) / 2.0f);
-                mGlyphGraphics.drawString(String.valueOf(chars), mCurrPosX + offset - baselineX, mCurrPosY - baselineY);
+                mGlyphGraphics.drawString(String.valueOf(chars), x + GLYPH_BORDER + offset - baselineX, y + GLYPH_BORDER - baselineY);
             }
 
-            uploadTexture(x, y, width, height);
+            uploadTexture(page, x, y, width, height);
 
-            mCurrLineHeight = Math.max(mCurrLineHeight, renderHeight);
-            mCurrPosX += standardRenderWidth + GLYPH_SPACING * 2;
-
-            digits[i] = new TexturedGlyph(mTexture,
+            final float size = page.getSize();
+            digits[i] = new TexturedGlyph(page,
                     standardAdvance / f, baselineX / f, baselineY / f,
                     width / f, height / f,
-                    (float) x / TEXTURE_SIZE, (float) y / TEXTURE_SIZE,
-                    (float) (x + width) / TEXTURE_SIZE, (float) (y + height) / TEXTURE_SIZE);
+                    x / size, y / size,
+                    (x + width) / size, (y + height) / size);
         }
 
         return digits;
     }
 
-    /**
-     * Given an OpenType font and a string, make sure that every glyph used by that string is pre-rendered into an OpenGL texture and cached
-     * in the glyphCache map for later retrieval by lookupGlyph()
-     *
-     * @param font        the font used to create a GlyphVector for the string and to actually draw the individual glyphs
-     * @param text        the string from which to cache glyph images
-     * @param start       the offset into text at which to start caching glyphs
-     * @param limit       the (offset + length) at which to stop caching glyphs
-     * @param layoutFlags either Font.LAYOUT_RIGHT_TO_LEFT or Font.LAYOUT_LEFT_TO_RIGHT; needed for weak bidirectional characters like
-     *                    parenthesis which are mapped to two different glyph codes depending on the surrounding text direction
-     * @deprecated {@link #cacheGlyph(Font, int)}
-     */
-    @Deprecated
-    private void cacheGlyphs(Font font, char[] text, int start, int limit, int layoutFlags) {
-        /* Create new GlyphVector so glyphs can be moved around (kerning workaround; see below) without affecting caller */
-        GlyphVector vector = layoutGlyphVector(font, text, start, limit, layoutFlags);
-
-        /* Pixel aligned bounding box for the entire vector; only set if the vector has to be drawn to cache a glyph image */
-        Rectangle vectorBounds = null;
-
-        /* This forms the upper 32 bits of the fontCache key to make every font/glyph code point unique */
-        long fontKey = (long) mFontKeyMap.get(font) << 32;
-
-        int numGlyphs = vector.getNumGlyphs(); /* Length of the GlyphVector */
-        Rectangle dirty = null;                /* Total area within texture that needs to be updated with glTexSubImage2D() */
-        boolean vectorRendered = false;        /* True if entire GlyphVector was rendered into stringImage */
-
-        for (int index = 0; index < numGlyphs; index++) {
-            /* If this glyph code is already in glyphCache, then there is no reason to pre-render it again */
-            int glyphCode = vector.getGlyphCode(index);
-            if (mGlyphCache.containsKey(fontKey | glyphCode)) {
-                continue;
-            }
-
-            /*
-             * The only way to get glyph shapes with font hinting is to draw the entire glyph vector into a
-             * temporary BufferedImage, and then bit blit the individual glyphs based on their bounding boxes
-             * returned by the glyph vector. Although it is possible to call font.createGlyphVector() with an
-             * array of glyphcodes (and therefore render only a few glyphs at a time), this produces corrupted
-             * Davengari glyphs under Windows 7. The vectorRendered flag will draw the string at most one time.
-             */
-            if (!vectorRendered) {
-                vectorRendered = true;
-
-                /*
-                 * Kerning can make it impossible to cleanly separate adjacent glyphs. To work around this,
-                 * each glyph is manually advanced by 2 pixels to the right of its neighbor before rendering
-                 * the entire string. The getGlyphPixelBounds() later on will return the new adjusted bounds
-                 * for the glyph.
-                 */
-                for (int i = 0; i < numGlyphs; i++) {
-                    Point2D pos = vector.getGlyphPosition(i);
-                    pos.setLocation(pos.getX() + 2 * i, pos.getY());
-                    vector.setGlyphPosition(i, pos);
-                }
-
-                /*
-                 * Compute the exact area that the rendered string will take up in the image buffer. Note that
-                 * the string will actually be drawn at a positive (x,y) offset from (0,0) to leave enough room
-                 * for the ascent above the baseline and to correct for a few glyphs that appear to have negative
-                 * horizontal bearing (e.g. U+0423 Cyrillic uppercase letter U on Windows 7).
-                 */
-                vectorBounds = vector.getPixelBounds(mGlyphGraphics.getFontRenderContext(), 0, 0);
-
-                /* Enlarge the stringImage if it is too small to store the entire rendered string */
-                if (vectorBounds.width > tempStringImage.getWidth() || vectorBounds.height > tempStringImage.getHeight()) {
-                    int width = Math.max(vectorBounds.width, tempStringImage.getWidth());
-                    int height = Math.max(vectorBounds.height, tempStringImage.getHeight());
-                    allocateStringImage(width, height);
-                }
-
-                /* Erase the upper-left corner where the string will get drawn*/
-                tempStringGraphics.clearRect(0, 0, vectorBounds.width, vectorBounds.height);
-
-                /* Draw string with opaque white color and baseline adjustment so the upper-left corner of the image is at (0,0) */
-                tempStringGraphics.drawGlyphVector(vector, -vectorBounds.x, -vectorBounds.y);
-            }
-
-            /*
-             * Get the glyph's pixel-aligned bounding box. The JavaDoc claims that the "The outline returned
-             * by this method is positioned around the origin of each individual glyph." However, the actual
-             * bounds are all relative to the start of the entire GlyphVector, which is actually more useful
-             * for extracting the glyph's image from the rendered string.
-             */
-            Rectangle rect = vector.getGlyphPixelBounds(index, null, -vectorBounds.x, -vectorBounds.y);
-
-            /* If the current line in cache image is full, then advance to the next line */
-            if (mCurrPosX + rect.width + GLYPH_SPACING > TEXTURE_WIDTH) {
-                mCurrPosX = GLYPH_SPACING;
-                mCurrPosY += mCurrLineHeight + GLYPH_SPACING;
-                mCurrLineHeight = 0;
-            }
-
-            /*
-             * If the entire image is full, update the current OpenGL texture with everything changed so far in the image
-             * (i.e. the dirty rectangle), allocate a new cache texture, and then continue storing glyph images to the
-             * upper-left corner of the new texture.
-             */
-            if (mCurrPosY + rect.height + GLYPH_SPACING > TEXTURE_HEIGHT) {
-                updateTexture(dirty);
-
-                /* Note that allocateAndSetupTexture() will leave the GL texture already bound */
-                allocateGlyphTexture();
-                allocateStringImage(STRING_WIDTH, STRING_HEIGHT);
-
-                mCurrPosY = mCurrPosX = GLYPH_SPACING;
-                mCurrLineHeight = 0;
-
-                /* re-draw glyph layout to ensure rest chars be rendered correctly on the new texture */
-                cacheGlyphs(font, text, start + index, limit, layoutFlags);
-                return;
-            }
-
-            /* The tallest glyph on this line determines the total vertical advance in the texture */
-            if (rect.height > mCurrLineHeight) {
-                mCurrLineHeight = rect.height;
-            }
-
-            /*
-             * Blit the individual glyph from it's position in the temporary string buffer to its (cachePosX,
-             * cachePosY) position in the texture. NOTE: We don't have to erase the area in the texture image
-             * first because the composite method in the Graphics object is always set to AlphaComposite.Src.
-             */
-            mGlyphGraphics.drawImage(tempStringImage,
-                    mCurrPosX, mCurrPosY, mCurrPosX + rect.width, mCurrPosY + rect.height,
-                    rect.x, rect.y, rect.x + rect.width, rect.y + rect.height, null);
-
-            /*
-             * Store this glyph's position in texture and its origin offset. Note that "rect" will not be modified after
-             * this point, and getGlyphPixelBounds() always returns a new Rectangle.
-             */
-            rect.setLocation(mCurrPosX, mCurrPosY);
-
-            /*
-             * Create new cache entry to record both the texture used by the glyph and its position within that texture.
-             * Texture coordinates are normalized to 0.0-1.0 by dividing with TEXTURE_WIDTH and TEXTURE_HEIGHT.
-             */
-            /*TexturedGlyph texturedGlyph = new TexturedGlyph();
-            texturedGlyph.textureName = textureName;
-            texturedGlyph.renderType = TextRenderType.getOrCacheType(textureName);
-            texturedGlyph.advance = rect.width;
-            texturedGlyph.height = rect.height;
-            texturedGlyph.u1 = (float) rect.x / TEXTURE_WIDTH;
-            texturedGlyph.v1 = (float) rect.y / TEXTURE_HEIGHT;
-            texturedGlyph.u2 = (float) (rect.x + rect.width) / TEXTURE_WIDTH;
-            texturedGlyph.v2 = (float) (rect.y + rect.height) / TEXTURE_HEIGHT;*/
-
-            /*
-             * The lower 32 bits of the glyphCache key are the glyph codepoint. The upper 64 bits are the font number
-             * stored in the fontCache. This creates a unique numerical id for every font/glyph combination.
-             */
-            //glyphCache.put(fontKey | glyphCode, texturedGlyph);
-
-            /*
-             * Track the overall modified region in the texture by performing a union of this glyph's texture position
-             * with the update region created so far. Reusing "rect" here makes it easier to extend the dirty rectangle
-             * region than using the add(x, y) method to extend by a single point. Also note that creating the first
-             * dirty rectangle here avoids having to deal with the special rules for empty/non-existent rectangles.
-             */
-            if (dirty == null) {
-                dirty = new Rectangle(mCurrPosX, mCurrPosY, rect.width, rect.height);
-            } else {
-                dirty.add(rect);
-            }
-
-            /* Advance cachePosX so the next glyph can be stored immediately to the right of this one */
-            mCurrPosX += rect.width + GLYPH_SPACING;
-        }
-
-        /* Update OpenGL texture if any part of the glyphCacheImage has changed */
-        updateTexture(dirty);
-    }
-
-    /**
-     * Update a portion of the current glyph cache texture using the contents of the glyphCacheImage with glTexSubImage2D().
-     *
-     * @param dirty The rectangular region in glyphCacheImage that has changed and needs to be copied into the texture
-     *              bleeding when interpolation is active or add a small "fudge factor" to the UV coordinates like already n FontRenderer
-     */
-    @Deprecated
-    private void updateTexture(@Nullable Rectangle dirty) {
-        /* Only update OpenGL texture if changes were made to the texture */
-        /*if (dirty != null) {
-         *//* Load imageBuffer with pixel data ready for transfer to OpenGL texture *//*
-            updateImageBuffer(dirty.x, dirty.y, dirty.width, dirty.height);
-
-            GlStateManager._bindTexture(mTextureId);
-
-            GlStateManager._pixelStore(GL11.GL_UNPACK_ROW_LENGTH, dirty.width);
-            GlStateManager._pixelStore(GL11.GL_UNPACK_SKIP_ROWS, 0);
-            GlStateManager._pixelStore(GL11.GL_UNPACK_SKIP_PIXELS, 0);
-            GlStateManager._pixelStore(GL11.GL_UNPACK_ALIGNMENT, 4); // 4 is RGBA
-
-            GL11.glTexSubImage2D(GL11.GL_TEXTURE_2D, 0, dirty.x, dirty.y, dirty.width, dirty.height,
-                    GL11.GL_RGBA, GL11.GL_UNSIGNED_BYTE, mUploadBuffer);
-
-            *//* Auto generate mipmap texture *//*
-            GL30.glGenerateMipmap(GL11.GL_TEXTURE_2D);
-        }*/
-    }
-
     /**
      * Upload texture data of current texture from CPU to GPU with given dirty area.
      *
+     * @param page   the page to upload
      * @param x      left pos
      * @param y      top pos
      * @param width  width
      * @param height height
      */
-    private void uploadTexture(int x, int y, int width, int height) {
+    private void uploadTexture(@Nonnull GlyphPage page, int x, int y, int width, int height) {
         /* Load imageBuffer with pixel data ready for transfer to OpenGL texture */
         updateImageBuffer(x, y, width, height);
-        mTexture.upload(0, x, y, width, height, width, 0, 0, 1, GL_ALPHA, GL_UNSIGNED_BYTE, mDataPtr);
+        page.getTexture().upload(0, x, y, width, height, width, 0, 0, 1, GL_ALPHA, GL_UNSIGNED_BYTE, mDataPtr);
 
         /*GL11.glPixelStorei(GL11.GL_UNPACK_ROW_LENGTH, width); // not full texture
         GL11.glPixelStorei(GL11.GL_UNPACK_SKIP_ROWS, 0);
@@ -846,7 +629,7 @@ public class GlyphManagerForge extends GlyphManagerBase {
         /* Auto generate mipmap texture */
         if (sEnableMipmap && sMipmapLevel > 0) {
             /*GL30.glGenerateMipmap(GL11.GL_TEXTURE_2D);*/
-            mTexture.generateMipmap();
+            page.getTexture().generateMipmap();
         }
     }
 
@@ -860,23 +643,14 @@ public class GlyphManagerForge extends GlyphManagerBase {
      * @param height the height of the pixel region that will be copied into the buffer
      */
     private void updateImageBuffer(int x, int y, int width, int height) {
-        /* Copy raw pixel data from BufferedImage to imageData array with one integer per pixel in 0xAARRGGBB form */
-        mGlyphImage.getRGB(x, y, width, height, mImageData, 0, width);
-
-        /* Copy int array to direct buffer */
-        mUploadBuffer.clear();
-
-        /* Swizzle each color integer from Java's ARGB format to OpenGL's grayscale */
         final int size = width * height;
-        for (int i = 0; i < size; i++) {
-            //int color = imageData[i];
-            //uploadData[i] = (color << 8) | (color >>> 24);
-
-            /* alpha channel for grayscale texture */
-            mUploadBuffer.put((byte) (mImageData[i] >>> 24));
+        if (size > mUploadBuffer.capacity()) {
+            mUploadBuffer = BufferUtils.createByteBuffer(Math.max(size, mUploadBuffer.capacity() << 1));
+            mDataPtr = MemoryUtil.memAddress(mUploadBuffer);
         }
 
-        mUploadBuffer.flip();
+        /* Extract alpha channel from the raster directly to the direct buffer for grayscale texture */
+        GlyphManagerBase.extractAlpha(mGlyphImage, x, y, width, height, mDataPtr);
     }
 
     /**
@@ -899,80 +673,108 @@ public class GlyphManagerForge extends GlyphManagerBase {
     }
 
     /**
-     * Allocate a new OpenGL texture for caching pre-rendered glyph images. The new texture is initialized to fully transparent
-     * white so the individual glyphs images within can have a transparent border between them. The new texture remains bound
-     * after returning from the function.
+     * Allocate a region in atlas pages for a glyph image, including its borders. Existing pages
+     * are tried first, then a new page is created until {@link #MAX_PAGES}. After that, the least
+     * recently used page is evicted if it's not used in the current frame, otherwise an extra page
+     * is created. Pages are never resized, so texture coordinates of other glyphs remain valid.
+     *
+     * @param width  the width of the region
+     * @param height the height of the region
+     * @param out    the allocated region
+     * @return the page containing the region
      */
-    private void allocateGlyphTexture() {
-        /* Initialize the background to all black but fully transparent. */
-        mGlyphGraphics.clearRect(0, 0, TEXTURE_SIZE, TEXTURE_SIZE);
-
-        /* Allocate new OpenGL texture */
-        mTexture = new Texture2D();
-
-        /* Load imageBuffer with pixel data ready for transfer to OpenGL texture */
-        //updateImageBuffer(0, 0, TEXTURE_WIDTH, TEXTURE_HEIGHT);
-
-        /*
-         * Initialize texture with the now cleared BufferedImage. Using a texture with GL_ALPHA8 internal format may result in
-         * faster rendering since the GPU has to only fetch 1 byte per texel instead of 4 with a regular RGBA texture.
-         */
-
-        /* Due to changes in 1.14+, so this ensure pixels are correctly stored from CPU to GPU */
-        /*GlStateManager.pixelStore(GL11.GL_UNPACK_ROW_LENGTH, 0); // 0 is unspecific
-        GlStateManager.pixelStore(GL11.GL_UNPACK_SKIP_ROWS, 0);
-        GlStateManager.pixelStore(GL11.GL_UNPACK_SKIP_PIXELS, 0);
-        GlStateManager.pixelStore(GL11.GL_UNPACK_ALIGNMENT, 4); // 4 is RGBA, has 4 channels*/
-
-        int mipmapLevel = sEnableMipmap ? sMipmapLevel : 0;
-
-        /*if (mipmapLevel >= 0) {
-            GL11.glTexParameteri(GL11.GL_TEXTURE_2D, GL12.GL_TEXTURE_MAX_LEVEL, mipmapLevel);
-            GL11.glTexParameteri(GL11.GL_TEXTURE_2D, GL12.GL_TEXTURE_MIN_LOD, 0);
-            GL11.glTexParameteri(GL11.GL_TEXTURE_2D, GL12.GL_TEXTURE_MAX_LOD, mipmapLevel);
-            GL11.glTexParameterf(GL11.GL_TEXTURE_2D, GL14.GL_TEXTURE_LOD_BIAS, 0.0f);
+    @Nonnull
+    private GlyphPage allocatePage(int width, int height, @Nonnull Rect out) {
+        if (width > TEXTURE_SIZE || height > TEXTURE_SIZE) {
+            throw new IllegalArgumentException("Glyph is too large: " + width + "x" + height);
         }
-
-        for (int level = 0; level <= mipmapLevel; level++) {
-            GL11.glTexImage2D(GL11.GL_TEXTURE_2D, level, GL11.GL_ALPHA, TEXTURE_SIZE >> level,
-                    TEXTURE_SIZE >> level, 0, GL11.GL_ALPHA, GL11.GL_UNSIGNED_BYTE, (IntBuffer) null);
-        }*/
-        mTexture.initCompat(GL_ALPHA, TEXTURE_SIZE, TEXTURE_SIZE, mipmapLevel);
-
-        //mTexture.swizzle(GL_ONE, GL_ONE, GL_ONE, GL_RED);
-
-        /* We set MinMag params here, just call once for a texture */
-        /*if (sAntiAliasing) {
-            if (sEnableMipmap) {
-                GL11.glTexParameteri(GL11.GL_TEXTURE_2D, GL11.GL_TEXTURE_MIN_FILTER, GL11.GL_LINEAR_MIPMAP_LINEAR);
-            } else {
-                GL11.glTexParameteri(GL11.GL_TEXTURE_2D, GL11.GL_TEXTURE_MIN_FILTER, GL11.GL_LINEAR);
+        for (GlyphPage page : mPages) {
+            if (page.allocate(width, height, out)) {
+                page.markUsed(sFrame);
+                return page;
             }
-            GL11.glTexParameteri(GL11.GL_TEXTURE_2D, GL11.GL_TEXTURE_MAG_FILTER, GL11.GL_LINEAR);
-        } else {
-            if (sEnableMipmap) {
-                GL11.glTexParameteri(GL11.GL_TEXTURE_2D, GL11.GL_TEXTURE_MIN_FILTER, GL11.GL_NEAREST_MIPMAP_LINEAR);
-            } else {
-                GL11.glTexParameteri(GL11.GL_TEXTURE_2D, GL11.GL_TEXTURE_MIN_FILTER, GL11.GL_NEAREST);
+        }
+        GlyphPage page = null;
+        if (mPages.size() >= MAX_PAGES) {
+            GlyphPage lru = mPages.get(0);
+            for (GlyphPage p : mPages) {
+                if (p.getLastUsed() < lru.getLastUsed()) {
+                    lru = p;
+                }
             }
-            GL11.glTexParameteri(GL11.GL_TEXTURE_2D, GL11.GL_TEXTURE_MAG_FILTER, GL11.GL_NEAREST);
-        }*/
+            if (lru.getLastUsed() < sFrame) {
+                evictPage(lru);
+                page = lru;
+            }
+        }
+        if (page == null) {
+            page = new GlyphPage(TEXTURE_SIZE, sEnableMipmap ? sMipmapLevel : 0);
+            /* We set MinMag params here, just call once for a texture */
+            page.getTexture().setFilter(sAntiAliasing, sEnableMipmap);
+            mPages.add(page);
+            ModernUI.LOGGER.debug(MARKER, "Allocated glyph page #{}", mPages.size());
+        }
+        page.allocate(width, height, out);
+        page.markUsed(sFrame);
+        return page;
+    }
 
-        mTexture.setFilter(sAntiAliasing, sEnableMipmap);
+    /**
+     * Removes all glyphs of the given page and clears the page. Glyphs are cached again
+     * when queried, cached layouts are validated by {@link #isEvicted(TexturedGlyph, int)}.
+     *
+     * @param page the page to evict
+     */
+    private void evictPage(@Nonnull GlyphPage page) {
+        // the page is cleared by eviction
+        final int glyphCount = page.getGlyphCount();
+        final float occupancy = page.getOccupancy();
+        synchronized (mGlyphCache) {
+            mGlyphCache.values().removeIf(glyph -> glyph.getPage() == page);
+        }
+        mDigitsMap.values().removeIf(digits -> {
+            for (TexturedGlyph glyph : digits) {
+                if (glyph.getPage() == page) {
+                    return true;
+                }
+            }
+            return false;
+        });
+        page.evict();
+        mGeneration++;
+        mEvictedGenerations.put(page, mGeneration);
+        ModernUI.LOGGER.debug(MARKER, "Evicted a glyph page with {} glyphs, occupancy {}",
+                glyphCount, occupancy);
+    }
 
-        /* Auto generate mipmap */
-        /*if (sEnableMipmap) {
-            GL30.glGenerateMipmap(GL11.GL_TEXTURE_2D);
-        }*/
+    /**
+     * Returns the number of page evictions. When it changes, glyphs obtained before
+     * may refer to other images and must be looked up again.
+     *
+     * @return the current generation
+     */
+    public int getGeneration() {
+        return mGeneration;
+    }
 
-        /* Clear mipmap data, current grayscale value is zero, this is a little inefficient */
-        /* Keep the (2^shift)^2 less than imageData.length() */
-        final int size = (TEXTURE_SIZE >> 6) * (TEXTURE_SIZE >> 6);
-        for (int i = 0; i < size; i++) {
-            int x = (i & ((TEXTURE_SIZE >> 6) - 1)) << 6;
-            int y = (i / (TEXTURE_SIZE >> 6)) << 6;
-            uploadTexture(x, y, 1 << 6, 1 << 6);
-        }
+    /**
+     * Returns whether the page of a glyph was evicted after the given generation, then
+     * the glyph obtained at that generation must be looked up again. Glyphs obtained
+     * before {@link #reload()} are never checked, the callers drop them as a whole.
+     *
+     * @param glyph      the glyph obtained before
+     * @param generation the generation when the glyph was obtained
+     * @return true if the glyph is invalid
+     */
+    public boolean isEvicted(@Nonnull TexturedGlyph glyph, int generation) {
+        return mEvictedGenerations.getInt(glyph.getPage()) > generation;
+    }
+
+    /**
+     * Moves to the next frame, called at the end of each render tick.
+     */
+    public static void nextFrame() {
+        sFrame++;
     }
 
     /**
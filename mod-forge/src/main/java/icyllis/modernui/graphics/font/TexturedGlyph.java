@@ -18,12 +18,8 @@
 
 package icyllis.modernui.graphics.font;
 
-import com.mojang.blaze3d.systems.RenderSystem;
 import com.mojang.blaze3d.vertex.VertexConsumer;
-import com.mojang.math.Matrix4f;
 import icyllis.modernui.textmc.pipeline.TextRenderType;
-import icyllis.modernui.graphics.texture.Texture2D;
-import net.minecraft.client.renderer.MultiBufferSource;
 import org.apache.commons.lang3.tuple.Pair;
 
 import javax.annotation.Nonnull;
@@ -42,6 +38,11 @@ public class TexturedGlyph {
     private final TextRenderType renderType;
     private final TextRenderType seeThroughType;
 
+    /**
+     * The atlas page containing the image, marked used when drawing.
+     */
+    private final GlyphPage page;
+
     // see getAdvance()
     private final float advance;
 
@@ -95,10 +96,11 @@ public class TexturedGlyph {
      */
     private final float v2;
 
-    public TexturedGlyph(Texture2D texture, float advance, float baselineX, float baselineY, float width, float height, float u1, float v1, float u2, float v2) {
-        Pair<TextRenderType, TextRenderType> typePair = TextRenderType.getOrCacheType(texture);
+    public TexturedGlyph(GlyphPage page, float advance, float baselineX, float baselineY, float width, float height, float u1, float v1, float u2, float v2) {
+        Pair<TextRenderType, TextRenderType> typePair = TextRenderType.getOrCacheType(page.getTexture());
         renderType = typePair.getLeft();
         seeThroughType = typePair.getRight();
+        this.page = page;
         this.advance = advance;
         this.baselineX = baselineX;
         this.baselineY = baselineY;
@@ -110,8 +112,12 @@ public class TexturedGlyph {
         this.v2 = v2;
     }
 
+    /**
+     * Put the vertices of this glyph to the builder, the caller binds the texture,
+     * see {@link #getTexture()}.
+     */
     public void drawGlyph(@Nonnull VertexConsumer builder, float x, float y, int r, int g, int b, int a) {
-        RenderSystem.bindTexture(renderType.textureName);
+        page.markUsed(GlyphManagerForge.sFrame);
         x += baselineX;
         y += baselineY;
         builder.vertex(x, y, 0).color(r, g, b, a).uv(u1, v1).endVertex();
@@ -120,14 +126,38 @@ public class TexturedGlyph {
         builder.vertex(x + width, y, 0).color(r, g, b, a).uv(u2, v1).endVertex();
     }
 
-    public void drawGlyph(Matrix4f matrix, @Nonnull MultiBufferSource buffer, float x, float y, int r, int g, int b, int a, boolean seeThrough, int packedLight) {
-        VertexConsumer builder = buffer.getBuffer(seeThrough ? seeThroughType : renderType);
+    /**
+     * Write the quad of this glyph relative to the given origin, in the order of
+     * left, top, right, bottom, u1, v1, u2, v2.
+     *
+     * @param dst    the destination array
+     * @param offset the start index to write
+     * @param x      the pen position x
+     * @param y      the pen position y
+     */
+    public void bake(@Nonnull float[] dst, int offset, float x, float y) {
         x += baselineX;
         y += baselineY;
-        builder.vertex(matrix, x, y, 0).color(r, g, b, a).uv(u1, v1).uv2(packedLight).endVertex();
-        builder.vertex(matrix, x, y + height, 0).color(r, g, b, a).uv(u1, v2).uv2(packedLight).endVertex();
-        builder.vertex(matrix, x + width, y + height, 0).color(r, g, b, a).uv(u2, v2).uv2(packedLight).endVertex();
-        builder.vertex(matrix, x + width, y, 0).color(r, g, b, a).uv(u2, v1).uv2(packedLight).endVertex();
+        dst[offset] = x;
+        dst[offset + 1] = y;
+        dst[offset + 2] = x + width;
+        dst[offset + 3] = y + height;
+        dst[offset + 4] = u1;
+        dst[offset + 5] = v1;
+        dst[offset + 6] = u2;
+        dst[offset + 7] = v2;
+    }
+
+    @Nonnull
+    public TextRenderType getRenderType(boolean seeThrough) {
+        return seeThrough ? seeThroughType : renderType;
+    }
+
+    /**
+     * The name of the atlas texture containing the image of this glyph.
+     */
+    public int getTexture() {
+        return renderType.textureName;
     }
 
     /**
@@ -136,4 +166,12 @@ public class TexturedGlyph {
     public float getAdvance() {
         return advance;
     }
+
+    /**
+     * The atlas page containing the image of this glyph.
+     */
+    @Nonnull
+    public GlyphPage getPage() {
+        return page;
+    }
 }
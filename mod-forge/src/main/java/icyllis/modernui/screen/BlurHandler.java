@@ -18,20 +18,17 @@
 
 package icyllis.modernui.screen;
 
+import com.mojang.blaze3d.pipeline.RenderTarget;
 import com.mojang.blaze3d.systems.RenderSystem;
 import com.mojang.blaze3d.vertex.*;
 import com.mojang.blaze3d.vertex.BufferBuilder;
 import com.mojang.math.Matrix4f;
-import icyllis.modernui.mixin.AccessGameRenderer;
-import icyllis.modernui.mixin.AccessPostChain;
-import icyllis.modernui.screen.MuiScreen;
+import icyllis.modernui.annotation.RenderThread;
+import icyllis.modernui.graphics.KawaseBlur;
+import icyllis.modernui.math.MathUtil;
 import it.unimi.dsi.fastutil.objects.ObjectArraySet;
 import net.minecraft.client.Minecraft;
 import net.minecraft.client.gui.screens.Screen;
-import net.minecraft.client.renderer.GameRenderer;
-import net.minecraft.client.renderer.PostChain;
-import net.minecraft.client.renderer.PostPass;
-import net.minecraft.resources.ResourceLocation;
 import net.minecraftforge.api.distmarker.Dist;
 import net.minecraftforge.api.distmarker.OnlyIn;
 import org.lwjgl.opengl.GL11;
@@ -41,6 +38,11 @@ import javax.annotation.Nullable;
 import java.util.List;
 import java.util.Set;
 
+/**
+ * Blurs the game world behind screens. The world is blurred with {@link KawaseBlur}
+ * before the in-game GUI is rendered, and the blurred image is reused while the
+ * world behind is static (the game is paused), until the window is resized.
+ */
 @OnlyIn(Dist.CLIENT)
 public enum BlurHandler {
     INSTANCE;
@@ -53,20 +55,20 @@ public enum BlurHandler {
     public static float sBlurRadius;
     public static float sBackgroundAlpha;
 
-    // minecraft namespace
-    private final ResourceLocation mBlurPostEffect = new ResourceLocation("shaders/post/blur_fast.json");
-
     private final Minecraft mMinecraft = Minecraft.getInstance();
 
     private final Set<Class<?>> mBlacklist = new ObjectArraySet<>();
 
+    // created lazily on render thread
+    private KawaseBlur mBlur;
+
     /**
      * If is playing animation
      */
     private boolean mFadingIn;
 
     /**
-     * If blur post-processing shader is activated
+     * If the world is being blurred
      */
     private boolean mBlurring;
 
@@ -81,7 +83,16 @@ public enum BlurHandler {
     private float mBackgroundAlpha;
 
     /**
-     * Use blur shader in game renderer post-processing.
+     * The opacity of the blurred world, which fades in with the background
+     */
+    private float mBlurAlpha;
+
+    // the size of the last blurred world
+    private int mBlurWidth;
+    private int mBlurHeight;
+
+    /**
+     * Start blurring the world if a screen is opened.
      */
     public void count(@Nullable Screen nextScreen) {
         if (mMinecraft.level == null) {
@@ -96,36 +107,42 @@ public enum BlurHandler {
         }
         boolean blurDisabled = excluded || !sBlurEffect;
         if (blurDisabled && excluded && mBlurring) {
-            mMinecraft.gameRenderer.shutdownEffect();
-            mFadingIn = false;
-            mBlurring = false;
+            stopBlur();
         }
 
         boolean hasGui = nextScreen != null;
-        GameRenderer gr = mMinecraft.gameRenderer;
         if (hasGui && !mBlurring && !mScreenOpened) {
-            if (!blurDisabled && gr.currentEffect() == null) {
-                ((AccessGameRenderer) gr).callLoadEffect(mBlurPostEffect);
-                mBlurring = true;
-                if (sAnimationDuration <= 0) {
-                    updateRadius(sBlurRadius);
-                }
+            if (!blurDisabled) {
+                startBlur();
             }
             if (sAnimationDuration > 0) {
                 mFadingIn = true;
                 mBackgroundAlpha = 0;
+                mBlurAlpha = 0;
             } else {
                 mFadingIn = false;
                 mBackgroundAlpha = sBackgroundAlpha;
+                mBlurAlpha = 1;
             }
         } else if (!hasGui && mBlurring) {
-            gr.shutdownEffect();
-            mFadingIn = false;
-            mBlurring = false;
+            stopBlur();
         }
         mScreenOpened = hasGui;
     }
 
+    private void startBlur() {
+        mBlurring = true;
+        if (mBlur != null) {
+            // the world may have changed since last time
+            mBlur.invalidate();
+        }
+    }
+
+    private void stopBlur() {
+        mFadingIn = false;
+        mBlurring = false;
+    }
+
     /**
      * Internal method, to re-blur after resources (including shaders) reloaded in in-game menu
      */
@@ -134,13 +151,10 @@ public enum BlurHandler {
         if (!sBlurEffect) {
             return;
         }
-        if (mMinecraft.level != null) {
-            GameRenderer gr = mMinecraft.gameRenderer;
-            if (gr.currentEffect() == null) {
-                ((AccessGameRenderer) gr).callLoadEffect(mBlurPostEffect);
-                mFadingIn = true;
-                mBlurring = true;
-            }
+        if (mMinecraft.level != null && !mBlurring) {
+            startBlur();
+            mFadingIn = sAnimationDuration > 0;
+            mBlurAlpha = mFadingIn ? 0 : 1;
         }
     }
 
@@ -162,9 +176,7 @@ public enum BlurHandler {
     public void update(long time) {
         if (mFadingIn) {
             float p = Math.min(time / sAnimationDuration, 1.0f);
-            if (mBlurring) {
-                updateRadius(p * sBlurRadius);
-            }
+            mBlurAlpha = p;
             if (mBackgroundAlpha < sBackgroundAlpha) {
                 mBackgroundAlpha = p * sBackgroundAlpha;
             }
@@ -174,14 +186,38 @@ public enum BlurHandler {
         }
     }
 
-    private void updateRadius(float radius) {
-        PostChain effect = mMinecraft.gameRenderer.currentEffect();
-        if (effect == null)
+    /**
+     * Blur the world and draw it to the main render target, called after the world was
+     * rendered and before the in-game GUI is rendered.
+     */
+    @RenderThread
+    public void drawBlurredWorld() {
+        if (!mBlurring) {
             return;
-        List<PostPass> passes = ((AccessPostChain) effect).getPasses();
-        for (PostPass s : passes) {
-            s.getEffect().safeGetUniform("Progress").set(radius);
         }
+        final RenderTarget target = mMinecraft.getMainRenderTarget();
+        KawaseBlur blur = mBlur;
+        if (blur == null) {
+            blur = mBlur = new KawaseBlur();
+        }
+        // the world doesn't change when the game is paused, keep the last result
+        if (!blur.isValid() || !mMinecraft.isPaused() ||
+                target.width != mBlurWidth || target.height != mBlurHeight) {
+            blur.blur(target.colorTextureId, target.width, target.height, getIterations(), 1.0f);
+            mBlurWidth = target.width;
+            mBlurHeight = target.height;
+        }
+        blur.draw(target.frameBufferId, target.width, target.height, mBlurAlpha);
+    }
+
+    // the radius is roughly doubled per iteration
+    private static int getIterations() {
+        int iterations = 32 - Integer.numberOfLeadingZeros(Math.max((int) sBlurRadius, 1)) - 1;
+        return MathUtil.clamp(iterations, 1, KawaseBlur.MAX_ITERATIONS);
+    }
+
+    public float getBackgroundAlpha() {
+        return mBackgroundAlpha;
     }
 
     public void drawScreenBackground(@Nonnull Screen screen, @Nonnull PoseStack stack, int x1, int y1, int x2, int y2) {
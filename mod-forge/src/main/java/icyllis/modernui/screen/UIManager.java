@@ -34,8 +34,11 @@ import icyllis.modernui.graphics.Framebuffer;
 import icyllis.modernui.graphics.GLCanvas;
 import icyllis.modernui.graphics.texture.Texture;
 import icyllis.modernui.graphics.texture.Texture2D;
+import icyllis.modernui.graphics.texture.TextureManager;
 import icyllis.modernui.math.Matrix4;
+import icyllis.modernui.math.Rect;
 import icyllis.modernui.platform.Bitmap;
+import icyllis.modernui.platform.FrameProfiler;
 import icyllis.modernui.platform.RenderCore;
 import icyllis.modernui.test.TestPauseUI;
 import icyllis.modernui.textmc.TextLayoutProcessor;
@@ -69,6 +72,8 @@ import javax.annotation.Nonnull;
 import javax.annotation.Nullable;
 import javax.annotation.concurrent.NotThreadSafe;
 import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Iterator;
 import java.util.List;
 import java.util.Objects;
 import java.util.concurrent.CopyOnWriteArrayList;
@@ -92,6 +97,10 @@ public final class UIManager implements ViewRootImpl.Handler {
 
     // config value
     public static boolean sPlaySoundOnLoaded;
+    public static boolean sShowDirtyRegions;
+
+    // the duration of flashing redrawn regions in milliseconds
+    private static final int DIRTY_FLASH_DURATION = 300;
 
     // minecraft client
     private final Minecraft minecraft = Minecraft.getInstance();
@@ -134,13 +143,20 @@ public final class UIManager implements ViewRootImpl.Handler {
     private final Framebuffer mFramebuffer;
 
     private final Thread mUiThread;
-    private final Object mRenderLock = new Object();
 
     private MotionEvent mPendingMouseEvent;
 
     private boolean mFirstScreenOpened = false;
     private boolean mProjectionChanged = false;
 
+    // the region of the framebuffer to redraw, the rest is kept from last frame
+    private final Rect mDirtyRegion = new Rect();
+    // render thread, true once the framebuffer has been drawn, before that its contents are undefined
+    private boolean mHasFrame;
+
+    // debug, recently redrawn regions
+    private final List<DirtyFlash> mDirtyFlashes = new ArrayList<>();
+
     private UIManager() {
         mAnimationCallback = AnimationHandler.init();
         mFramebuffer = new Framebuffer(mWindow.getWidth(), mWindow.getHeight());
@@ -292,63 +308,68 @@ public final class UIManager implements ViewRootImpl.Handler {
             } catch (InterruptedException ignored) {
             }
 
-            // holds the lock
-            synchronized (mRenderLock) {
-                // 1. do tasks
-                if (!mTasks.isEmpty()) {
-                    // batched processing
-                    mTasks.removeIf(task -> task.doExecuteTask(mFrameTimeMillis));
-                }
-                if (mScreen == null) {
-                    return;
-                }
+            // the UI thread records the next frame while the render thread renders last one,
+            // frames are handed over in GLCanvas.submitFrame()
 
-                // 2. do input events
-                mRoot.doProcessInputEvents();
-
-                // 3. do animations
-                mAnimationCallback.accept(mFrameTimeMillis);
-
-                // 4. do traversal
-                mRoot.doTraversal();
-
-                // test stuff
-                /*Paint paint = Paint.take();
-                paint.setStrokeWidth(6);
-                int c = (int) mElapsedTimeMillis / 300;
-                c = Math.min(c, 8);
-                float[] pts = new float[c * 2 + 2];
-                pts[0] = 90;
-                pts[1] = 30;
-                for (int i = 0; i < c; i++) {
-                    pts[2 + i * 2] = Math.min((i + 2) * 60, mElapsedTimeMillis / 5) + 30;
-                    if ((i & 1) == 0) {
-                        if (mElapsedTimeMillis >= (i + 2) * 300) {
-                            pts[3 + i * 2] = 90;
-                        } else {
-                            pts[3 + i * 2] = 30 + (mElapsedTimeMillis % 300) / 5f;
-                        }
+            // 1. do tasks
+            if (!mTasks.isEmpty()) {
+                // batched processing
+                mTasks.removeIf(task -> task.doExecuteTask(mFrameTimeMillis));
+            }
+            if (mScreen == null) {
+                return;
+            }
+
+            // 2. do input events
+            long start = FrameProfiler.begin();
+            mRoot.doProcessInputEvents();
+            FrameProfiler.end(FrameProfiler.UI_INPUT, start);
+
+            // 3. do animations
+            start = FrameProfiler.begin();
+            mAnimationCallback.accept(mFrameTimeMillis);
+            FrameProfiler.end(FrameProfiler.UI_ANIMATION, start);
+
+            // 4. do traversal, layout and record are profiled inside
+            mRoot.doTraversal();
+            FrameProfiler.endUiFrame();
+
+            // test stuff
+            /*Paint paint = Paint.take();
+            paint.setStrokeWidth(6);
+            int c = (int) mElapsedTimeMillis / 300;
+            c = Math.min(c, 8);
+            float[] pts = new float[c * 2 + 2];
+            pts[0] = 90;
+            pts[1] = 30;
+            for (int i = 0; i < c; i++) {
+                pts[2 + i * 2] = Math.min((i + 2) * 60, mElapsedTimeMillis / 5) + 30;
+                if ((i & 1) == 0) {
+                    if (mElapsedTimeMillis >= (i + 2) * 300) {
+                        pts[3 + i * 2] = 90;
                     } else {
-                        if (mElapsedTimeMillis >= (i + 2) * 300) {
-                            pts[3 + i * 2] = 30;
-                        } else {
-                            pts[3 + i * 2] = 90 - (mElapsedTimeMillis % 300) / 5f;
-                        }
+                        pts[3 + i * 2] = 30 + (mElapsedTimeMillis % 300) / 5f;
+                    }
+                } else {
+                    if (mElapsedTimeMillis >= (i + 2) * 300) {
+                        pts[3 + i * 2] = 30;
+                    } else {
+                        pts[3 + i * 2] = 90 - (mElapsedTimeMillis % 300) / 5f;
                     }
                 }
-                mCanvas.drawStripLines(pts, paint);
-
-                paint.setRGBA(255, 180, 100, 255);
-                mCanvas.drawCircle(90, 30, 6, paint);
-                mCanvas.drawCircle(150, 90, 6, paint);
-                mCanvas.drawCircle(210, 30, 6, paint);
-                mCanvas.drawCircle(270, 90, 6, paint);
-                mCanvas.drawCircle(330, 30, 6, paint);
-                mCanvas.drawCircle(390, 90, 6, paint);
-                mCanvas.drawCircle(450, 30, 6, paint);
-                mCanvas.drawCircle(510, 90, 6, paint);
-                mCanvas.drawCircle(570, 30, 6, paint);*/
             }
+            mCanvas.drawStripLines(pts, paint);
+
+            paint.setRGBA(255, 180, 100, 255);
+            mCanvas.drawCircle(90, 30, 6, paint);
+            mCanvas.drawCircle(150, 90, 6, paint);
+            mCanvas.drawCircle(210, 30, 6, paint);
+            mCanvas.drawCircle(270, 90, 6, paint);
+            mCanvas.drawCircle(330, 30, 6, paint);
+            mCanvas.drawCircle(390, 90, 6, paint);
+            mCanvas.drawCircle(450, 30, 6, paint);
+            mCanvas.drawCircle(510, 90, 6, paint);
+            mCanvas.drawCircle(570, 30, 6, paint);*/
         }
     }
 
@@ -399,7 +420,11 @@ public final class UIManager implements ViewRootImpl.Handler {
     }
 
     void onMouseButton() {
-        mRoot.enqueueInputEvent(mPendingMouseEvent);
+        // the event is recycled after processing, never enqueue it twice
+        if (mPendingMouseEvent != null) {
+            mRoot.enqueueInputEvent(mPendingMouseEvent);
+            mPendingMouseEvent = null;
+        }
     }
 
     // Internal method
@@ -516,26 +541,52 @@ public final class UIManager implements ViewRootImpl.Handler {
             mProjectionChanged = false;
         }
 
-        // wait UI thread, if slow
-        synchronized (mRenderLock) {
-            if (mRoot.isReadyForRendering()) {
-                final int oldVertexArray = glGetInteger(GL_VERTEX_ARRAY_BINDING);
-                final int oldProgram = glGetInteger(GL_CURRENT_PROGRAM);
-                glEnable(GL_STENCIL_TEST);
-
-                framebuffer.resize(width, height);
-                framebuffer.clearColorBuffer();
-                framebuffer.clearDepthStencilBuffer();
-                framebuffer.bindDraw();
-                // flush tasks from UI thread, such as texture uploading
-                RenderCore.flushRenderCalls();
-                canvas.render();
-
-                glBindVertexArray(oldVertexArray);
-                glUseProgram(oldProgram);
-                glDisable(GL_STENCIL_TEST);
+        // stream async images whether there's a new frame or not
+        TextureManager.getINSTANCE().processUploads();
+
+        // never wait UI thread, if there's no new frame, the last one is kept
+        final Rect dirty = mDirtyRegion;
+        if (canvas.beginFrame(dirty)) {
+            final int oldVertexArray = glGetInteger(GL_VERTEX_ARRAY_BINDING);
+            final int oldProgram = glGetInteger(GL_CURRENT_PROGRAM);
+            glEnable(GL_STENCIL_TEST);
+
+            if (framebuffer.resize(width, height)) {
+                // contents are lost
+                dirty.set(0, 0, width, height);
             }
+            // only clear and redraw the damaged region, stencil too
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(dirty.left, height - dirty.bottom, dirty.width(), dirty.height());
+            framebuffer.clearColorBuffer();
+            framebuffer.clearDepthStencilBuffer();
+            framebuffer.bindDraw();
+            // flush tasks from UI thread, such as texture uploading
+            long start = FrameProfiler.begin();
+            RenderCore.flushRenderCalls();
+            FrameProfiler.end(FrameProfiler.RENDER_FLUSH, start);
+            start = FrameProfiler.begin();
+            FrameProfiler.beginGpu();
+            canvas.render();
+            FrameProfiler.endGpu();
+            FrameProfiler.end(FrameProfiler.RENDER_CANVAS, start);
+            glDisable(GL_SCISSOR_TEST);
+
+            if (sShowDirtyRegions && !dirty.isEmpty()) {
+                mDirtyFlashes.add(new DirtyFlash(dirty, RenderCore.timeMillis()));
+            }
+
+            glBindVertexArray(oldVertexArray);
+            glUseProgram(oldProgram);
+            glDisable(GL_STENCIL_TEST);
+            mHasFrame = true;
+        } else if (!mHasFrame) {
+            // no frame was submitted yet, nothing to keep or composite
+            RenderSystem.defaultBlendFunc();
+            FrameProfiler.endRenderFrame();
+            return;
         }
+        final long compositeStart = FrameProfiler.begin();
         int texture = framebuffer.getAttachedTexture(GL_COLOR_ATTACHMENT0).get();
 
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, minecraft.getMainRenderTarget().frameBufferId);
@@ -558,10 +609,51 @@ public final class UIManager implements ViewRootImpl.Handler {
         tesselator.end();
         RenderSystem.bindTexture(DEFAULT_TEXTURE);
 
+        if (!mDirtyFlashes.isEmpty()) {
+            drawDirtyFlashes(tesselator);
+        }
+
         GlStateManager._loadIdentity();
         GlStateManager._ortho(0.0D, width / mWindow.getGuiScale(), height / mWindow.getGuiScale(),
                 0.0D, 1000.0D, 3000.0D);
         GlStateManager._matrixMode(5888);
+        FrameProfiler.end(FrameProfiler.RENDER_COMPOSITE, compositeStart);
+        FrameProfiler.endRenderFrame();
+    }
+
+    // debug overlay, fading out
+    private void drawDirtyFlashes(@Nonnull Tesselator tesselator) {
+        RenderSystem.disableTexture();
+        BufferBuilder builder = tesselator.getBuilder();
+        builder.begin(GL_QUADS, DefaultVertexFormat.POSITION_COLOR);
+        final long time = RenderCore.timeMillis();
+        for (Iterator<DirtyFlash> it = mDirtyFlashes.iterator(); it.hasNext(); ) {
+            DirtyFlash flash = it.next();
+            long elapsed = time - flash.mTime;
+            if (elapsed >= DIRTY_FLASH_DURATION) {
+                it.remove();
+                continue;
+            }
+            int alpha = (int) (96 * (DIRTY_FLASH_DURATION - elapsed) / DIRTY_FLASH_DURATION);
+            Rect r = flash.mBounds;
+            builder.vertex(r.left, r.bottom, 0).color(255, 0, 64, alpha).endVertex();
+            builder.vertex(r.right, r.bottom, 0).color(255, 0, 64, alpha).endVertex();
+            builder.vertex(r.right, r.top, 0).color(255, 0, 64, alpha).endVertex();
+            builder.vertex(r.left, r.top, 0).color(255, 0, 64, alpha).endVertex();
+        }
+        tesselator.end();
+        RenderSystem.enableTexture();
+    }
+
+    private static class DirtyFlash {
+
+        private final Rect mBounds;
+        private final long mTime;
+
+        private DirtyFlash(@Nonnull Rect bounds, long time) {
+            mBounds = bounds.copy();
+            mTime = time;
+        }
     }
 
     @SubscribeEvent
@@ -573,6 +665,8 @@ public final class UIManager implements ViewRootImpl.Handler {
             case ALL:
                 // hotfix 1.16 vanilla, using shader makes TEXTURE_2D disabled
                 RenderSystem.enableTexture();
+                // the world has been rendered, blur it before the HUD
+                BlurHandler.INSTANCE.drawBlurredWorld();
                 break;
             /*case HEALTH:
                 if (TestHUD.sBars)
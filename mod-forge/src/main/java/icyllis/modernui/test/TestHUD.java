@@ -32,6 +32,7 @@ import icyllis.modernui.graphics.math.TextAlign;
 import icyllis.modernui.mixin.AccessFoodData;
 import icyllis.modernui.math.MathUtil;
 import icyllis.modernui.math.Matrix4;
+import icyllis.modernui.platform.FrameProfiler;
 import net.minecraft.client.Minecraft;
 import net.minecraft.client.gui.GuiComponent;
 import net.minecraft.client.renderer.MultiBufferSource;
@@ -58,6 +59,10 @@ public class TestHUD {
 
     public static final TestHUD sInstance = new TestHUD();
 
+    // the number of draw calls of texts in the current frame and the last frame
+    private static int sTextDrawCalls;
+    private static int sLastTextDrawCalls;
+
     private final float[] mProj = new float[16];
 
     private final Animation mBarAlphaAnim;
@@ -67,6 +72,47 @@ public class TestHUD {
     private int mLastHunger;
     private int mLastAir;
 
+    /**
+     * Count a draw call of text rendering, for debugging batching.
+     */
+    public static void countTextDraw() {
+        sTextDrawCalls++;
+    }
+
+    /**
+     * @return the number of draw calls of text rendering in the last frame
+     */
+    public static int getTextDrawCalls() {
+        return sLastTextDrawCalls;
+    }
+
+    public static void nextFrame() {
+        sLastTextDrawCalls = sTextDrawCalls;
+        sTextDrawCalls = 0;
+    }
+
+    /**
+     * Adds the frame profiler results to the debug overlay, average and max over
+     * the recent frames in milliseconds.
+     *
+     * @param lines the lines of the overlay
+     */
+    public static void addProfilerLines(@Nonnull List<String> lines) {
+        for (int phase = 0; phase < FrameProfiler.PHASE_COUNT; phase++) {
+            lines.add(String.format("%s: %.2f / %.2f ms", FrameProfiler.getPhaseName(phase),
+                    FrameProfiler.getAverageTime(phase) / 1.0E6, FrameProfiler.getMaxTime(phase) / 1.0E6));
+        }
+        lines.add(String.format("Draw Calls: %d, Instances: %d (%d KB)",
+                FrameProfiler.getLastCount(FrameProfiler.DRAW_CALLS),
+                FrameProfiler.getLastCount(FrameProfiler.INSTANCES),
+                FrameProfiler.getLastCount(FrameProfiler.INSTANCE_BYTES) >> 10));
+        long hits = FrameProfiler.getLastCount(FrameProfiler.LAYOUT_HITS);
+        long total = hits + FrameProfiler.getLastCount(FrameProfiler.LAYOUT_MISSES);
+        lines.add(String.format("Glyph Misses: %d, Measure Cache: %.1f%%",
+                FrameProfiler.getLastCount(FrameProfiler.GLYPH_MISSES),
+                total == 0 ? 100.0 : hits * 100.0 / total));
+    }
+
     {
         mBarAlphaAnim = new Animation(5000)
                 .applyTo(new Applier(0.5f, 0.25f, () -> mBarAlpha, f -> mBarAlpha = f)
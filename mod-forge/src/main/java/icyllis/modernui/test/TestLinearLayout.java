@@ -95,37 +95,61 @@ public class TestLinearLayout extends LinearLayout {
         addView(new DView(Interpolator.DECELERATE, 0), new LinearLayout.LayoutParams(120, 40));
 
         //addView(new DView(ITimeInterpolator.VISCOUS_FLUID, 30), new LinearLayout.LayoutParams(60, 20));
-        cAnim = new Animation(200).applyTo(new Applier(20, 0, () -> c, v -> c = v).setInterpolator(Interpolator.DECELERATE));
+        cAnim = new Animation(200).applyTo(new Applier(20, 0, () -> c, v -> {
+            c = v;
+            invalidate();
+        }).setInterpolator(Interpolator.DECELERATE));
 
         circleAnimation1 = new Animation(600)
                 .applyTo(
-                        new Applier((float) Math.PI, (float) -Math.PI, () -> circleAcc1, v -> circleAcc1 = v)
+                        new Applier((float) Math.PI, (float) -Math.PI, () -> circleAcc1, v -> {
+                            circleAcc1 = v;
+                            invalidate();
+                        })
                                 .setInterpolator(Interpolator.ACCELERATE_DECELERATE)
                 );
         circleAnimation2 = new Animation(600)
                 .applyTo(
-                        new Applier((float) Math.PI, (float) -Math.PI, () -> circleAcc2, v -> circleAcc2 = v)
+                        new Applier((float) Math.PI, (float) -Math.PI, () -> circleAcc2, v -> {
+                            circleAcc2 = v;
+                            invalidate();
+                        })
                                 .setInterpolator(Interpolator.ACCELERATE_DECELERATE)
                 );
         circleAnimation3 = new Animation(600)
                 .applyTo(
-                        new Applier((float) Math.PI, (float) -Math.PI, () -> circleAcc3, v -> circleAcc3 = v)
+                        new Applier((float) Math.PI, (float) -Math.PI, () -> circleAcc3, v -> {
+                            circleAcc3 = v;
+                            invalidate();
+                        })
                                 .setInterpolator(Interpolator.ACCELERATE_DECELERATE)
                 );
         circleAnimation4 = new Animation(600)
                 .applyTo(
-                        new Applier((float) Math.PI, (float) -Math.PI, () -> circleAcc4, v -> circleAcc4 = v)
+                        new Applier((float) Math.PI, (float) -Math.PI, () -> circleAcc4, v -> {
+                            circleAcc4 = v;
+                            invalidate();
+                        })
                                 .setInterpolator(Interpolator.ACCELERATE_DECELERATE)
                 );
         iconRadiusAni = new Animation(300)
-                .applyTo(new Applier(40, 80, () -> iconRadius, v -> iconRadius = v)
+                .applyTo(new Applier(40, 80, () -> iconRadius, v -> {
+                    iconRadius = v;
+                    invalidate();
+                })
                         .setInterpolator(Interpolator.DECELERATE));
 
         arcStartAni = new Animation(800)
-                .applyTo(new Applier(-90, 270, () -> arcStart, v -> arcStart = v)
+                .applyTo(new Applier(-90, 270, () -> arcStart, v -> {
+                    arcStart = v;
+                    invalidate();
+                })
                         .setInterpolator(Interpolator.DECELERATE));
         arcEndAni = new Animation(800)
-                .applyTo(new Applier(-90, 270, () -> arcEnd, v -> arcEnd = v)
+                .applyTo(new Applier(-90, 270, () -> arcEnd, v -> {
+                    arcEnd = v;
+                    invalidate();
+                })
                         .setInterpolator(Interpolator.ACCELERATE));
 
         ObjectAnimator anim = ObjectAnimator.ofFloat(this, sRoundRectLengthProp, 0, 80);
@@ -135,7 +159,10 @@ public class TestLinearLayout extends LinearLayout {
         mRoundRectLenAnim = anim;
 
         roundRectAlphaAni = new Animation(250)
-                .applyTo(new Applier(0, 1, () -> roundRectAlpha, v -> roundRectAlpha = v));
+                .applyTo(new Applier(0, 1, () -> roundRectAlpha, v -> {
+                    roundRectAlpha = v;
+                    invalidate();
+                }));
     }
 
     private static final FloatProperty<TestLinearLayout> sRoundRectLengthProp = new FloatProperty<>() {
@@ -345,7 +372,10 @@ public class TestLinearLayout extends LinearLayout {
         public DView(Interpolator interpolator, int offset) {
             this.offset = offset;
             animation = new Animation(200)
-                    .applyTo(new Applier(0, 60, () -> offsetY, v -> offsetY = v).setInterpolator(interpolator));
+                    .applyTo(new Applier(0, 60, () -> offsetY, v -> {
+                        offsetY = v;
+                        invalidate();
+                    }).setInterpolator(interpolator));
             animation.invertFull();
         }
 
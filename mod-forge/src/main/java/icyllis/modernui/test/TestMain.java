@@ -34,6 +34,7 @@ import icyllis.modernui.graphics.shader.ShaderManager;
 import icyllis.modernui.graphics.texture.Texture2D;
 import icyllis.modernui.math.MathUtil;
 import icyllis.modernui.math.Matrix4;
+import icyllis.modernui.math.Rect;
 import icyllis.modernui.math.Vector3;
 import icyllis.modernui.platform.Bitmap;
 import icyllis.modernui.platform.RenderCore;
@@ -296,8 +297,12 @@ public class TestMain {
                         canvas.drawLine(20, 20, 140, 60, paint);
                         canvas.drawLine(120, 30, 60, 80, paint);
 
-                        // render thread, wait UI thread
-                        canvas.render();
+                        // render thread, records and renders on the same thread
+                        Rect dirty = new Rect(0, 0, window.getWidth(), window.getHeight());
+                        canvas.submitFrame(dirty);
+                        if (canvas.beginFrame(dirty)) {
+                            canvas.render();
+                        }
 
                         /*GL11.glMatrixMode(GL11.GL_PROJECTION);
                         GL43.glPushMatrix();
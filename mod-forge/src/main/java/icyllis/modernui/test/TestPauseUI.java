@@ -99,7 +99,10 @@ public class TestPauseUI extends ScreenCallback {
         private float a = 0;
 
         public NavigationBar() {
-            new Animation(200).applyTo(new Applier(0, 0.51f, () -> a, v -> a = v)).start();
+            new Animation(200).applyTo(new Applier(0, 0.51f, () -> a, v -> {
+                a = v;
+                invalidate();
+            })).start();
         }
 
         @Override
@@ -18,7 +18,7 @@
 
 package icyllis.modernui.textmc;
 
-import icyllis.modernui.textmc.pipeline.GlyphRender;
+import icyllis.modernui.textmc.pipeline.TextRenderNode;
 import net.minecraft.client.ComponentCollector;
 import net.minecraft.client.Minecraft;
 import net.minecraft.client.StringSplitter;
@@ -132,24 +132,15 @@ public class ModernStringSplitter extends StringSplitter {
         if (text.length() == 0) {
             return 0;
         }
-        /* The glyph array for a string is sorted by the string's logical character position */
-        GlyphRender[] glyphs = mFontEngine.lookupVanillaNode(text, style).glyphs;
-
-        /* Add up the individual advance of each glyph until it exceeds the specified width */
-        float advance = 0;
-        int glyphIndex = 0;
-        while (glyphIndex < glyphs.length) {
+        return sizeToWidth0(mFontEngine.lookupVanillaNode(text, style), text, width);
+    }
 
-            advance += glyphs[glyphIndex].getAdvance();
-            if (advance <= width) {
-                glyphIndex++;
-            } else {
-                break;
-            }
-        }
+    private static int sizeToWidth0(@Nonnull TextRenderNode node, @Nonnull CharSequence text, float width) {
+        /* The glyph array for a string is sorted by the string's logical character position */
+        int glyphIndex = node.breakForward(width);
 
         /* The string index of the last glyph that wouldn't fit gives the total desired length of the string in characters */
-        return glyphIndex < glyphs.length ? glyphs[glyphIndex].stringIndex : text.length();
+        return node.getStringIndex(glyphIndex, text.length());
     }
 
     /**
@@ -181,23 +172,11 @@ public class ModernStringSplitter extends StringSplitter {
             return text;
         }
         /* The glyph array for a string is sorted by the string's logical character position */
-        GlyphRender[] glyphs = mFontEngine.lookupVanillaNode(text, style).glyphs;
-
-        /* Add up the individual advance of each glyph until it exceeds the specified width */
-        float advance = 0;
-        int glyphIndex = glyphs.length - 1;
-        while (glyphIndex >= 0) {
-
-            advance += glyphs[glyphIndex].getAdvance();
-            if (advance <= width) {
-                glyphIndex--;
-            } else {
-                break;
-            }
-        }
+        TextRenderNode node = mFontEngine.lookupVanillaNode(text, style);
+        int glyphIndex = node.breakBackward(width);
 
         /* The string index of the last glyph that wouldn't fit gives the total desired length of the string in characters */
-        int l = glyphIndex >= 0 ? glyphs[glyphIndex].stringIndex : 0;
+        int l = glyphIndex >= 0 ? node.getStringIndex(glyphIndex, text.length()) : 0;
         return text.substring(l);
     }
 
@@ -214,10 +193,14 @@ public class ModernStringSplitter extends StringSplitter {
         v.setValue(width);
         // iterate all siblings
         return text.visit((s, t) -> {
-            if (sizeToWidth0(t, v.floatValue(), s) < t.length()) {
+            if (t.isEmpty()) {
+                return Optional.empty();
+            }
+            TextRenderNode node = mFontEngine.lookupVanillaNode(t, s);
+            if (sizeToWidth0(node, t, v.floatValue()) < t.length()) {
                 return Optional.of(s);
             }
-            v.subtract(mFontEngine.lookupVanillaNode(t, s).advance);
+            v.subtract(node.advance);
             // continue
             return Optional.empty();
         }, Style.EMPTY).orElse(null);
@@ -237,12 +220,16 @@ public class ModernStringSplitter extends StringSplitter {
         MutableObject<Style> sr = new MutableObject<>();
         // iterate all siblings
         if (!mFontEngine.handleSequence(text, (t, s) -> {
-            if (sizeToWidth0(t, v.floatValue(), s) < t.length()) {
+            if (t.length() == 0) {
+                return false;
+            }
+            TextRenderNode node = mFontEngine.lookupVanillaNode(t, s);
+            if (sizeToWidth0(node, t, v.floatValue()) < t.length()) {
                 sr.setValue(s);
                 // break with result
                 return true;
             }
-            v.subtract(mFontEngine.lookupVanillaNode(t, s).advance);
+            v.subtract(node.advance);
             // continue
             return false;
         })) {
@@ -259,7 +246,6 @@ public class ModernStringSplitter extends StringSplitter {
      * @param styleIn the default style of the text
      * @return the trimmed multi text
      */
-    //TODO further optimization is possible
     @Nonnull
     @Override
     public FormattedText headByWidth(@Nonnull FormattedText textIn, int width, @Nonnull Style styleIn) {
@@ -267,8 +253,12 @@ public class ModernStringSplitter extends StringSplitter {
         v.setValue(width);
         // iterate all siblings
         return textIn.visit((style, text) -> {
+            if (text.isEmpty()) {
+                return Optional.empty();
+            }
+            TextRenderNode node = mFontEngine.lookupVanillaNode(text, style);
             int size;
-            if ((size = sizeToWidth0(text, v.floatValue(), style)) < text.length()) {
+            if ((size = sizeToWidth0(node, text, v.floatValue())) < text.length()) {
                 String sub = text.substring(0, size);
                 if (!sub.isEmpty()) {
                     // add
@@ -277,11 +267,9 @@ public class ModernStringSplitter extends StringSplitter {
                 // combine and break
                 return Optional.of(collector.getResultOrEmpty());
             }
-            if (!text.isEmpty()) {
-                // add
-                collector.append(FormattedText.of(text, style));
-            }
-            v.subtract(mFontEngine.lookupVanillaNode(text, style).advance);
+            // add
+            collector.append(FormattedText.of(text, style));
+            v.subtract(node.advance);
             // continue
             return Optional.empty();
         }, styleIn).orElse(textIn); // full text
@@ -79,6 +79,6 @@ public class MutableString implements CharSequence {
     @Nonnull
     @Override
     public String toString() {
-        return new String(chars.toCharArray());
+        return new String(chars.elements(), 0, chars.size());
     }
 }
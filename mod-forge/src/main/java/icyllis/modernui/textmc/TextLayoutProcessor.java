@@ -20,15 +20,21 @@ package icyllis.modernui.textmc;
 
 import com.github.benmanes.caffeine.cache.Cache;
 import com.github.benmanes.caffeine.cache.Caffeine;
+import com.github.benmanes.caffeine.cache.stats.CacheStats;
 import com.ibm.icu.text.Bidi;
 import com.mojang.blaze3d.systems.RenderSystem;
 import icyllis.modernui.ModernUI;
 import icyllis.modernui.graphics.font.GlyphManagerForge;
+import icyllis.modernui.graphics.font.LayoutCache;
+import icyllis.modernui.graphics.font.ShapedRun;
+import icyllis.modernui.graphics.font.ShapingCache;
 import icyllis.modernui.graphics.font.TexturedGlyph;
 import icyllis.modernui.graphics.math.Color3i;
 import icyllis.modernui.mixin.MixinClientLanguage;
+import icyllis.modernui.platform.FrameProfiler;
 import icyllis.modernui.platform.RenderCore;
 import icyllis.modernui.text.FontCollection;
+import icyllis.modernui.text.GraphemeBreak;
 import icyllis.modernui.textmc.pipeline.*;
 import net.minecraft.ChatFormatting;
 import net.minecraft.client.Minecraft;
@@ -39,7 +45,6 @@ import javax.annotation.Nonnull;
 import javax.annotation.Nullable;
 import java.awt.*;
 import java.awt.font.GlyphVector;
-import java.awt.geom.Point2D;
 import java.lang.ref.WeakReference;
 import java.util.ArrayList;
 import java.util.Arrays;
@@ -68,6 +73,16 @@ public class TextLayoutProcessor {
      */
     public static int sDefaultFontSize;
 
+    /**
+     * Config value, true to consider all ASCII digits equal when caching layouts, the digit glyphs
+     * are substituted when drawing. Strings that differ only in their digits, such as counters and
+     * coordinates, then share a single layout.
+     *
+     * @see VanillaTextKey
+     * @see DigitGlyphRender
+     */
+    public static boolean sFoldDigits = true;
+
 
     /**
      * Draw and cache all glyphs of all fonts needed
@@ -90,8 +105,20 @@ public class TextLayoutProcessor {
      */
     //private WeakHashMap<String, Key> weakRefCache = new WeakHashMap<>();
 
+    /**
+     * The max total weight of cached layouts, each glyph has a weight of 1.
+     */
+    public static final int MAX_CACHE_WEIGHT = 1 << 18;
+
+    /**
+     * Cached layouts are immutable and shared by all renderers. The cache is bounded by the number of glyphs
+     * rather than the number of entries, because chat lines and scoreboard entries differ greatly in length.
+     */
     private final Cache<VanillaTextKey, TextRenderNode> stringCache = Caffeine.newBuilder()
             .expireAfterAccess(20, TimeUnit.SECONDS)
+            .maximumWeight(MAX_CACHE_WEIGHT)
+            .weigher((VanillaTextKey k, TextRenderNode v) -> v.glyphs.length + 1)
+            .recordStats()
             .build();
 
     /**
@@ -101,16 +128,16 @@ public class TextLayoutProcessor {
      */
     private final VanillaTextKey lookupKey = new VanillaTextKey();
 
+    /**
+     * The digit mode of cached layouts, a snapshot of {@link #sFoldDigits}.
+     */
+    private boolean foldDigits = true;
+
     private final Object lock = new Object();
 
     // for async result
     private final AtomicReference<TextRenderNode> atomicNode = new AtomicReference<>();
 
-    /*
-     * True if digitGlyphs[] has been assigned and cacheString() can begin replacing all digits with '0' in the string.
-     */
-    //private boolean digitGlyphsReady = false;
-
     /**
      * Cache temporary processing results
      */
@@ -128,11 +155,6 @@ public class TextLayoutProcessor {
      * string width to this class.
      */
     private TextLayoutProcessor() {
-        /* StringCache is created by the main game thread; remember it for later thread safety checks */
-        //mainThread = Thread.currentThread();
-
-        /* Pre-cache the ASCII digits to allow for fast glyph substitution */
-        //cacheDigitGlyphs();
     }
 
     /**
@@ -151,28 +173,6 @@ public class TextLayoutProcessor {
         return instance;
     }
 
-    /**
-     * Pre-cache the ASCII digits to allow for fast glyph substitution. Called once from the constructor and called any time the font selection
-     * changes at runtime via setDefaultFont().
-     * <p>
-     * Pre-cached glyphs for the ASCII digits 0-9 (in that order). Used by renderString() to substitute digit glyphs on the fly
-     * as a performance boost. The speed up is most noticeable on the F3 screen which rapidly displays lots of changing numbers.
-     * The 4 element array is index by the font style (combination of Font.PLAIN, Font.BOLD, and Font.ITALIC), and each of the
-     * nested elements is index by the digit value 0-9.
-     *
-     * @deprecated {@link GlyphManagerForge#lookupDigits(Font)}
-     */
-    @Deprecated
-    private void cacheDigitGlyphs() {
-        /* Need to cache each font style combination; the digitGlyphsReady = false disabled the normal glyph substitution mechanism */
-        //digitGlyphsReady = false;
-        /*digitGlyphs[FormattingCode.PLAIN] = getOrCacheString("0123456789").glyphs;
-        digitGlyphs[FormattingCode.BOLD] = getOrCacheString("\u00a7l0123456789").glyphs;
-        digitGlyphs[FormattingCode.ITALIC] = getOrCacheString("\u00a7o0123456789").glyphs;
-        digitGlyphs[FormattingCode.BOLD | FormattingCode.ITALIC] = getOrCacheString("\u00a7l\u00a7o0123456789").glyphs;*/
-        //digitGlyphsReady = true;
-    }
-
     public void initRenderer() {
         if (glyphManager == null) {
             glyphManager = GlyphManagerForge.getInstance();
@@ -187,6 +187,8 @@ public class TextLayoutProcessor {
      */
     public void reload() {
         glyphManager.reload();
+        ShapingCache.clear();
+        LayoutCache.clear();
         clearLayoutCache();
     }
 
@@ -194,6 +196,32 @@ public class TextLayoutProcessor {
         stringCache.invalidateAll();
     }
 
+    /**
+     * Returns the statistics of the layout cache since it was created, for debug info.
+     *
+     * @return a snapshot of cache stats
+     */
+    @Nonnull
+    public CacheStats getCacheStats() {
+        return stringCache.stats();
+    }
+
+    /**
+     * @return the approximate number of cached layouts
+     */
+    public long getCacheSize() {
+        return stringCache.estimatedSize();
+    }
+
+    /**
+     * @return the total weight (the number of glyphs) of cached layouts
+     */
+    public long getCacheWeight() {
+        return stringCache.policy().eviction()
+                .map(e -> e.weightedSize().orElse(0))
+                .orElse(0L);
+    }
+
     /**
      * Minecraft gives us a deeply processed sequence, so we have to make the
      * it not a reordered text, see {@link MixinClientLanguage}.
@@ -216,10 +244,19 @@ public class TextLayoutProcessor {
      */
     @Nonnull
     public TextRenderNode lookupVanillaNode(@Nonnull CharSequence string, @Nonnull Style style) {
-        lookupKey.updateKey(string, style);
+        if (sFoldDigits != foldDigits) {
+            // layouts of the other mode have different glyphs
+            clearLayoutCache();
+            foldDigits = sFoldDigits;
+        }
+        lookupKey.updateKey(string, style, foldDigits);
         TextRenderNode node = stringCache.getIfPresent(lookupKey);
-        if (node == null)
+        // glyphs of a cached layout may refer to evicted atlas pages, then lay it out again
+        if (node == null || !node.validate(glyphManager)) {
+            FrameProfiler.count(FrameProfiler.LAYOUT_MISSES, 1);
             return generateVanillaNode(lookupKey.copy(), string, style);
+        }
+        FrameProfiler.count(FrameProfiler.LAYOUT_HITS, 1);
         return node;
     }
 
@@ -471,6 +508,8 @@ public class TextLayoutProcessor {
         }
 
         final TextProcessData data = this.data;
+        // glyphs obtained from now on are valid at this generation
+        final int generation = glyphManager.getGeneration();
 
         /* Step 1 */
         char[] text = resolveFormattingCodes(data, string, style);
@@ -495,7 +534,7 @@ public class TextLayoutProcessor {
                 GlyphRender[] glyphs = data.wrapGlyphs();
 
                 /* Step 9 */
-                node = new TextRenderNode(glyphs, data.advance, data.hasEffect);
+                node = new TextRenderNode(glyphs, data.advance, data.hasEffect, generation);
             }
         }
 
@@ -696,8 +735,9 @@ public class TextLayoutProcessor {
      * @see #layoutStyle(TextProcessData, char[], int, int, int)
      */
     private void startBidiAnalysis(TextProcessData data, @Nonnull char[] text) {
-        /* Avoid performing full bidirectional analysis if text has no "strong" right-to-left characters */
-        if (Bidi.requiresBidi(text, 0, text.length)) {
+        /* Avoid performing full bidirectional analysis if text has no "strong" right-to-left characters,
+         * and most texts are simple Latin, they can be detected much faster than requiresBidi() */
+        if (!GraphemeBreak.isSimpleText(text, 0, text.length) && Bidi.requiresBidi(text, 0, text.length)) {
             /* Note that while requiresBidi() uses start/limit the Bidi constructor uses start/length */
             Bidi bidi = new Bidi(text, 0, null, 0, text.length, Bidi.DIRECTION_DEFAULT_LEFT_TO_RIGHT);
 
@@ -813,13 +853,13 @@ public class TextLayoutProcessor {
         /*
          * Convert all digits in the string to a '0' before layout to ensure that any glyphs replaced on the fly will all have
          * the same positions. Under Windows, Java's "SansSerif" logical font uses the "Arial" font for digits, in which the "1"
-         * digit is slightly narrower than all other digits. Checking the digitGlyphsReady flag prevents a chicken-and-egg
-         * problem where the digit glyphs have to be initially cached and the digitGlyphs[] array initialized without replacing
-         * every digit with '0'. Digits are not on SMP.
+         * digit is slightly narrower than all other digits. Digits are not on SMP.
          */
-        for (int i = start; i < limit; i++) {
-            if (text[i] <= '9' && text[i] >= '0') {
-                text[i] = '0';
+        if (foldDigits) {
+            for (int i = start; i < limit; i++) {
+                if (text[i] <= '9' && text[i] >= '0') {
+                    text[i] = '0';
+                }
             }
         }
 
@@ -903,10 +943,11 @@ public class TextLayoutProcessor {
             layoutRandom(data, text, start, limit, flag, font, effect);
         } else {
             /* The glyphCode matched to the same codePoint is specified in the font, they are different in different font */
-            GlyphVector vector = glyphManager.layoutGlyphVector(font, text, start, limit, flag);
-            int num = vector.getNumGlyphs();
+            ShapedRun run = glyphManager.shape(font, text, start, limit, flag);
+            int num = run.getGlyphCount();
 
-            final TexturedGlyph[] digits = glyphManager.lookupDigits(font);
+            // lazily, most fonts in fallback are never used to draw digits
+            TexturedGlyph[] digits = null;
             final float factor = glyphManager.getResolutionFactor();
 
             for (int i = 0; i < num; i++) {
@@ -918,10 +959,9 @@ public class TextLayoutProcessor {
                     continue;
                 }*/
 
-                int stripIndex = vector.getGlyphCharIndex(i) + start;
-                Point2D point = vector.getGlyphPosition(i);
+                int stripIndex = run.getCharIndex(i) + start;
 
-                float offset = (float) (point.getX() / factor);
+                float offset = run.getPosition(i) / factor;
 
                 if (flag == Font.LAYOUT_RIGHT_TO_LEFT) {
                     offset += data.layoutRight;
@@ -931,18 +971,21 @@ public class TextLayoutProcessor {
 
                 char o = text[stripIndex];
                 /* Digits are not on SMP */
-                if (o == '0') {
+                if (o == '0' && foldDigits) {
+                    if (digits == null) {
+                        digits = glyphManager.lookupDigits(font);
+                    }
                     data.minimalList.add(new DigitGlyphRender(digits, effect, stripIndex, offset));
                     continue;
                 }
 
-                int glyphCode = vector.getGlyphCode(i);
+                int glyphCode = run.getGlyphCode(i);
                 TexturedGlyph glyph = glyphManager.lookupGlyph(font, glyphCode);
 
                 data.minimalList.add(new StandardGlyphRender(glyph, effect, stripIndex, offset));
             }
 
-            float totalAdvance = (float) (vector.getGlyphPosition(num).getX() / factor);
+            float totalAdvance = run.getAdvance() / factor;
             data.advance += totalAdvance;
 
             if (flag == Font.LAYOUT_RIGHT_TO_LEFT) {
@@ -52,6 +52,13 @@ public class VanillaTextKey {
      */
     private int style;
 
+    /**
+     * True if ASCII digits are considered equal
+     *
+     * @see TextLayoutProcessor#sFoldDigits
+     */
+    private boolean foldDigits;
+
     /**
      * Cached hash code, default is 0
      */
@@ -64,22 +71,25 @@ public class VanillaTextKey {
     /**
      * Copy constructor
      */
-    private VanillaTextKey(@Nonnull CharSequence str, int style, int hash) {
+    private VanillaTextKey(@Nonnull CharSequence str, int style, boolean foldDigits, int hash) {
         this.str = str.toString(); // copy to String
         this.style = style;
+        this.foldDigits = foldDigits;
         this.hash = hash;
     }
 
     /**
      * Update current str and style value, parse vanilla's style to an integer
      *
-     * @param str   raw formatted string
-     * @param style text component style
+     * @param str        raw formatted string
+     * @param style      text component style
+     * @param foldDigits true to consider all ASCII digits equal
      */
-    public void updateKey(CharSequence str, @Nonnull Style style) {
+    public void updateKey(CharSequence str, @Nonnull Style style, boolean foldDigits) {
         this.str = str;
         // text formatting may render same as style, but we can't separate them easily
         this.style = hashStyle(style);
+        this.foldDigits = foldDigits;
         hash = 0;
     }
 
@@ -125,6 +135,9 @@ public class VanillaTextKey {
         if (style != (((VanillaTextKey) o).style))
             return false;
 
+        if (foldDigits != ((VanillaTextKey) o).foldDigits)
+            return false;
+
         /* Calling toString on a String object simply returns itself so no new object allocation is performed */
         final CharSequence other = ((VanillaTextKey) o).str;
         final int length = str.length();
@@ -146,7 +159,7 @@ public class VanillaTextKey {
             c1 = str.charAt(index);
             c2 = other.charAt(index);
 
-            if (c1 != c2 && (c1 > '9' || c1 < '0' || formatting || c2 > '9' || c2 < '0'))
+            if (c1 != c2 && (!foldDigits || c1 > '9' || c1 < '0' || formatting || c2 > '9' || c2 < '0'))
                 return false;
             formatting = (c1 == '\u00a7');
         }
@@ -177,7 +190,7 @@ public class VanillaTextKey {
 
             for (int index = 0; index < length; index++) {
                 c = str.charAt(index);
-                if (c <= '9' && c >= '0' && !formatting)
+                if (foldDigits && c <= '9' && c >= '0' && !formatting)
                     c = '0';
                 code = code * 31 + c;
                 formatting = (c == '\u00a7');
@@ -205,6 +218,6 @@ public class VanillaTextKey {
      * @return copied key
      */
     public VanillaTextKey copy() {
-        return new VanillaTextKey(str, style, hash);
+        return new VanillaTextKey(str, style, foldDigits, hash);
     }
 }
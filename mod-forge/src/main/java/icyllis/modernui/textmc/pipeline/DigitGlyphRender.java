@@ -18,13 +18,8 @@
 
 package icyllis.modernui.textmc.pipeline;
 
-import com.mojang.blaze3d.vertex.BufferBuilder;
-import com.mojang.blaze3d.vertex.BufferUploader;
-import com.mojang.blaze3d.vertex.DefaultVertexFormat;
-import com.mojang.math.Matrix4f;
+import icyllis.modernui.graphics.font.GlyphManagerForge;
 import icyllis.modernui.graphics.font.TexturedGlyph;
-import net.minecraft.client.renderer.MultiBufferSource;
-import org.lwjgl.opengl.GL11;
 
 import javax.annotation.Nonnull;
 
@@ -43,22 +38,25 @@ public class DigitGlyphRender extends GlyphRender {
         this.glyphs = glyphs;
     }
 
+    @Nonnull
     @Override
-    public void drawGlyph(@Nonnull BufferBuilder builder, @Nonnull String raw, float x, float y, int r, int g, int b, int a) {
-        builder.begin(GL11.GL_QUADS, DefaultVertexFormat.POSITION_COLOR_TEX);
-        glyphs[raw.charAt(stringIndex) - 48].drawGlyph(builder, x + offsetX, y, r, g, b, a);
-        builder.end();
-        BufferUploader.end(builder);
+    public TexturedGlyph getGlyph(@Nonnull CharSequence raw) {
+        return glyphs[raw.charAt(stringIndex) - 48];
     }
 
     @Override
-    public void drawGlyph(Matrix4f matrix, @Nonnull MultiBufferSource buffer, @Nonnull CharSequence raw, float x, float y, int r, int g, int b, int a, boolean seeThrough, int light) {
-        glyphs[raw.charAt(stringIndex) - 48].drawGlyph(matrix, buffer, x + offsetX, y, r, g, b, a, seeThrough, light);
+    public float getAdvance() {
+        return glyphs[0].getAdvance();
     }
 
     @Override
-    public float getAdvance() {
-        return glyphs[0].getAdvance();
+    public boolean isEvicted(@Nonnull GlyphManagerForge manager, int generation) {
+        for (TexturedGlyph glyph : glyphs) {
+            if (manager.isEvicted(glyph, generation)) {
+                return true;
+            }
+        }
+        return false;
     }
 
     /*@Override
@@ -18,11 +18,11 @@
 
 package icyllis.modernui.textmc.pipeline;
 
-import com.mojang.blaze3d.vertex.BufferBuilder;
 import com.mojang.blaze3d.vertex.VertexConsumer;
 import com.mojang.math.Matrix4f;
+import icyllis.modernui.graphics.font.GlyphManagerForge;
+import icyllis.modernui.graphics.font.TexturedGlyph;
 import icyllis.modernui.textmc.FormattingStyle;
-import net.minecraft.client.renderer.MultiBufferSource;
 
 import javax.annotation.Nonnull;
 
@@ -65,35 +65,24 @@ public abstract class GlyphRender {
     }
 
     /**
-     * Draw the glyph of this info.
+     * Get the textured glyph to draw. Glyphs are grouped by their textures and batched
+     * by the caller, see {@link TextRenderNode#drawText(com.mojang.blaze3d.vertex.BufferBuilder, String, float, float, int, int, int, int)}
      *
-     * @param builder vertex builder
-     * @param raw     needed by {@link DigitGlyphRender}
-     * @param x       start x of the whole text
-     * @param y       start y of the whole text
-     * @param r       final red
-     * @param g       final green
-     * @param b       final blue
-     * @param a       final alpha
+     * @param raw needed by {@link DigitGlyphRender}
+     * @return the glyph to draw
      */
-    public abstract void drawGlyph(@Nonnull BufferBuilder builder, @Nonnull String raw, float x, float y, int r, int g, int b, int a);
+    @Nonnull
+    public abstract TexturedGlyph getGlyph(@Nonnull CharSequence raw);
 
     /**
-     * Draw the glyph of this info.
+     * Returns whether any glyph that may be drawn was evicted since the given generation.
      *
-     * @param matrix     matrix
-     * @param buffer     buffer source
-     * @param raw        needed by {@link DigitGlyphRender}
-     * @param x          start x of the whole text
-     * @param y          start y of the whole text
-     * @param r          final red
-     * @param g          final green
-     * @param b          final blue
-     * @param a          final alpha
-     * @param seeThrough is see through type
-     * @param light      packed light
+     * @param manager    the glyph manager
+     * @param generation the generation when the glyphs were obtained
+     * @return true if the glyphs must be looked up again
+     * @see GlyphManagerForge#isEvicted(TexturedGlyph, int)
      */
-    public abstract void drawGlyph(Matrix4f matrix, @Nonnull MultiBufferSource buffer, @Nonnull CharSequence raw, float x, float y, int r, int g, int b, int a, boolean seeThrough, int light);
+    public abstract boolean isEvicted(@Nonnull GlyphManagerForge manager, int generation);
 
     /**
      * Draw the effect of this info
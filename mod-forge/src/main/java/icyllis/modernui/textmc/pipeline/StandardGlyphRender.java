@@ -18,13 +18,8 @@
 
 package icyllis.modernui.textmc.pipeline;
 
-import com.mojang.blaze3d.vertex.BufferBuilder;
-import com.mojang.blaze3d.vertex.BufferUploader;
-import com.mojang.blaze3d.vertex.DefaultVertexFormat;
-import com.mojang.math.Matrix4f;
+import icyllis.modernui.graphics.font.GlyphManagerForge;
 import icyllis.modernui.graphics.font.TexturedGlyph;
-import net.minecraft.client.renderer.MultiBufferSource;
-import org.lwjgl.opengl.GL11;
 
 import javax.annotation.Nonnull;
 
@@ -40,22 +35,20 @@ public class StandardGlyphRender extends GlyphRender {
         this.glyph = glyph;
     }
 
+    @Nonnull
     @Override
-    public void drawGlyph(@Nonnull BufferBuilder builder, @Nonnull String raw, float x, float y, int r, int g, int b, int a) {
-        builder.begin(GL11.GL_QUADS, DefaultVertexFormat.POSITION_COLOR_TEX);
-        glyph.drawGlyph(builder, x + offsetX, y, r, g, b, a);
-        builder.end();
-        BufferUploader.end(builder);
+    public TexturedGlyph getGlyph(@Nonnull CharSequence raw) {
+        return glyph;
     }
 
     @Override
-    public void drawGlyph(Matrix4f matrix, @Nonnull MultiBufferSource buffer, @Nonnull CharSequence raw, float x, float y, int r, int g, int b, int a, boolean seeThrough, int light) {
-        glyph.drawGlyph(matrix, buffer, x + offsetX, y, r, g, b, a, seeThrough, light);
+    public float getAdvance() {
+        return glyph.getAdvance();
     }
 
     @Override
-    public float getAdvance() {
-        return glyph.getAdvance();
+    public boolean isEvicted(@Nonnull GlyphManagerForge manager, int generation) {
+        return manager.isEvicted(glyph, generation);
     }
 
     /*public float drawString(@Nonnull BufferBuilder builder, @Nonnull String raw, int color, float x, float y, int r, int g, int b, int a) {
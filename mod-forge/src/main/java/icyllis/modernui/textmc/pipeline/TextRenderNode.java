@@ -25,11 +25,15 @@ import com.mojang.blaze3d.vertex.DefaultVertexFormat;
 import com.mojang.blaze3d.vertex.VertexConsumer;
 import com.mojang.math.Matrix4f;
 import icyllis.modernui.graphics.font.GlyphManagerForge;
+import icyllis.modernui.graphics.font.TexturedGlyph;
+import icyllis.modernui.test.TestHUD;
+import it.unimi.dsi.fastutil.ints.IntArrayList;
 import net.minecraft.client.renderer.MultiBufferSource;
 import net.minecraft.client.renderer.Sheets;
 import org.lwjgl.opengl.GL11;
 
 import javax.annotation.Nonnull;
+import java.util.Arrays;
 
 /**
  * The complete node, including final rendering results and layout information
@@ -39,7 +43,7 @@ public class TextRenderNode {
     /**
      * Sometimes naive, too simple
      */
-    public static final TextRenderNode EMPTY = new TextRenderNode(new GlyphRender[0], 0, false) {
+    public static final TextRenderNode EMPTY = new TextRenderNode(new GlyphRender[0], 0, false, 0) {
 
         @Override
         public float drawText(@Nonnull BufferBuilder builder, @Nonnull String raw, float x, float y, int r, int g, int b, int a) {
@@ -81,13 +85,122 @@ public class TextRenderNode {
 
     private final boolean hasEffect;
 
-    public TextRenderNode(GlyphRender[] glyphs, float advance, boolean hasEffect) {
+    /**
+     * Pre-baked quads for buffer source rendering, or null if there's no glyph.
+     */
+    private final TextVertexBlob blob;
+
+    /**
+     * Cumulative advances in logical order, the i-th element is the total advance of
+     * glyphs before the i-th glyph, the last element is the total.
+     */
+    private final float[] advances;
+
+    /**
+     * The glyph manager generation when glyphs were obtained or last validated.
+     */
+    private int generation;
+
+    // scratch arrays for immediate drawing, render thread only
+    private static TexturedGlyph[] sGlyphs = new TexturedGlyph[64];
+    private static int[] sColors = new int[64];
+    private static final IntArrayList sTextures = new IntArrayList();
+
+    public TextRenderNode(GlyphRender[] glyphs, float advance, boolean hasEffect, int generation) {
         this.glyphs = glyphs;
         //this.colors = colors;
         this.advance = advance;
         this.hasEffect = hasEffect;
+        blob = glyphs.length > 0 ? new TextVertexBlob(glyphs) : null;
+        advances = new float[glyphs.length + 1];
+        for (int i = 0; i < glyphs.length; i++) {
+            advances[i + 1] = advances[i] + glyphs[i].getAdvance();
+        }
+        this.generation = generation;
+    }
+
+    /**
+     * Checks whether glyphs of this node are still in the atlas. Only glyph pages evicted
+     * since the last check are considered, the node must be laid out again if it fails.
+     *
+     * @param manager the glyph manager
+     * @return true if this node can be drawn
+     */
+    public boolean validate(@Nonnull GlyphManagerForge manager) {
+        final int current = manager.getGeneration();
+        if (generation == current) {
+            return true;
+        }
+        for (GlyphRender glyph : glyphs) {
+            if (glyph.isEvicted(manager, generation)) {
+                return false;
+            }
+        }
+        generation = current;
+        return true;
+    }
+
+    /**
+     * Find the first glyph in logical order that makes the total advance from the start
+     * exceed the given width, using a binary search.
+     *
+     * @param width the max width
+     * @return the glyph index, or the number of glyphs if all glyphs fit
+     */
+    public int breakForward(float width) {
+        final float[] advances = this.advances;
+        int low = 0;
+        int high = glyphs.length;
+        while (low < high) {
+            int mid = (low + high) >>> 1;
+            if (advances[mid + 1] > width) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+        return low;
+    }
+
+    /**
+     * Find the last glyph in logical order that makes the total advance to the end
+     * exceed the given width, using a binary search.
+     *
+     * @param width the max width
+     * @return the glyph index, or -1 if all glyphs fit
+     */
+    public int breakBackward(float width) {
+        final float[] advances = this.advances;
+        final float total = advances[glyphs.length];
+        int low = 0;
+        int high = glyphs.length;
+        // find the first glyph that the rest fit
+        while (low < high) {
+            int mid = (low + high) >>> 1;
+            if (total - advances[mid] <= width) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+        return low - 1;
     }
 
+    /**
+     * Get the string index of a glyph, or the given length if out of range.
+     *
+     * @param glyphIndex the glyph index
+     * @param length     the length of the string
+     * @return the char index in the raw string
+     */
+    public int getStringIndex(int glyphIndex, int length) {
+        return glyphIndex < glyphs.length ? glyphs[glyphIndex].stringIndex : length;
+    }
+
+    /**
+     * Draw this text with the immediate builder. Glyphs are grouped by their atlas textures,
+     * and each group is uploaded and drawn at once rather than one draw call per glyph.
+     */
     public float drawText(@Nonnull BufferBuilder builder, @Nonnull String raw, float x, float y, int r, int g, int b, int a) {
         final int startR = r;
         final int startG = g;
@@ -97,7 +210,19 @@ public class TextRenderNode {
         x -= GlyphManagerForge.GLYPH_OFFSET;
         RenderSystem.enableTexture();
 
-        for (GlyphRender glyph : glyphs) {
+        final GlyphRender[] glyphs = this.glyphs;
+        final int count = glyphs.length;
+        if (sGlyphs.length < count) {
+            sGlyphs = new TexturedGlyph[count];
+            sColors = new int[count];
+        }
+        final TexturedGlyph[] textured = sGlyphs;
+        final int[] colors = sColors;
+        final IntArrayList textures = sTextures;
+
+        // resolve colors and glyphs first, obfuscated glyphs are random
+        for (int i = 0; i < count; i++) {
+            GlyphRender glyph = glyphs[i];
             if (glyph.color != GlyphRender.COLOR_NO_CHANGE) {
                 int color = glyph.color;
                 if (color == GlyphRender.USE_INPUT_COLOR) {
@@ -110,8 +235,32 @@ public class TextRenderNode {
                     b = color & 0xff;
                 }
             }
-            glyph.drawGlyph(builder, raw, x, y, r, g, b, a);
+            colors[i] = r << 16 | g << 8 | b;
+            TexturedGlyph t = glyph.getGlyph(raw);
+            textured[i] = t;
+            if (!textures.contains(t.getTexture())) {
+                textures.add(t.getTexture());
+            }
+        }
+
+        // there's usually only one texture
+        for (int k = 0, e = textures.size(); k < e; k++) {
+            final int texture = textures.getInt(k);
+            RenderSystem.bindTexture(texture);
+            builder.begin(GL11.GL_QUADS, DefaultVertexFormat.POSITION_COLOR_TEX);
+            for (int i = 0; i < count; i++) {
+                TexturedGlyph t = textured[i];
+                if (t.getTexture() == texture) {
+                    int color = colors[i];
+                    t.drawGlyph(builder, x + glyphs[i].offsetX, y, color >> 16 & 0xff, color >> 8 & 0xff, color & 0xff, a);
+                }
+            }
+            builder.end();
+            BufferUploader.end(builder);
+            TestHUD.countTextDraw();
         }
+        textures.clear();
+        Arrays.fill(textured, 0, count, null);
 
         if (hasEffect) {
             r = startR;
@@ -137,6 +286,7 @@ public class TextRenderNode {
             }
             builder.end();
             BufferUploader.end(builder);
+            TestHUD.countTextDraw();
         }
         return advance;
     }
@@ -153,25 +303,8 @@ public class TextRenderNode {
         y += VANILLA_BASELINE_OFFSET;
         x -= GlyphManagerForge.GLYPH_OFFSET;
 
-        for (GlyphRender glyph : glyphs) {
-            if (glyph.color != GlyphRender.COLOR_NO_CHANGE) {
-                int color = glyph.color;
-                if (color == GlyphRender.USE_INPUT_COLOR) {
-                    r = startR;
-                    g = startG;
-                    b = startB;
-                } else {
-                    r = color >> 16 & 0xff;
-                    g = color >> 8 & 0xff;
-                    b = color & 0xff;
-                    if (isShadow) {
-                        r >>= 2;
-                        g >>= 2;
-                        b >>= 2;
-                    }
-                }
-            }
-            glyph.drawGlyph(matrix, buffer, raw, x, y, r, g, b, a, seeThrough, packedLight);
+        if (blob != null) {
+            blob.draw(matrix, buffer, raw, x, y, r, g, b, a, isShadow, seeThrough, packedLight);
         }
 
         VertexConsumer builder = null;
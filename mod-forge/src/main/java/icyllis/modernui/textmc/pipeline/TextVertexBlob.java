@@ -0,0 +1,157 @@
+/*
+ * Modern UI.
+ * Copyright (C) 2019-2021 BloCamLimb. All rights reserved.
+ *
+ * Modern UI is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Modern UI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Modern UI. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+package icyllis.modernui.textmc.pipeline;
+
+import com.mojang.blaze3d.vertex.VertexConsumer;
+import com.mojang.math.Matrix4f;
+import icyllis.modernui.graphics.font.GlyphManagerForge;
+import icyllis.modernui.graphics.font.TexturedGlyph;
+import net.minecraft.client.renderer.MultiBufferSource;
+
+import javax.annotation.Nonnull;
+
+/**
+ * Pre-baked quads of a text node, relative to the text origin. Color states are resolved
+ * to per-glyph colors once, including a dimmed variant for shadows. Drawing only applies
+ * the matrix, the input color and the light. Digits and obfuscated glyphs are resolved
+ * on the fly, since they depend on the raw string or are random.
+ */
+public class TextVertexBlob {
+
+    /**
+     * Use the input color of draw call.
+     */
+    private static final int INPUT_COLOR = GlyphRender.USE_INPUT_COLOR;
+
+    // 8 floats per glyph, see TexturedGlyph.bake()
+    private static final int STRIDE = 8;
+
+    // render thread only
+    private static final float[] sQuad = new float[STRIDE];
+
+    private final GlyphRender[] glyphs;
+
+    /**
+     * Static glyphs, or null for glyphs depending on the raw string.
+     */
+    private final TexturedGlyph[] baked;
+
+    private final float[] quads;
+
+    // RGB or INPUT_COLOR
+    private final int[] colors;
+    private final int[] shadowColors;
+
+    /**
+     * Bake the quads of given glyphs, their color states and offsets must be final.
+     *
+     * @param glyphs the glyphs of a text node
+     */
+    public TextVertexBlob(@Nonnull GlyphRender[] glyphs) {
+        final int count = glyphs.length;
+        this.glyphs = glyphs;
+        baked = new TexturedGlyph[count];
+        quads = new float[count * STRIDE];
+        colors = new int[count];
+        shadowColors = new int[count];
+
+        int color = INPUT_COLOR;
+        for (int i = 0; i < count; i++) {
+            GlyphRender glyph = glyphs[i];
+            if (glyph.color != GlyphRender.COLOR_NO_CHANGE) {
+                color = glyph.color;
+            }
+            colors[i] = color;
+            if (color == INPUT_COLOR) {
+                shadowColors[i] = INPUT_COLOR;
+            } else {
+                shadowColors[i] = (color >> 2) & 0x3f3f3f;
+            }
+            if (glyph instanceof StandardGlyphRender) {
+                TexturedGlyph t = glyph.getGlyph("");
+                t.bake(quads, i * STRIDE, glyph.offsetX, 0);
+                baked[i] = t;
+            }
+        }
+    }
+
+    /**
+     * Draw the glyphs of the blob.
+     *
+     * @param matrix     matrix
+     * @param buffer     buffer source
+     * @param raw        the raw string, needed by {@link DigitGlyphRender}
+     * @param x          the origin x, including baseline adjustments
+     * @param y          the origin y, including baseline adjustments
+     * @param r          input red
+     * @param g          input green
+     * @param b          input blue
+     * @param a          input alpha
+     * @param isShadow   use the shadow colors
+     * @param seeThrough is see through type
+     * @param light      packed light
+     */
+    public void draw(Matrix4f matrix, @Nonnull MultiBufferSource buffer, @Nonnull CharSequence raw, float x, float y,
+                     int r, int g, int b, int a, boolean isShadow, boolean seeThrough, int light) {
+        final int[] colors = isShadow ? shadowColors : this.colors;
+        final int frame = GlyphManagerForge.sFrame;
+        for (int i = 0, e = glyphs.length; i < e; i++) {
+            TexturedGlyph glyph = baked[i];
+            final float[] quad;
+            final int offset;
+            if (glyph == null) {
+                glyph = glyphs[i].getGlyph(raw);
+                glyph.bake(sQuad, 0, glyphs[i].offsetX, 0);
+                quad = sQuad;
+                offset = 0;
+            } else {
+                quad = quads;
+                offset = i * STRIDE;
+            }
+            glyph.getPage().markUsed(frame);
+
+            int color = colors[i];
+            final int cr, cg, cb;
+            if (color == INPUT_COLOR) {
+                cr = r;
+                cg = g;
+                cb = b;
+            } else {
+                cr = color >> 16 & 0xff;
+                cg = color >> 8 & 0xff;
+                cb = color & 0xff;
+            }
+
+            final float left = x + quad[offset];
+            final float top = y + quad[offset + 1];
+            final float right = x + quad[offset + 2];
+            final float bottom = y + quad[offset + 3];
+            final float u1 = quad[offset + 4];
+            final float v1 = quad[offset + 5];
+            final float u2 = quad[offset + 6];
+            final float v2 = quad[offset + 7];
+
+            VertexConsumer builder = buffer.getBuffer(glyph.getRenderType(seeThrough));
+            builder.vertex(matrix, left, top, 0).color(cr, cg, cb, a).uv(u1, v1).uv2(light).endVertex();
+            builder.vertex(matrix, left, bottom, 0).color(cr, cg, cb, a).uv(u1, v2).uv2(light).endVertex();
+            builder.vertex(matrix, right, bottom, 0).color(cr, cg, cb, a).uv(u2, v2).uv2(light).endVertex();
+            builder.vertex(matrix, right, top, 0).color(cr, cg, cb, a).uv(u2, v1).uv2(light).endVertex();
+        }
+    }
+}